@@ -101,7 +101,7 @@ int main(void) {
         const uint8_t *app = apps_next(&iter, &app_size);
         if (!app) break;
 
-        printf("[INFO] load app%d to %p\n", app_id, (void *)app);
+        printf("[INFO] load app%d to %p (%d ticks)\n", app_id, (void *)app, (int)iter.load_time);
 
         /* 初始化上下文 */
         context_t ctx = context_user((uintptr_t)app);
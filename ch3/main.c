@@ -195,7 +195,7 @@ void main(void) {
         const uint8_t *app = apps_next(&iter, &app_size);
         if (!app) break;
 
-        printf("[INFO] load app%d to %p\n", task_count, (void *)app);
+        printf("[INFO] load app%d to %p (%d ticks)\n", task_count, (void *)app, (int)iter.load_time);
 
         task_t *task = &tasks[task_count];
         task->ctx = context_user((uintptr_t)app);
@@ -205,6 +205,9 @@ void main(void) {
         task_count++;
     }
 
+    /* 所有应用复制完毕后统一刷新指令缓存 */
+    asm volatile("fence.i");
+
     puts("");
 
     /* 开启定时器中断 */
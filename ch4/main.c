@@ -55,12 +55,18 @@ static long do_write(int fd, const void *buf, size_t count) {
     if (fd == FD_STDOUT || fd == FD_STDERR) {
         /* 翻译用户空间地址 */
         process_t *proc = &processes[current_pid];
-        const char *s = as_translate(proc->as, (vaddr_t)buf, PTE_R | PTE_V);
-        if (!s) {
-            return -1;
-        }
-        for (size_t i = 0; i < count; i++) {
-            console_putchar(s[i]);
+        size_t done = 0;
+        while (done < count) {
+            size_t n;
+            const char *s = as_translate_span(proc->as, (vaddr_t)buf + done, count - done,
+                                              PTE_R | PTE_V, &n);
+            if (!s) {
+                return done ? (long)done : -1;
+            }
+            for (size_t i = 0; i < n; i++) {
+                console_putchar(s[i]);
+            }
+            done += n;
         }
         return count;
     }
@@ -79,15 +85,12 @@ static long do_clock_gettime(int clock_id, timespec_t *tp) {
     if (clock_id == CLOCK_MONOTONIC && tp) {
         /* 翻译用户空间地址 */
         process_t *proc = &processes[current_pid];
-        timespec_t *ktp = as_translate(proc->as, (vaddr_t)tp, PTE_W | PTE_V);
-        if (!ktp) {
-            return -1;
-        }
         uint64_t time = read_time();
         uint64_t ns = time * 80;
-        ktp->tv_sec = ns / 1000000000UL;
-        ktp->tv_nsec = ns % 1000000000UL;
-        return 0;
+        timespec_t ts;
+        ts.tv_sec = ns / 1000000000UL;
+        ts.tv_nsec = ns % 1000000000UL;
+        return as_copy_to_user(proc->as, (vaddr_t)tp, &ts, sizeof(ts));
     }
     return -1;
 }
@@ -140,24 +143,29 @@ static const char *exception_name(uintptr_t code) {
  * 创建进程
  * ========================================================================== */
 
-/* 将内核空间映射到用户地址空间（S-mode 才能访问） */
-static void map_kernel_to_user(address_space_t *user_as, kernel_layout_t *layout, uintptr_t memory_end) {
-    /* 映射内核代码段（仅 S-mode 可访问） */
+/* 建立内核地址空间的映射（仅 S-mode 可访问），只在启动时做一次 */
+static void map_kernel_space(address_space_t *as, kernel_layout_t *layout, uintptr_t memory_end) {
+    /* 映射内核代码段 */
     uintptr_t text_start = layout->text;
     uintptr_t text_end = layout->rodata;
-    as_map_extern(user_as,
+    as_map_extern(as,
                   va_vpn(text_start), va_vpn(text_end),
-                  pa_ppn(text_start), PTE_V | PTE_R | PTE_X);
+                  pa_ppn(text_start), PTE_V | PTE_R | PTE_X | PTE_G);
 
     /* 映射内核只读数据 */
-    as_map_extern(user_as,
+    as_map_extern(as,
                   va_vpn(layout->rodata), va_vpn(layout->data),
-                  pa_ppn(layout->rodata), PTE_V | PTE_R);
+                  pa_ppn(layout->rodata), PTE_V | PTE_R | PTE_G);
 
     /* 映射内核数据和堆 */
-    as_map_extern(user_as,
+    as_map_extern(as,
                   va_vpn(layout->data), va_vpn(memory_end),
-                  pa_ppn(layout->data), PTE_V | PTE_R | PTE_W);
+                  pa_ppn(layout->data), PTE_V | PTE_R | PTE_W | PTE_G);
+}
+
+/* 将内核空间映射到用户地址空间：直接链接 kernel_as 的内核根页表项 */
+static void map_kernel_to_user(address_space_t *user_as, kernel_layout_t *layout, uintptr_t memory_end) {
+    as_share_kernel(user_as, kernel_as, layout->text, memory_end);
 }
 
 static kernel_layout_t g_layout;
@@ -198,20 +206,28 @@ static int create_process(const uint8_t *elf_data, size_t elf_len) {
 
     /* 初始化上下文 */
     proc->ctx.ctx = context_user(entry);
-    proc->ctx.satp = make_satp(as_root_ppn(as));
+    proc->ctx.satp = as_activate(as);
     ctx_set_sp(&proc->ctx.ctx, USER_STACK_TOP);
 
     printf("[INFO] created process %d, entry=%p\n", pid, (void *)entry);
     return pid;
 }
 
+/* 结束进程并回收其地址空间 */
+static void exit_process(process_t *proc) {
+    as_destroy(proc->as);
+    proc->as = NULL;
+    proc->valid = false;
+    process_count--;
+}
+
 /* ============================================================================
  * 创建内核地址空间
  * ========================================================================== */
 
 static void create_kernel_space(kernel_layout_t *layout, uintptr_t memory_end) {
     kernel_as = as_create();
-    map_kernel_to_user(kernel_as, layout, memory_end);
+    map_kernel_space(kernel_as, layout, memory_end);
     printf("[INFO] kernel space created, root_ppn=%p\n",
            (void *)as_root_ppn(kernel_as));
 }
@@ -272,7 +288,8 @@ void main(void) {
     puts("");
 
     /* 启用分页 */
-    write_satp(make_satp(as_root_ppn(kernel_as)));
+    write_satp(make_satp(as_root_ppn(kernel_as), 0));
+    asid_init();
     puts("[INFO] paging enabled");
 
     /* 调度执行 */
@@ -291,6 +308,7 @@ void main(void) {
         process_t *proc = &processes[pid];
 
         /* 执行进程 */
+        proc->ctx.satp = as_activate(proc->as);
         foreign_ctx_run(&proc->ctx);
 
         uintptr_t scause = read_scause();
@@ -309,27 +327,23 @@ void main(void) {
 
             if (id == SYS_EXIT) {
                 printf("[INFO] process %d exit with code %d\n", pid, (int)args[0]);
-                proc->valid = false;
-                process_count--;
+                exit_process(proc);
             } else if (ret.status == SYSCALL_OK) {
                 ctx_set_arg(ctx, 0, ret.value);
                 ctx_move_next(ctx);
             } else {
                 printf("[ERROR] process %d unsupported syscall %d\n", pid, (int)id);
-                proc->valid = false;
-                process_count--;
+                exit_process(proc);
             }
         } else if (is_exception(scause)) {
             printf("[ERROR] process %d killed: %s, stval=%p, sepc=%p\n",
                    pid, exception_name(code),
                    (void *)read_stval(), (void *)ctx_pc(&proc->ctx.ctx));
-            proc->valid = false;
-            process_count--;
+            exit_process(proc);
         } else {
             printf("[ERROR] process %d killed: unexpected interrupt %d\n",
                    pid, (int)code);
-            proc->valid = false;
-            process_count--;
+            exit_process(proc);
         }
     }
 
@@ -70,23 +70,29 @@ static struct process g_process_pool[MAX_PROCS];
  * 辅助函数
  * ========================================================================== */
 
-static void map_kernel_to_user(address_space_t *user_as) {
+/* 建立内核地址空间的映射，只在启动时对 kernel_as 做一次 */
+static void map_kernel_space(address_space_t *as) {
     /* 映射内核代码段 */
     uintptr_t text_start = g_layout.text;
     uintptr_t text_end = g_layout.rodata;
-    as_map_extern(user_as,
+    as_map_extern(as,
                   va_vpn(text_start), va_vpn(text_end),
-                  pa_ppn(text_start), PTE_V | PTE_R | PTE_X);
+                  pa_ppn(text_start), PTE_V | PTE_R | PTE_X | PTE_G);
 
     /* 映射内核只读数据 */
-    as_map_extern(user_as,
+    as_map_extern(as,
                   va_vpn(g_layout.rodata), va_vpn(g_layout.data),
-                  pa_ppn(g_layout.rodata), PTE_V | PTE_R);
+                  pa_ppn(g_layout.rodata), PTE_V | PTE_R | PTE_G);
 
     /* 映射内核数据和堆 */
-    as_map_extern(user_as,
+    as_map_extern(as,
                   va_vpn(g_layout.data), va_vpn(g_memory_end),
-                  pa_ppn(g_layout.data), PTE_V | PTE_R | PTE_W);
+                  pa_ppn(g_layout.data), PTE_V | PTE_R | PTE_W | PTE_G);
+}
+
+/* 用户地址空间直接链接 kernel_as 中的内核根页表项 */
+static void map_kernel_to_user(address_space_t *user_as) {
+    as_share_kernel(user_as, kernel_as, g_layout.text, g_memory_end);
 }
 
 static const app_entry_t *find_app(const char *name, size_t len) {
@@ -118,8 +124,10 @@ static struct process *create_process_from_elf(const uint8_t *elf_data, size_t e
     /* 映射内核空间 */
     map_kernel_to_user(proc->as);
 
-    /* 加载 ELF */
-    uintptr_t entry = elf_load(proc->as, elf_data, elf_len);
+    /* 加载 ELF：内嵌镜像常驻内存，直接作为懒加载的后备文件 */
+    vm_file_t *file = vm_file_from_memory(elf_data, elf_len);
+    uintptr_t entry = file ? elf_load_lazy(proc->as, file) : 0;
+    vm_file_put(file);
     if (!entry) {
         as_destroy(proc->as);
         return NULL;
@@ -128,12 +136,12 @@ static struct process *create_process_from_elf(const uint8_t *elf_data, size_t e
     /* 分配用户栈 */
     uintptr_t stack_vpn_end = va_vpn(USER_STACK_TOP);
     uintptr_t stack_vpn_start = stack_vpn_end - (USER_STACK_SIZE / PAGE_SIZE);
-    as_map(proc->as, stack_vpn_start, stack_vpn_end, NULL, 0, 0,
-           PTE_V | PTE_R | PTE_W | PTE_U);
+    as_map_anon(proc->as, stack_vpn_start, stack_vpn_end,
+                PTE_V | PTE_R | PTE_W | PTE_U);
 
     /* 初始化上下文 */
     proc->ctx.ctx = context_user(entry);
-    proc->ctx.satp = make_satp(as_root_ppn(proc->as));
+    proc->ctx.satp = as_activate(proc->as);
     ctx_set_sp(&proc->ctx.ctx, USER_STACK_TOP);
 
     return proc;
@@ -153,7 +161,7 @@ static struct process *fork_process(struct process *parent) {
 
     /* 复制上下文 */
     child->ctx.ctx = parent->ctx.ctx;
-    child->ctx.satp = make_satp(as_root_ppn(child->as));
+    child->ctx.satp = as_activate(child->as);
 
     return child;
 }
@@ -166,8 +174,10 @@ static int exec_process(struct process *proc, const uint8_t *elf_data, size_t el
     /* 映射内核空间 */
     map_kernel_to_user(new_as);
 
-    /* 加载 ELF */
-    uintptr_t entry = elf_load(new_as, elf_data, elf_len);
+    /* 加载 ELF：内嵌镜像常驻内存，直接作为懒加载的后备文件 */
+    vm_file_t *file = vm_file_from_memory(elf_data, elf_len);
+    uintptr_t entry = file ? elf_load_lazy(new_as, file) : 0;
+    vm_file_put(file);
     if (!entry) {
         as_destroy(new_as);
         return -1;
@@ -176,16 +186,16 @@ static int exec_process(struct process *proc, const uint8_t *elf_data, size_t el
     /* 分配用户栈 */
     uintptr_t stack_vpn_end = va_vpn(USER_STACK_TOP);
     uintptr_t stack_vpn_start = stack_vpn_end - (USER_STACK_SIZE / PAGE_SIZE);
-    as_map(new_as, stack_vpn_start, stack_vpn_end, NULL, 0, 0,
-           PTE_V | PTE_R | PTE_W | PTE_U);
+    as_map_anon(new_as, stack_vpn_start, stack_vpn_end,
+                PTE_V | PTE_R | PTE_W | PTE_U);
 
-    /* 替换地址空间 */
-    /* TODO: 释放旧地址空间 */
+    /* 替换地址空间并回收旧的 */
+    as_destroy(proc->as);
     proc->as = new_as;
 
     /* 重置上下文 */
     proc->ctx.ctx = context_user(entry);
-    proc->ctx.satp = make_satp(as_root_ppn(proc->as));
+    proc->ctx.satp = as_activate(proc->as);
     ctx_set_sp(&proc->ctx.ctx, USER_STACK_TOP);
 
     return 0;
@@ -200,11 +210,17 @@ static long do_write(int fd, const void *buf, size_t count) {
         struct process *proc = pm_current(&g_pm);
         if (!proc) return -1;
 
-        const char *s = as_translate(proc->as, (vaddr_t)buf, PTE_R | PTE_V);
-        if (!s) return -1;
-
-        for (size_t i = 0; i < count; i++) {
-            console_putchar(s[i]);
+        /* 用户缓冲区逐页访问：相邻虚拟页不一定物理连续 */
+        size_t done = 0;
+        while (done < count) {
+            size_t n;
+            const char *s = as_translate_span(proc->as, (vaddr_t)buf + done, count - done,
+                                              PTE_R | PTE_V, &n);
+            if (!s) return done ? (long)done : -1;
+            for (size_t i = 0; i < n; i++) {
+                console_putchar(s[i]);
+            }
+            done += n;
         }
         return count;
     }
@@ -216,16 +232,21 @@ static long do_read(int fd, void *buf, size_t count) {
         struct process *proc = pm_current(&g_pm);
         if (!proc) return -1;
 
-        char *dst = as_translate(proc->as, (vaddr_t)buf, PTE_W | PTE_V);
-        if (!dst) return -1;
-
-        for (size_t i = 0; i < count; i++) {
-            int c;
-            /* 等待有效输入（console_getchar 在无输入时返回 -1） */
-            while ((c = console_getchar()) < 0) {
-                /* 忙等待 */
+        size_t done = 0;
+        while (done < count) {
+            size_t n;
+            char *dst = as_translate_span(proc->as, (vaddr_t)buf + done, count - done,
+                                          PTE_W | PTE_V, &n);
+            if (!dst) return done ? (long)done : -1;
+            for (size_t i = 0; i < n; i++) {
+                int c;
+                /* 等待有效输入（console_getchar 在无输入时返回 -1） */
+                while ((c = console_getchar()) < 0) {
+                    /* 忙等待 */
+                }
+                dst[i] = (char)c;
             }
-            dst[i] = (char)c;
+            done += n;
         }
         return count;
     }
@@ -236,6 +257,16 @@ static void do_exit(int code) {
     (void)code;
 }
 
+/* 结束当前进程：立即回收地址空间，进程描述符留给父进程 wait 时回收 */
+static void exit_current(int exit_code) {
+    struct process *proc = pm_current(&g_pm);
+    if (proc) {
+        as_destroy(proc->as);
+        proc->as = NULL;
+    }
+    pm_exit_current(&g_pm, exit_code);
+}
+
 static long do_sched_yield(void) {
     return 0;
 }
@@ -245,14 +276,12 @@ static long do_clock_gettime(int clock_id, timespec_t *tp) {
         struct process *proc = pm_current(&g_pm);
         if (!proc) return -1;
 
-        timespec_t *ktp = as_translate(proc->as, (vaddr_t)tp, PTE_W | PTE_V);
-        if (!ktp) return -1;
-
         uint64_t time = read_time();
         uint64_t ns = time * 80;
-        ktp->tv_sec = ns / 1000000000UL;
-        ktp->tv_nsec = ns % 1000000000UL;
-        return 0;
+        timespec_t ts;
+        ts.tv_sec = ns / 1000000000UL;
+        ts.tv_nsec = ns % 1000000000UL;
+        return as_copy_to_user(proc->as, (vaddr_t)tp, &ts, sizeof(ts));
     }
     return -1;
 }
@@ -282,14 +311,15 @@ static long do_exec(const char *path, size_t len) {
     struct process *proc = pm_current(&g_pm);
     if (!proc) return -1;
 
-    /* 翻译路径 */
-    const char *kpath = as_translate(proc->as, (vaddr_t)path, PTE_R | PTE_V);
-    if (!kpath) return -1;
+    /* 复制应用名 */
+    char name[32];
+    if (len > 31) len = 31;
+    if (as_copy_from_user(proc->as, name, (vaddr_t)path, len) != 0) return -1;
 
     /* 查找应用 */
-    const app_entry_t *app = find_app(kpath, len);
+    const app_entry_t *app = find_app(name, len);
     if (!app) {
-        printf("[ERROR] unknown app: %.*s\n", (int)len, kpath);
+        printf("[ERROR] unknown app: %.*s\n", (int)len, name);
         return -1;
     }
 
@@ -301,26 +331,72 @@ static long do_waitpid(long pid, int *exit_code) {
     struct process *proc = pm_current(&g_pm);
     if (!proc) return -1;
 
-    int *kcode = NULL;
-    if (exit_code) {
-        kcode = as_translate(proc->as, (vaddr_t)exit_code, PTE_W | PTE_V);
-    }
-
     wait_result_t result = pm_wait(&g_pm, (pid_t)pid);
     if (!result.found) {
         return -1;
     }
 
-    if (kcode) {
-        *kcode = result.exit_code;
+    if (exit_code) {
+        as_copy_to_user(proc->as, (vaddr_t)exit_code, &result.exit_code, sizeof(int));
     }
     return result.pid;
 }
 
+static long do_meminfo(meminfo_t *info) {
+    struct process *proc = pm_current(&g_pm);
+    if (!proc || !info) return -1;
+
+    heap_stats_t stats;
+    heap_get_stats(&stats);
+    meminfo_t kinfo;
+    kinfo.total = stats.total;
+    kinfo.used = stats.used;
+    kinfo.peak = stats.peak;
+    return as_copy_to_user(proc->as, (vaddr_t)info, &kinfo, sizeof(kinfo));
+}
+
+/* PROT_* 转换为用户页表项标志（RISC-V 不允许只写页，可写隐含可读） */
+static uint64_t prot_to_flags(int prot) {
+    uint64_t flags = PTE_U;
+    if (prot & PROT_READ) flags |= PTE_R;
+    if (prot & PROT_WRITE) flags |= PTE_R | PTE_W;
+    if (prot & PROT_EXEC) flags |= PTE_X;
+    return flags;
+}
+
+static long do_mmap(uintptr_t addr, size_t len, int prot, int flags, int fd, size_t offset) {
+    struct process *proc = pm_current(&g_pm);
+    if (!proc || len == 0 || (offset & PAGE_MASK)) return -1;
+    if (!(flags & (MAP_PRIVATE | MAP_SHARED))) return -1;
+
+    /* 没有文件系统：只支持匿名私有映射 */
+    (void)fd;
+    if (!(flags & MAP_ANONYMOUS) || (flags & MAP_SHARED)) return -1;
+
+    vaddr_t va = as_mmap(proc->as, addr, len, prot_to_flags(prot),
+                         (flags & MAP_FIXED) != 0, NULL, offset);
+    return va ? (long)va : -1;
+}
+
+static long do_munmap(uintptr_t addr, size_t len) {
+    struct process *proc = pm_current(&g_pm);
+    uintptr_t vpn_start, vpn_end;
+    if (!proc || !user_vpn_range(addr, len, &vpn_start, &vpn_end)) return -1;
+    return as_unmap(proc->as, vpn_start, vpn_end);
+}
+
+static long do_mprotect(uintptr_t addr, size_t len, int prot) {
+    struct process *proc = pm_current(&g_pm);
+    uintptr_t vpn_start, vpn_end;
+    if (!proc || !user_vpn_range(addr, len, &vpn_start, &vpn_end)) return -1;
+    return as_protect(proc->as, vpn_start, vpn_end, prot_to_flags(prot));
+}
+
 static syscall_io_t io_impl;
 static syscall_proc_t proc_impl;
 static syscall_sched_t sched_impl;
 static syscall_clock_t clock_impl;
+static syscall_mm_t mm_impl;
 
 static void init_syscall(void) {
     io_impl.write = do_write;
@@ -334,11 +410,16 @@ static void init_syscall(void) {
 
     sched_impl.sched_yield = do_sched_yield;
     clock_impl.clock_gettime = do_clock_gettime;
+    mm_impl.meminfo = do_meminfo;
+    mm_impl.mmap = do_mmap;
+    mm_impl.munmap = do_munmap;
+    mm_impl.mprotect = do_mprotect;
 
     syscall_set_io(&io_impl);
     syscall_set_proc(&proc_impl);
     syscall_set_sched(&sched_impl);
     syscall_set_clock(&clock_impl);
+    syscall_set_mm(&mm_impl);
 }
 
 /* ============================================================================
@@ -432,7 +513,7 @@ void main(void) {
 
     /* 创建内核地址空间 */
     kernel_as = as_create();
-    map_kernel_to_user(kernel_as);
+    map_kernel_space(kernel_as);
     printf("[INFO] kernel space created\n");
 
     /* 初始化进程管理器 */
@@ -463,7 +544,8 @@ void main(void) {
     puts("");
 
     /* 启用分页 */
-    write_satp(make_satp(as_root_ppn(kernel_as)));
+    write_satp(make_satp(as_root_ppn(kernel_as), 0));
+    asid_init();
     puts("[INFO] paging enabled\n");
 
     /* 调度循环 */
@@ -474,6 +556,7 @@ void main(void) {
             break;
         }
 
+        proc->ctx.satp = as_activate(proc->as);
         foreign_ctx_run(&proc->ctx);
 
         uintptr_t scause = read_scause();
@@ -492,24 +575,28 @@ void main(void) {
             syscall_result_t ret = syscall_dispatch(id, args);
 
             if (id == SYS_EXIT) {
-                pm_exit_current(&g_pm, (int)args[0]);
+                exit_current((int)args[0]);
             } else if (ret.status == SYSCALL_OK) {
                 ctx_set_arg(ctx, 0, ret.value);
                 pm_suspend_current(&g_pm);
             } else {
                 printf("[ERROR] pid=%d unsupported syscall %d\n",
                        (int)proc->pid, (int)id);
-                pm_exit_current(&g_pm, -2);
+                exit_current(-2);
             }
+        } else if (is_exception(scause) && as_fault_access(code) &&
+                   as_handle_fault(proc->as, read_stval(), as_fault_access(code)) == 0) {
+            /* 缺页已处理（按需调页 / 写时复制），重新执行该指令 */
+            pm_suspend_current(&g_pm);
         } else if (is_exception(scause)) {
             printf("[ERROR] pid=%d killed: %s, stval=%p, sepc=%p\n",
                    (int)proc->pid, exception_name(code),
                    (void *)read_stval(), (void *)ctx_pc(&proc->ctx.ctx));
-            pm_exit_current(&g_pm, -3);
+            exit_current(-3);
         } else {
             printf("[ERROR] pid=%d killed: unexpected interrupt %d\n",
                    (int)proc->pid, (int)code);
-            pm_exit_current(&g_pm, -3);
+            exit_current(-3);
         }
     }
 
@@ -30,6 +30,8 @@
 #define USER_STACK_SIZE (2 * PAGE_SIZE)
 #define USER_STACK_TOP  (1UL << 38)
 #define MAX_FD          16
+#define PATH_MAX_LEN    256     /* 路径参数的最大长度（含结尾的 '\0'） */
+#define GETDENTS_BUF_SIZE 512   /* getdents64 单次返回的最大字节数 */
 
 /* MMIO 区域 */
 #define VIRTIO_MMIO_BASE 0x10001000
@@ -70,50 +72,75 @@ static struct process g_process_pool[MAX_PROCS];
  * 辅助函数
  * ========================================================================== */
 
-static void map_kernel_to_user(address_space_t *user_as) {
+/* 建立内核地址空间的映射，只在启动时对 kernel_as 做一次 */
+static void map_kernel_space(address_space_t *as) {
     uintptr_t text_start = g_layout.text;
     uintptr_t text_end = g_layout.rodata;
-    as_map_extern(user_as, va_vpn(text_start), va_vpn(text_end),
-                  pa_ppn(text_start), PTE_V | PTE_R | PTE_X);
+    as_map_extern(as, va_vpn(text_start), va_vpn(text_end),
+                  pa_ppn(text_start), PTE_V | PTE_R | PTE_X | PTE_G);
 
-    as_map_extern(user_as, va_vpn(g_layout.rodata), va_vpn(g_layout.data),
-                  pa_ppn(g_layout.rodata), PTE_V | PTE_R);
+    as_map_extern(as, va_vpn(g_layout.rodata), va_vpn(g_layout.data),
+                  pa_ppn(g_layout.rodata), PTE_V | PTE_R | PTE_G);
 
-    as_map_extern(user_as, va_vpn(g_layout.data), va_vpn(g_memory_end),
-                  pa_ppn(g_layout.data), PTE_V | PTE_R | PTE_W);
+    as_map_extern(as, va_vpn(g_layout.data), va_vpn(g_memory_end),
+                  pa_ppn(g_layout.data), PTE_V | PTE_R | PTE_W | PTE_G);
 
     /* 映射 MMIO */
+    as_map_extern(as, va_vpn(VIRTIO_MMIO_BASE),
+                  va_vpn(VIRTIO_MMIO_BASE + VIRTIO_MMIO_SIZE),
+                  pa_ppn(VIRTIO_MMIO_BASE), PTE_V | PTE_R | PTE_W | PTE_G);
+}
+
+/* 用户地址空间直接链接 kernel_as 中的内核根页表项 */
+static void map_kernel_to_user(address_space_t *user_as) {
+    as_share_kernel(user_as, kernel_as, g_layout.text, g_memory_end);
+
+    /* MMIO 与用户程序同处根页表第 0 项，无法共享，逐进程映射 */
     as_map_extern(user_as, va_vpn(VIRTIO_MMIO_BASE),
                   va_vpn(VIRTIO_MMIO_BASE + VIRTIO_MMIO_SIZE),
-                  pa_ppn(VIRTIO_MMIO_BASE), PTE_V | PTE_R | PTE_W);
+                  pa_ppn(VIRTIO_MMIO_BASE), PTE_V | PTE_R | PTE_W | PTE_G);
 }
 
-/* 从文件系统读取整个文件 */
-static uint8_t *read_all(file_handle_t *fh, size_t *out_len) {
-    if (!fh || !fh->inode) return NULL;
+/* 以打开的文件作为懒加载页的后备存储 */
+typedef struct {
+    vm_file_t base;
+    file_handle_t *fh;
+} fs_vm_file_t;
 
-    uint32_t size = inode_size(fh->inode);
-    uint8_t *data = heap_alloc(size, 8);
-    if (!data) return NULL;
+static size_t fs_vm_read(vm_file_t *file, size_t offset, void *buf, size_t len) {
+    fs_vm_file_t *f = (fs_vm_file_t *)file;
+    return inode_read_at(f->fh->inode, offset, buf, len);
+}
+
+static void fs_vm_release(vm_file_t *file) {
+    fs_vm_file_t *f = (fs_vm_file_t *)file;
+    file_close(f->fh);
+    heap_free(f, sizeof(fs_vm_file_t));
+}
 
-    size_t total = 0;
-    uint8_t buf[512];
-    while (total < size) {
-        size_t n = file_read(fh, buf, 512);
-        if (n == 0) break;
-        memcpy(data + total, buf, n);
-        total += n;
+/* 包装一个文件句柄，句柄归返回的 vm_file 所有（失败时关闭） */
+static vm_file_t *wrap_vm_file(file_handle_t *fh) {
+    fs_vm_file_t *f = heap_alloc(sizeof(fs_vm_file_t), 8);
+    if (!f) {
+        file_close(fh);
+        return NULL;
     }
+    vm_file_init(&f->base, fs_vm_read, fs_vm_release);
+    f->fh = fh;
+    return &f->base;
+}
 
-    *out_len = total;
-    return data;
+static vm_file_t *open_vm_file(const char *name) {
+    file_handle_t *fh = file_open(g_fs, name, O_RDONLY);
+    if (!fh) return NULL;
+    return wrap_vm_file(fh);
 }
 
 /* ============================================================================
  * 进程操作
  * ========================================================================== */
 
-static struct process *create_process_from_elf(const uint8_t *elf_data, size_t elf_len) {
+static struct process *create_process_from_elf(vm_file_t *file) {
     pid_t pid = pid_alloc();
     if (pid >= MAX_PROCS) return NULL;
 
@@ -125,7 +152,7 @@ static struct process *create_process_from_elf(const uint8_t *elf_data, size_t e
 
     map_kernel_to_user(proc->as);
 
-    uintptr_t entry = elf_load(proc->as, elf_data, elf_len);
+    uintptr_t entry = elf_load_lazy(proc->as, file);
     if (!entry) {
         as_destroy(proc->as);
         return NULL;
@@ -133,25 +160,19 @@ static struct process *create_process_from_elf(const uint8_t *elf_data, size_t e
 
     uintptr_t stack_vpn_end = va_vpn(USER_STACK_TOP);
     uintptr_t stack_vpn_start = stack_vpn_end - (USER_STACK_SIZE / PAGE_SIZE);
-    as_map(proc->as, stack_vpn_start, stack_vpn_end, NULL, 0, 0,
-           PTE_V | PTE_R | PTE_W | PTE_U);
+    as_map_anon(proc->as, stack_vpn_start, stack_vpn_end,
+                PTE_V | PTE_R | PTE_W | PTE_U);
 
     proc->ctx.ctx = context_user(entry);
-    proc->ctx.satp = make_satp(as_root_ppn(proc->as));
+    proc->ctx.satp = as_activate(proc->as);
     ctx_set_sp(&proc->ctx.ctx, USER_STACK_TOP);
 
     /* 初始化文件描述符表 */
     memset(proc->fd_table, 0, sizeof(proc->fd_table));
     /* fd 0: stdin (空，由 read 特殊处理) */
-    proc->fd_table[0] = heap_alloc(sizeof(file_handle_t), 8);
-    proc->fd_table[0]->inode = NULL;
-    proc->fd_table[0]->readable = true;
-    proc->fd_table[0]->writable = false;
+    proc->fd_table[0] = file_alloc(NULL, true, false);
     /* fd 1: stdout */
-    proc->fd_table[1] = heap_alloc(sizeof(file_handle_t), 8);
-    proc->fd_table[1]->inode = NULL;
-    proc->fd_table[1]->readable = false;
-    proc->fd_table[1]->writable = true;
+    proc->fd_table[1] = file_alloc(NULL, false, true);
 
     return proc;
 }
@@ -167,18 +188,12 @@ static struct process *fork_process(struct process *parent) {
     if (!child->as) return NULL;
 
     child->ctx.ctx = parent->ctx.ctx;
-    child->ctx.satp = make_satp(as_root_ppn(child->as));
+    child->ctx.satp = as_activate(child->as);
 
     /* 复制文件描述符表 */
     for (int i = 0; i < MAX_FD; i++) {
         if (parent->fd_table[i]) {
-            child->fd_table[i] = heap_alloc(sizeof(file_handle_t), 8);
-            memcpy(child->fd_table[i], parent->fd_table[i], sizeof(file_handle_t));
-            /* 复制 inode */
-            if (parent->fd_table[i]->inode) {
-                child->fd_table[i]->inode = heap_alloc(sizeof(inode_t), 8);
-                memcpy(child->fd_table[i]->inode, parent->fd_table[i]->inode, sizeof(inode_t));
-            }
+            child->fd_table[i] = file_dup(parent->fd_table[i]);
         } else {
             child->fd_table[i] = NULL;
         }
@@ -187,13 +202,13 @@ static struct process *fork_process(struct process *parent) {
     return child;
 }
 
-static int exec_process(struct process *proc, const uint8_t *elf_data, size_t elf_len) {
+static int exec_process(struct process *proc, vm_file_t *file) {
     address_space_t *new_as = as_create();
     if (!new_as) return -1;
 
     map_kernel_to_user(new_as);
 
-    uintptr_t entry = elf_load(new_as, elf_data, elf_len);
+    uintptr_t entry = elf_load_lazy(new_as, file);
     if (!entry) {
         as_destroy(new_as);
         return -1;
@@ -201,12 +216,14 @@ static int exec_process(struct process *proc, const uint8_t *elf_data, size_t el
 
     uintptr_t stack_vpn_end = va_vpn(USER_STACK_TOP);
     uintptr_t stack_vpn_start = stack_vpn_end - (USER_STACK_SIZE / PAGE_SIZE);
-    as_map(new_as, stack_vpn_start, stack_vpn_end, NULL, 0, 0,
-           PTE_V | PTE_R | PTE_W | PTE_U);
+    as_map_anon(new_as, stack_vpn_start, stack_vpn_end,
+                PTE_V | PTE_R | PTE_W | PTE_U);
 
+    /* 替换地址空间并回收旧的 */
+    as_destroy(proc->as);
     proc->as = new_as;
     proc->ctx.ctx = context_user(entry);
-    proc->ctx.satp = make_satp(as_root_ppn(proc->as));
+    proc->ctx.satp = as_activate(proc->as);
     ctx_set_sp(&proc->ctx.ctx, USER_STACK_TOP);
 
     return 0;
@@ -221,8 +238,8 @@ static long do_open(const char *path, uint32_t flags) {
     if (!proc) return -1;
 
     /* 翻译路径 */
-    const char *kpath = as_translate(proc->as, (vaddr_t)path, PTE_R | PTE_V);
-    if (!kpath) return -1;
+    char kpath[PATH_MAX_LEN];
+    if (as_copy_str_from_user(proc->as, kpath, (vaddr_t)path, sizeof(kpath)) < 0) return -1;
 
     /* 找空闲 fd */
     int fd = -1;
@@ -254,59 +271,180 @@ static long do_close(int fd) {
     return -1;
 }
 
-static long do_write(int fd, const void *buf, size_t count) {
+/* 块缓存不区分文件，fsync 同步全部脏块 */
+static long do_fsync(int fd) {
     struct process *proc = pm_current(&g_pm);
-    if (!proc) return -1;
+    if (!proc || fd < 0 || fd >= MAX_FD || !proc->fd_table[fd]) return -1;
+    return block_cache_flush(g_block_dev);
+}
 
-    const char *kbuf = as_translate(proc->as, (vaddr_t)buf, PTE_R | PTE_V);
-    if (!kbuf) return -1;
+static long do_sync(void) {
+    return block_cache_flush(g_block_dev);
+}
 
-    if (fd == FD_STDOUT || fd == FD_STDERR) {
-        for (size_t i = 0; i < count; i++) {
-            console_putchar(kbuf[i]);
-        }
-        return count;
+/* dirfd 为 AT_FDCWD 时相对根目录，否则相对已打开的目录 */
+static bool dirfd_base(struct process *proc, int dirfd, inode_t **base) {
+    if (dirfd == AT_FDCWD) {
+        *base = NULL;
+        return true;
     }
+    if (dirfd < 0 || dirfd >= MAX_FD || !proc->fd_table[dirfd] || !proc->fd_table[dirfd]->inode) {
+        return false;
+    }
+    *base = proc->fd_table[dirfd]->inode;
+    return true;
+}
 
-    if (fd < 0 || fd >= MAX_FD || !proc->fd_table[fd]) return -1;
+/* 没有权限模型，mode 被忽略 */
+static long do_mkdirat(int dirfd, const char *path, uint32_t mode) {
+    (void)mode;
+    struct process *proc = pm_current(&g_pm);
+    if (!proc) return -1;
 
-    file_handle_t *fh = proc->fd_table[fd];
-    if (!fh->writable) return -1;
+    char kpath[PATH_MAX_LEN];
+    inode_t *base;
+    if (as_copy_str_from_user(proc->as, kpath, (vaddr_t)path, sizeof(kpath)) < 0 ||
+        !dirfd_base(proc, dirfd, &base)) {
+        return -1;
+    }
+    return efs_mkdir(g_fs, base, kpath);
+}
+
+static long do_unlinkat(int dirfd, const char *path, uint32_t flags) {
+    struct process *proc = pm_current(&g_pm);
+    if (!proc) return -1;
 
-    return file_write(fh, (const uint8_t *)kbuf, count);
+    char kpath[PATH_MAX_LEN];
+    inode_t *base;
+    if (as_copy_str_from_user(proc->as, kpath, (vaddr_t)path, sizeof(kpath)) < 0 ||
+        !dirfd_base(proc, dirfd, &base)) {
+        return -1;
+    }
+    return efs_unlink(g_fs, base, kpath, (flags & AT_REMOVEDIR) != 0);
 }
 
-static long do_read(int fd, void *buf, size_t count) {
+/* 不支持 RENAME_NOREPLACE 等标志 */
+static long do_renameat2(int olddirfd, const char *oldpath, int newdirfd, const char *newpath,
+                         uint32_t flags) {
+    struct process *proc = pm_current(&g_pm);
+    if (!proc || flags != 0) return -1;
+
+    char kold[PATH_MAX_LEN], knew[PATH_MAX_LEN];
+    inode_t *old_base, *new_base;
+    if (as_copy_str_from_user(proc->as, kold, (vaddr_t)oldpath, sizeof(kold)) < 0 ||
+        as_copy_str_from_user(proc->as, knew, (vaddr_t)newpath, sizeof(knew)) < 0 ||
+        !dirfd_base(proc, olddirfd, &old_base) ||
+        !dirfd_base(proc, newdirfd, &new_base)) {
+        return -1;
+    }
+    return efs_rename(g_fs, old_base, kold, new_base, knew);
+}
+
+static long do_getdents64(int fd, void *buf, size_t len) {
+    struct process *proc = pm_current(&g_pm);
+    if (!proc || fd < 0 || fd >= MAX_FD || !proc->fd_table[fd]) return -1;
+
+    /* 目录项不能跨页拆开写，先写入内核缓冲区再复制（每次最多返回一缓冲区） */
+    uint8_t kbuf[GETDENTS_BUF_SIZE];
+    if (len > sizeof(kbuf)) len = sizeof(kbuf);
+    ssize_t n = file_getdents64(proc->fd_table[fd], kbuf, len);
+    if (n > 0 && as_copy_to_user(proc->as, (vaddr_t)buf, kbuf, n) != 0) return -1;
+    return n;
+}
+
+static long do_write(int fd, const void *buf, size_t count) {
     struct process *proc = pm_current(&g_pm);
     if (!proc) return -1;
 
-    char *kbuf = as_translate(proc->as, (vaddr_t)buf, PTE_W | PTE_V);
-    if (!kbuf) return -1;
+    file_handle_t *fh = NULL;
+    if (fd != FD_STDOUT && fd != FD_STDERR) {
+        if (fd < 0 || fd >= MAX_FD || !proc->fd_table[fd]) return -1;
+        fh = proc->fd_table[fd];
+        if (!fh->writable) return -1;
+    }
 
-    if (fd == FD_STDIN) {
-        for (size_t i = 0; i < count; i++) {
-            int c;
-            /* 等待有效输入（console_getchar 在无输入时返回 -1） */
-            while ((c = console_getchar()) < 0) {
-                /* 忙等待 */
+    /* 用户缓冲区逐页访问：相邻虚拟页不一定物理连续 */
+    size_t done = 0;
+    while (done < count) {
+        size_t n;
+        const char *kbuf = as_translate_span(proc->as, (vaddr_t)buf + done, count - done,
+                                             PTE_R | PTE_V, &n);
+        if (!kbuf) return done ? (long)done : -1;
+
+        if (!fh) {
+            for (size_t i = 0; i < n; i++) {
+                console_putchar(kbuf[i]);
             }
-            kbuf[i] = (char)c;
+            done += n;
+            continue;
         }
-        return count;
+        ssize_t w = file_write(fh, (const uint8_t *)kbuf, n);
+        if (w < 0) return done ? (long)done : -1;
+        done += w;
+        if ((size_t)w < n) break;
     }
+    return done;
+}
 
-    if (fd < 0 || fd >= MAX_FD || !proc->fd_table[fd]) return -1;
+static long do_read(int fd, void *buf, size_t count) {
+    struct process *proc = pm_current(&g_pm);
+    if (!proc) return -1;
 
-    file_handle_t *fh = proc->fd_table[fd];
-    if (!fh->readable) return -1;
+    file_handle_t *fh = NULL;
+    if (fd != FD_STDIN) {
+        if (fd < 0 || fd >= MAX_FD || !proc->fd_table[fd]) return -1;
+        fh = proc->fd_table[fd];
+        if (!fh->readable) return -1;
+    }
 
-    return file_read(fh, (uint8_t *)kbuf, count);
+    /* 用户缓冲区逐页访问，每页单独调入并完成写时复制 */
+    size_t done = 0;
+    while (done < count) {
+        size_t n;
+        char *kbuf = as_translate_span(proc->as, (vaddr_t)buf + done, count - done,
+                                       PTE_W | PTE_V, &n);
+        if (!kbuf) return done ? (long)done : -1;
+
+        if (!fh) {
+            for (size_t i = 0; i < n; i++) {
+                int c;
+                /* 等待有效输入（console_getchar 在无输入时返回 -1） */
+                while ((c = console_getchar()) < 0) {
+                    /* 忙等待 */
+                }
+                kbuf[i] = (char)c;
+            }
+            done += n;
+            continue;
+        }
+        ssize_t r = file_read(fh, (uint8_t *)kbuf, n);
+        if (r < 0) return done ? (long)done : -1;
+        done += r;
+        if ((size_t)r < n) break;
+    }
+    return done;
 }
 
 static void do_exit(int code) {
     (void)code;
 }
 
+/* 结束当前进程：立即回收地址空间和打开的文件，进程描述符留给父进程 wait 时回收 */
+static void exit_current(int exit_code) {
+    struct process *proc = pm_current(&g_pm);
+    if (proc) {
+        as_destroy(proc->as);
+        proc->as = NULL;
+        for (int i = 0; i < MAX_FD; i++) {
+            if (proc->fd_table[i]) {
+                file_close(proc->fd_table[i]);
+                proc->fd_table[i] = NULL;
+            }
+        }
+    }
+    pm_exit_current(&g_pm, exit_code);
+}
+
 static long do_sched_yield(void) {
     return 0;
 }
@@ -316,14 +454,12 @@ static long do_clock_gettime(int clock_id, timespec_t *tp) {
         struct process *proc = pm_current(&g_pm);
         if (!proc) return -1;
 
-        timespec_t *ktp = as_translate(proc->as, (vaddr_t)tp, PTE_W | PTE_V);
-        if (!ktp) return -1;
-
         uint64_t time = read_time();
         uint64_t ns = time * 80;
-        ktp->tv_sec = ns / 1000000000UL;
-        ktp->tv_nsec = ns % 1000000000UL;
-        return 0;
+        timespec_t ts;
+        ts.tv_sec = ns / 1000000000UL;
+        ts.tv_nsec = ns % 1000000000UL;
+        return as_copy_to_user(proc->as, (vaddr_t)tp, &ts, sizeof(ts));
     }
     return -1;
 }
@@ -348,29 +484,21 @@ static long do_exec(const char *path, size_t len) {
     struct process *proc = pm_current(&g_pm);
     if (!proc) return -1;
 
-    const char *kpath = as_translate(proc->as, (vaddr_t)path, PTE_R | PTE_V);
-    if (!kpath) return -1;
-
     /* 从文件系统读取 */
     char name[32];
     if (len > 31) len = 31;
-    memcpy(name, kpath, len);
+    if (as_copy_from_user(proc->as, name, (vaddr_t)path, len) != 0) return -1;
     name[len] = '\0';
 
-    file_handle_t *fh = file_open(g_fs, name, O_RDONLY);
-    if (!fh) {
+    /* 程序页在首次访问时才从文件读入 */
+    vm_file_t *file = open_vm_file(name);
+    if (!file) {
         printf("[ERROR] exec: file not found: %s\n", name);
         return -1;
     }
 
-    size_t elf_len;
-    uint8_t *elf_data = read_all(fh, &elf_len);
-    file_close(fh);
-
-    if (!elf_data) return -1;
-
-    int ret = exec_process(proc, elf_data, elf_len);
-    heap_free(elf_data, elf_len);
+    int ret = exec_process(proc, file);
+    vm_file_put(file);
     return ret;
 }
 
@@ -378,28 +506,95 @@ static long do_waitpid(long pid, int *exit_code) {
     struct process *proc = pm_current(&g_pm);
     if (!proc) return -1;
 
-    int *kcode = NULL;
-    if (exit_code) {
-        kcode = as_translate(proc->as, (vaddr_t)exit_code, PTE_W | PTE_V);
-    }
-
     wait_result_t result = pm_wait(&g_pm, (pid_t)pid);
     if (!result.found) return -1;
 
-    if (kcode) *kcode = result.exit_code;
+    if (exit_code) {
+        as_copy_to_user(proc->as, (vaddr_t)exit_code, &result.exit_code, sizeof(int));
+    }
     return result.pid;
 }
 
+static long do_meminfo(meminfo_t *info) {
+    struct process *proc = pm_current(&g_pm);
+    if (!proc || !info) return -1;
+
+    heap_stats_t stats;
+    heap_get_stats(&stats);
+    meminfo_t kinfo;
+    kinfo.total = stats.total;
+    kinfo.used = stats.used;
+    kinfo.peak = stats.peak;
+    return as_copy_to_user(proc->as, (vaddr_t)info, &kinfo, sizeof(kinfo));
+}
+
+/* PROT_* 转换为用户页表项标志（RISC-V 不允许只写页，可写隐含可读） */
+static uint64_t prot_to_flags(int prot) {
+    uint64_t flags = PTE_U;
+    if (prot & PROT_READ) flags |= PTE_R;
+    if (prot & PROT_WRITE) flags |= PTE_R | PTE_W;
+    if (prot & PROT_EXEC) flags |= PTE_X;
+    return flags;
+}
+
+static long do_mmap(uintptr_t addr, size_t len, int prot, int flags, int fd, size_t offset) {
+    struct process *proc = pm_current(&g_pm);
+    if (!proc || len == 0 || (offset & PAGE_MASK)) return -1;
+    if (!(flags & (MAP_PRIVATE | MAP_SHARED))) return -1;
+
+    vm_file_t *file = NULL;
+    if (!(flags & MAP_ANONYMOUS)) {
+        /* 文件映射不写回：只允许私有映射或只读的共享映射 */
+        if ((flags & MAP_SHARED) && (prot & PROT_WRITE)) return -1;
+        if (fd < 0 || fd >= MAX_FD || !proc->fd_table[fd]) return -1;
+        file_handle_t *fh = proc->fd_table[fd];
+        if (!fh->inode || !fh->readable) return -1;
+
+        fh = file_dup(fh);
+        file = fh ? wrap_vm_file(fh) : NULL;
+        if (!file) return -1;
+    } else if (flags & MAP_SHARED) {
+        /* 匿名共享映射在 fork 后会变成写时复制，语义不符 */
+        return -1;
+    }
+
+    vaddr_t va = as_mmap(proc->as, addr, len, prot_to_flags(prot),
+                         (flags & MAP_FIXED) != 0, file, offset);
+    vm_file_put(file);
+    return va ? (long)va : -1;
+}
+
+static long do_munmap(uintptr_t addr, size_t len) {
+    struct process *proc = pm_current(&g_pm);
+    uintptr_t vpn_start, vpn_end;
+    if (!proc || !user_vpn_range(addr, len, &vpn_start, &vpn_end)) return -1;
+    return as_unmap(proc->as, vpn_start, vpn_end);
+}
+
+static long do_mprotect(uintptr_t addr, size_t len, int prot) {
+    struct process *proc = pm_current(&g_pm);
+    uintptr_t vpn_start, vpn_end;
+    if (!proc || !user_vpn_range(addr, len, &vpn_start, &vpn_end)) return -1;
+    return as_protect(proc->as, vpn_start, vpn_end, prot_to_flags(prot));
+}
+
 static syscall_io_t io_impl;
 static syscall_proc_t proc_impl;
 static syscall_sched_t sched_impl;
 static syscall_clock_t clock_impl;
+static syscall_mm_t mm_impl;
 
 static void init_syscall(void) {
     io_impl.write = do_write;
     io_impl.read = do_read;
     io_impl.open = do_open;
     io_impl.close = do_close;
+    io_impl.sync = do_sync;
+    io_impl.fsync = do_fsync;
+    io_impl.mkdirat = do_mkdirat;
+    io_impl.unlinkat = do_unlinkat;
+    io_impl.renameat2 = do_renameat2;
+    io_impl.getdents64 = do_getdents64;
 
     proc_impl.exit = do_exit;
     proc_impl.fork = do_fork;
@@ -409,11 +604,16 @@ static void init_syscall(void) {
 
     sched_impl.sched_yield = do_sched_yield;
     clock_impl.clock_gettime = do_clock_gettime;
+    mm_impl.meminfo = do_meminfo;
+    mm_impl.mmap = do_mmap;
+    mm_impl.munmap = do_munmap;
+    mm_impl.mprotect = do_mprotect;
 
     syscall_set_io(&io_impl);
     syscall_set_proc(&proc_impl);
     syscall_set_sched(&sched_impl);
     syscall_set_clock(&clock_impl);
+    syscall_set_mm(&mm_impl);
 }
 
 /* ============================================================================
@@ -462,7 +662,10 @@ void main(void) {
            (void *)heap_start, (void *)g_memory_end, (int)(heap_size / 1024));
 
     /* 初始化块缓存 */
-    block_cache_init();
+    if (block_cache_init(BLOCK_CACHE_DEFAULT_CAPACITY) != 0) {
+        puts("[PANIC] block cache init failed!");
+        shutdown();
+    }
 
     /* 初始化 VirtIO 块设备 */
     if (virtio_blk_init(&g_virtio_blk) != 0) {
@@ -494,7 +697,7 @@ void main(void) {
 
     /* 创建内核地址空间 */
     kernel_as = as_create();
-    map_kernel_to_user(kernel_as);
+    map_kernel_space(kernel_as);
     printf("[INFO] kernel space created\n");
 
     /* 初始化进程管理器 */
@@ -504,22 +707,14 @@ void main(void) {
     init_syscall();
 
     /* 从文件系统加载 initproc */
-    file_handle_t *initproc_fh = file_open(g_fs, "initproc", O_RDONLY);
-    if (!initproc_fh) {
+    vm_file_t *initproc_file = open_vm_file("initproc");
+    if (!initproc_file) {
         puts("[PANIC] initproc not found in fs!");
         shutdown();
     }
-    size_t initproc_len = 0;
-    uint8_t *initproc_data = read_all(initproc_fh, &initproc_len);
-    file_close(initproc_fh);
 
-    if (!initproc_data) {
-        puts("[PANIC] failed to read initproc!");
-        shutdown();
-    }
-
-    struct process *init = create_process_from_elf(initproc_data, initproc_len);
-    heap_free(initproc_data, initproc_len);
+    struct process *init = create_process_from_elf(initproc_file);
+    vm_file_put(initproc_file);
 
     if (!init) {
         puts("[PANIC] failed to create initproc!");
@@ -531,7 +726,8 @@ void main(void) {
     puts("");
 
     /* 启用分页 */
-    write_satp(make_satp(as_root_ppn(kernel_as)));
+    write_satp(make_satp(as_root_ppn(kernel_as), 0));
+    asid_init();
     puts("[INFO] paging enabled\n");
 
     /* 调度循环 */
@@ -542,11 +738,15 @@ void main(void) {
             break;
         }
 
+        proc->ctx.satp = as_activate(proc->as);
         foreign_ctx_run(&proc->ctx);
 
         uintptr_t scause = read_scause();
         uintptr_t code = cause_code(scause);
 
+        /* 每次陷入内核时检查是否到了块缓存的写回周期 */
+        block_cache_tick();
+
         if (is_exception(scause) && code == EXCEP_U_ECALL) {
             context_t *ctx = &proc->ctx.ctx;
             ctx_move_next(ctx);
@@ -560,26 +760,31 @@ void main(void) {
             syscall_result_t ret = syscall_dispatch(id, args);
 
             if (id == SYS_EXIT) {
-                pm_exit_current(&g_pm, (int)args[0]);
+                exit_current((int)args[0]);
             } else if (ret.status == SYSCALL_OK) {
                 ctx_set_arg(ctx, 0, ret.value);
                 pm_suspend_current(&g_pm);
             } else {
                 printf("[ERROR] pid=%d unsupported syscall %d\n",
                        (int)proc->pid, (int)id);
-                pm_exit_current(&g_pm, -2);
+                exit_current(-2);
             }
+        } else if (is_exception(scause) && as_fault_access(code) &&
+                   as_handle_fault(proc->as, read_stval(), as_fault_access(code)) == 0) {
+            /* 缺页已处理（按需调页 / 写时复制），重新执行该指令 */
+            pm_suspend_current(&g_pm);
         } else if (is_exception(scause)) {
             printf("[ERROR] pid=%d killed: %s, stval=%p, sepc=%p\n",
                    (int)proc->pid, exception_name(code),
                    (void *)read_stval(), (void *)ctx_pc(&proc->ctx.ctx));
-            pm_exit_current(&g_pm, -3);
+            exit_current(-3);
         } else {
             printf("[ERROR] pid=%d killed: unexpected interrupt %d\n",
                    (int)proc->pid, (int)code);
-            pm_exit_current(&g_pm, -3);
+            exit_current(-3);
         }
     }
 
+    block_cache_flush(g_block_dev);
     shutdown();
 }
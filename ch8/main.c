@@ -9,6 +9,7 @@
 #include <string.h>
 
 #include "../kernel-alloc/heap.h"
+#include "../kernel-alloc/slab.h"
 #include "../kernel-context/context.h"
 #include "../kernel-vm/address_space.h"
 #include "../kernel-vm/elf.h"
@@ -16,10 +17,15 @@
 #include "../linker/linker.h"
 #include "../syscall/syscall.h"
 #include "../util/printf.h"
+#ifdef MEM_BENCH
+#include "../util/mem_bench.h"
+#endif
+#include "../util/plic.h"
 #include "../util/riscv.h"
 #include "../util/sbi.h"
 #include "../easy-fs/easy_fs.h"
 #include "../virtio-block/virtio_block.h"
+#include "../io-sched/io_sched.h"
 #include "../signal/signal.h"
 #include "../sync/sync.h"
 
@@ -33,10 +39,27 @@
 #define MAX_FD          16
 #define MAX_THREADS     16
 #define MAX_SYNC_OBJS   16
+#define PATH_MAX_LEN    256     /* 路径参数的最大长度（含结尾的 '\0'） */
+#define GETDENTS_BUF_SIZE 512   /* getdents64 单次返回的最大字节数 */
 
 #define VIRTIO_MMIO_BASE 0x10001000
 #define VIRTIO_MMIO_SIZE 0x1000
 
+/* 块设备 I/O 调度策略，可用 make IO_SCHED=noop|deadline|elevator 选择 */
+#ifndef IO_SCHED_POLICY
+#define IO_SCHED_POLICY  IO_SCHED_ELEVATOR
+#endif
+
+/* 顺序读预读窗口上限（块），可用 make READAHEAD=N 设置，0 关闭预读 */
+#ifndef READAHEAD_MAX
+#define READAHEAD_MAX    READAHEAD_DEFAULT_MAX
+#endif
+
+/* 单次文件读中可睡眠等待磁盘的最大字节数，更长的读在需要等待时被截短 */
+#define READ_ASYNC_MAX   (16 * BLOCK_SZ)
+/* do_read 的特殊返回值：数据正在异步读入，线程睡眠，唤醒后重新执行该系统调用 */
+#define READ_WOULD_BLOCK (-2)
+
 /* ============================================================================
  * 全局状态
  * ========================================================================== */
@@ -46,6 +69,7 @@ static uintptr_t g_memory_end;
 static address_space_t *kernel_as;
 
 static virtio_blk_t g_virtio_blk;
+static io_sched_t g_io_sched;
 static block_device_t *g_block_dev;
 static easy_fs_t *g_fs;
 static inode_t *g_root;
@@ -87,9 +111,14 @@ typedef struct process {
     /* 等待子进程 */
     pid_t waiting_for;  /* 正在等待的子进程 pid，-1 表示任意，PID_INVALID 表示不在等待 */
     tid_t waiting_tid;  /* 等待中的线程 */
-    int *waiting_exit_code_ptr;  /* 内核地址空间中的 exit_code 指针 */
+    vaddr_t waiting_exit_code;  /* 用户地址空间中的 exit_code 地址，0 表示不需要 */
 } process_t;
 
+/* 同步原语对象缓存 */
+static kmem_cache_t g_mutex_cache = KMEM_CACHE_INIT("mutex", mutex_t, NULL);
+static kmem_cache_t g_semaphore_cache = KMEM_CACHE_INIT("semaphore", semaphore_t, NULL);
+static kmem_cache_t g_condvar_cache = KMEM_CACHE_INIT("condvar", condvar_t, NULL);
+
 static thread_t g_thread_pool[MAX_PROCS * MAX_THREADS];
 static process_t g_process_pool[MAX_PROCS];
 static tid_t g_next_tid = 0;
@@ -101,6 +130,11 @@ static tid_t g_ready_queue[READY_QUEUE_SIZE];
 static int g_ready_head = 0, g_ready_tail = 0, g_ready_count = 0;
 static tid_t g_current_tid = TID_INVALID;
 
+/* 睡眠等待磁盘 I/O 的线程，任一磁盘中断到来时全部唤醒（被唤醒后自行重试） */
+static tid_t g_io_waiters[MAX_PROCS * MAX_THREADS];
+static int g_io_waiter_count = 0;
+static size_t g_io_sleeps = 0;
+
 /* ============================================================================
  * 调度器
  * ========================================================================== */
@@ -121,6 +155,30 @@ static tid_t ready_dequeue(void) {
     return tid;
 }
 
+static void io_wait(tid_t tid) {
+    g_io_waiters[g_io_waiter_count++] = tid;
+    g_io_sleeps++;
+}
+
+static void io_wake_all(void) {
+    for (int i = 0; i < g_io_waiter_count; i++) {
+        ready_enqueue(g_io_waiters[i]);
+    }
+    g_io_waiter_count = 0;
+}
+
+/* 处理外部中断：回收完成的磁盘请求并唤醒等待 I/O 的线程 */
+static void handle_external_interrupt(void) {
+    uint32_t irq;
+    while ((irq = plic_claim()) != 0) {
+        if (irq == VIRTIO0_IRQ) {
+            virtio_blk_handle_irq(&g_virtio_blk);
+        }
+        plic_complete(irq);
+    }
+    io_wake_all();
+}
+
 static thread_t *get_thread(tid_t tid) {
     if (tid >= MAX_PROCS * MAX_THREADS) return NULL;
     return &g_thread_pool[tid];
@@ -145,47 +203,225 @@ static process_t *current_process(void) {
  * 辅助函数
  * ========================================================================== */
 
+/* 建立内核地址空间的映射，只在启动时对 kernel_as 做一次 */
+static void map_kernel_space(address_space_t *as) {
+    as_map_extern(as, va_vpn(g_layout.text), va_vpn(g_layout.rodata),
+                  pa_ppn(g_layout.text), PTE_V | PTE_R | PTE_X | PTE_G);
+    as_map_extern(as, va_vpn(g_layout.rodata), va_vpn(g_layout.data),
+                  pa_ppn(g_layout.rodata), PTE_V | PTE_R | PTE_G);
+    as_map_extern(as, va_vpn(g_layout.data), va_vpn(g_memory_end),
+                  pa_ppn(g_layout.data), PTE_V | PTE_R | PTE_W | PTE_G);
+    as_map_extern(as, va_vpn(VIRTIO_MMIO_BASE),
+                  va_vpn(VIRTIO_MMIO_BASE + VIRTIO_MMIO_SIZE),
+                  pa_ppn(VIRTIO_MMIO_BASE), PTE_V | PTE_R | PTE_W | PTE_G);
+    as_map_extern(as, va_vpn(PLIC_BASE), va_vpn(PLIC_BASE + PLIC_SIZE),
+                  pa_ppn(PLIC_BASE), PTE_V | PTE_R | PTE_W | PTE_G);
+}
+
+/* 用户地址空间直接链接 kernel_as 中的内核根页表项 */
 static void map_kernel_to_user(address_space_t *user_as) {
-    as_map_extern(user_as, va_vpn(g_layout.text), va_vpn(g_layout.rodata),
-                  pa_ppn(g_layout.text), PTE_V | PTE_R | PTE_X);
-    as_map_extern(user_as, va_vpn(g_layout.rodata), va_vpn(g_layout.data),
-                  pa_ppn(g_layout.rodata), PTE_V | PTE_R);
-    as_map_extern(user_as, va_vpn(g_layout.data), va_vpn(g_memory_end),
-                  pa_ppn(g_layout.data), PTE_V | PTE_R | PTE_W);
+    as_share_kernel(user_as, kernel_as, g_layout.text, g_memory_end);
+
+    /* MMIO 与用户程序同处根页表第 0 项，无法共享，逐进程映射 */
     as_map_extern(user_as, va_vpn(VIRTIO_MMIO_BASE),
                   va_vpn(VIRTIO_MMIO_BASE + VIRTIO_MMIO_SIZE),
-                  pa_ppn(VIRTIO_MMIO_BASE), PTE_V | PTE_R | PTE_W);
+                  pa_ppn(VIRTIO_MMIO_BASE), PTE_V | PTE_R | PTE_W | PTE_G);
+    as_map_extern(user_as, va_vpn(PLIC_BASE), va_vpn(PLIC_BASE + PLIC_SIZE),
+                  pa_ppn(PLIC_BASE), PTE_V | PTE_R | PTE_W | PTE_G);
 }
 
-static uint8_t *read_all_file(file_handle_t *fh, size_t *out_len) {
-    if (!fh || !fh->inode) return NULL;
-    uint32_t size = inode_size(fh->inode);
-    uint8_t *data = heap_alloc(size, 8);
-    if (!data) return NULL;
-    size_t total = 0;
-    uint8_t buf[512];
-    while (total < size) {
-        size_t n = file_read(fh, buf, 512);
-        if (n == 0) break;
-        memcpy(data + total, buf, n);
-        total += n;
+/* 打印各对象缓存的统计 */
+static void print_kmem_stats(void) {
+    for (const kmem_cache_t *c = kmem_cache_next(NULL); c; c = kmem_cache_next(c)) {
+        kmem_stats_t st;
+        kmem_cache_get_stats(c, &st);
+        printf("[KMEM] %s: hit=%d miss=%d in_use=%d slabs=%d\n", c->name,
+               (int)st.hits, (int)st.misses, (int)st.in_use, (int)st.slabs);
     }
-    *out_len = total;
-    return data;
+}
+
+/* 打印延迟直方图的非空桶：<2^(i+1) 个 time 计数 (80 ns) */
+static void print_latency_hist(const char *name, const size_t *hist) {
+    printf("[IOSCHED] %s latency:", name);
+    for (int i = 0; i < IO_SCHED_HIST_BUCKETS; i++) {
+        if (hist[i]) printf(" <2^%d:%d", i + 1, (int)hist[i]);
+    }
+    printf("\n");
+}
+
+/* 打印块缓存统计 */
+static void print_block_cache_stats(void) {
+    block_cache_stats_t st;
+    block_cache_get_stats(&st);
+    printf("[BCACHE] hit=%d miss=%d evict=%d writeback=%d direct_r=%d direct_w=%d\n",
+           (int)st.hits, (int)st.misses, (int)st.evictions, (int)st.writebacks,
+           (int)st.direct_reads, (int)st.direct_writes);
+    printf("[BCACHE] dirty_peak=%d flushes=%d flush_max=%d flush_avg=%d ticks\n",
+           (int)st.dirty_peak, (int)st.flushes, (int)st.flush_time_max,
+           st.flushes ? (int)(st.flush_time_total / st.flushes) : 0);
+    printf("[VIRTIO] queue=%d requests=%d notifies=%d skipped=%d max_inflight=%d batches=%d\n",
+           (int)g_virtio_blk.queue_size, (int)g_virtio_blk.requests,
+           (int)g_virtio_blk.notifies, (int)g_virtio_blk.notifies_skipped,
+           (int)g_virtio_blk.max_inflight, (int)st.batch_submits);
+    printf("[VIRTIO] irqs=%d async_reads=%d readahead=%d io_sleeps=%d io_spins=%d\n",
+           (int)g_virtio_blk.irqs, (int)st.async_reads, (int)st.readahead,
+           (int)g_io_sleeps, (int)st.io_waits);
+
+    name_cache_stats_t nst;
+    name_cache_get_stats(&nst);
+    printf("[NAMEI] inode hit=%d miss=%d, dentry hit=%d negative=%d miss=%d\n",
+           (int)nst.inode_hits, (int)nst.inode_misses, (int)nst.dentry_hits,
+           (int)nst.dentry_negative_hits, (int)nst.dentry_misses);
+
+    journal_stats_t jst;
+    if (efs_journal_get_stats(g_fs, &jst) == 0) {
+        printf("[JOURNAL] commits=%d logged=%d revokes=%d checkpoints=%d overflows=%d early=%d\n",
+               (int)jst.commits, (int)jst.logged_blocks, (int)jst.revokes,
+               (int)jst.checkpoints, (int)jst.overflows, (int)jst.early_commits);
+    }
+
+    io_sched_stats_t ist;
+    io_sched_get_stats(&g_io_sched, &ist);
+    printf("[IOSCHED] %s: requests=%d dispatched=%d merged=%d\n",
+           io_sched_policy_name(g_io_sched.policy), (int)ist.requests,
+           (int)ist.dispatched, (int)ist.merged);
+    print_latency_hist("read", ist.read_hist);
+    print_latency_hist("write", ist.write_hist);
+}
+
+/* 以打开的文件作为懒加载页的后备存储 */
+typedef struct {
+    vm_file_t base;
+    file_handle_t *fh;
+} fs_vm_file_t;
+
+static size_t fs_vm_read(vm_file_t *file, size_t offset, void *buf, size_t len) {
+    fs_vm_file_t *f = (fs_vm_file_t *)file;
+    return inode_read_at(f->fh->inode, offset, buf, len);
+}
+
+static void fs_vm_release(vm_file_t *file) {
+    fs_vm_file_t *f = (fs_vm_file_t *)file;
+    file_close(f->fh);
+    heap_free(f, sizeof(fs_vm_file_t));
+}
+
+/* 包装一个文件句柄，句柄归返回的 vm_file 所有（失败时关闭） */
+static vm_file_t *wrap_vm_file(file_handle_t *fh) {
+    fs_vm_file_t *f = heap_alloc(sizeof(fs_vm_file_t), 8);
+    if (!f) {
+        file_close(fh);
+        return NULL;
+    }
+    vm_file_init(&f->base, fs_vm_read, fs_vm_release);
+    f->fh = fh;
+    return &f->base;
+}
+
+static vm_file_t *open_vm_file(const char *name) {
+    file_handle_t *fh = file_open(g_fs, name, O_RDONLY);
+    if (!fh) return NULL;
+    return wrap_vm_file(fh);
 }
 
 /* ============================================================================
  * 进程/线程创建
  * ========================================================================== */
 
+/* 优先复用已回收的槽位：线程槽位在所属进程被回收后 pid 置为 PID_INVALID */
 static tid_t alloc_tid(void) {
+    for (tid_t i = 0; i < g_next_tid; i++) {
+        thread_t *t = &g_thread_pool[i];
+        if (t->exited && t->pid == PID_INVALID) return i;
+    }
     return g_next_tid++;
 }
 
+/* 已退出且已被父进程回收（或无父进程）的进程槽位可以复用 */
 static pid_t alloc_pid(void) {
+    for (pid_t i = 0; i < g_next_pid; i++) {
+        process_t *p = &g_process_pool[i];
+        if (p->exited && p->parent == PID_INVALID) return i;
+    }
     return g_next_pid++;
 }
 
+/* 所有线程退出后，同步对象不再有人使用，归还对象缓存 */
+static void free_sync_objects(process_t *proc) {
+    for (int i = 0; i < MAX_SYNC_OBJS; i++) {
+        if (proc->mutexes[i]) kmem_cache_free(&g_mutex_cache, proc->mutexes[i]);
+        if (proc->semaphores[i]) kmem_cache_free(&g_semaphore_cache, proc->semaphores[i]);
+        if (proc->condvars[i]) kmem_cache_free(&g_condvar_cache, proc->condvars[i]);
+        proc->mutexes[i] = NULL;
+        proc->semaphores[i] = NULL;
+        proc->condvars[i] = NULL;
+    }
+}
+
+/* 回收进程槽位及其线程槽位 */
+static void release_process(process_t *proc) {
+    proc->parent = PID_INVALID;
+    for (int i = 0; i < proc->thread_count; i++) {
+        thread_t *t = get_thread(proc->threads[i]);
+        if (t && t->exited) t->pid = PID_INVALID;
+    }
+}
+
+/* 进程的所有线程都已退出：回收地址空间、文件与同步对象，处理子进程并唤醒等待的父进程 */
+static void exit_process(process_t *proc, int exit_code) {
+    proc->exited = true;
+    proc->exit_code = exit_code;
+    as_destroy(proc->as);
+    proc->as = NULL;
+    for (int i = 0; i < MAX_FD; i++) {
+        if (proc->fd_table[i]) {
+            file_close(proc->fd_table[i]);
+            proc->fd_table[i] = NULL;
+        }
+    }
+    free_sync_objects(proc);
+    /* 子进程不再有父进程等待，退出后即可回收 */
+    for (pid_t i = 0; i < g_next_pid; i++) {
+        process_t *child = &g_process_pool[i];
+        if (child != proc && child->parent == proc->pid) {
+            if (child->exited) release_process(child);
+            else child->parent = PID_INVALID;
+        }
+    }
+    /* 唤醒等待的父进程 */
+    if (proc->parent != PID_INVALID) {
+        process_t *parent = get_process(proc->parent);
+        if (parent && parent->waiting_tid != TID_INVALID) {
+            if (parent->waiting_for == (pid_t)-1 || parent->waiting_for == proc->pid) {
+                /* 设置父进程线程的返回值 */
+                thread_t *pt = get_thread(parent->waiting_tid);
+                if (pt) {
+                    ctx_set_arg(&pt->ctx.ctx, 0, proc->pid);
+                    /* 写入 exit_code */
+                    if (parent->waiting_exit_code) {
+                        as_copy_to_user(parent->as, parent->waiting_exit_code,
+                                        &proc->exit_code, sizeof(int));
+                    }
+                }
+                ready_enqueue(parent->waiting_tid);
+                parent->waiting_tid = TID_INVALID;
+                parent->waiting_for = PID_INVALID;
+                parent->waiting_exit_code = 0;
+                release_process(proc);
+            }
+        }
+    }
+}
+
+/* 杀死整个进程（信号、异常等），其余线程一并结束 */
+static void kill_process(process_t *proc, int exit_code) {
+    for (int i = 0; i < proc->thread_count; i++) {
+        thread_t *t = get_thread(proc->threads[i]);
+        if (t) t->exited = true;
+    }
+    exit_process(proc, exit_code);
+}
+
 static thread_t *create_thread(pid_t pid, uintptr_t entry, uintptr_t sp, uintptr_t satp) {
     tid_t tid = alloc_tid();
     if (tid >= MAX_PROCS * MAX_THREADS) return NULL;
@@ -202,7 +438,7 @@ static thread_t *create_thread(pid_t pid, uintptr_t entry, uintptr_t sp, uintptr
     return t;
 }
 
-static bool create_process_from_elf(const uint8_t *elf_data, size_t elf_len,
+static bool create_process_from_elf(vm_file_t *file,
                                     process_t **out_proc, thread_t **out_thread) {
     pid_t pid = alloc_pid();
     if (pid >= MAX_PROCS) return false;
@@ -216,7 +452,7 @@ static bool create_process_from_elf(const uint8_t *elf_data, size_t elf_len,
 
     map_kernel_to_user(proc->as);
 
-    uintptr_t entry = elf_load(proc->as, elf_data, elf_len);
+    uintptr_t entry = elf_load_lazy(proc->as, file);
     if (!entry) {
         as_destroy(proc->as);
         return false;
@@ -224,27 +460,21 @@ static bool create_process_from_elf(const uint8_t *elf_data, size_t elf_len,
 
     uintptr_t stack_vpn_end = va_vpn(USER_STACK_TOP);
     uintptr_t stack_vpn_start = stack_vpn_end - (USER_STACK_SIZE / PAGE_SIZE);
-    as_map(proc->as, stack_vpn_start, stack_vpn_end, NULL, 0, 0,
-           PTE_V | PTE_R | PTE_W | PTE_U);
+    as_map_anon(proc->as, stack_vpn_start, stack_vpn_end,
+                PTE_V | PTE_R | PTE_W | PTE_U);
 
-    uintptr_t satp = make_satp(as_root_ppn(proc->as));
+    uintptr_t satp = as_activate(proc->as);
 
     /* 初始化 fd_table */
-    proc->fd_table[0] = heap_alloc(sizeof(file_handle_t), 8);
-    proc->fd_table[0]->inode = NULL;
-    proc->fd_table[0]->readable = true;
-    proc->fd_table[0]->writable = false;
-    proc->fd_table[1] = heap_alloc(sizeof(file_handle_t), 8);
-    proc->fd_table[1]->inode = NULL;
-    proc->fd_table[1]->readable = false;
-    proc->fd_table[1]->writable = true;
+    proc->fd_table[0] = file_alloc(NULL, true, false);
+    proc->fd_table[1] = file_alloc(NULL, false, true);
 
     signal_init(&proc->signal);
     proc->parent = PID_INVALID;
     proc->exited = false;
     proc->waiting_for = PID_INVALID;
     proc->waiting_tid = TID_INVALID;
-    proc->waiting_exit_code_ptr = NULL;
+    proc->waiting_exit_code = 0;
 
     /* 创建主线程 */
     thread_t *t = create_thread(pid, entry, USER_STACK_TOP, satp);
@@ -266,8 +496,8 @@ static long do_open(const char *path, uint32_t flags) {
     process_t *proc = current_process();
     if (!proc) return -1;
 
-    const char *kpath = as_translate(proc->as, (vaddr_t)path, PTE_R | PTE_V);
-    if (!kpath) return -1;
+    char kpath[PATH_MAX_LEN];
+    if (as_copy_str_from_user(proc->as, kpath, (vaddr_t)path, sizeof(kpath)) < 0) return -1;
 
     int fd = -1;
     for (int i = 0; i < MAX_FD; i++) {
@@ -293,47 +523,160 @@ static long do_close(int fd) {
     return -1;
 }
 
-static long do_write(int fd, const void *buf, size_t count) {
+/* 块缓存不区分文件，fsync 同步全部脏块 */
+static long do_fsync(int fd) {
+    process_t *proc = current_process();
+    if (!proc || fd < 0 || fd >= MAX_FD || !proc->fd_table[fd]) return -1;
+    return block_cache_flush(g_block_dev);
+}
+
+static long do_sync(void) {
+    return block_cache_flush(g_block_dev);
+}
+
+/* dirfd 为 AT_FDCWD 时相对根目录，否则相对已打开的目录 */
+static bool dirfd_base(process_t *proc, int dirfd, inode_t **base) {
+    if (dirfd == AT_FDCWD) {
+        *base = NULL;
+        return true;
+    }
+    if (dirfd < 0 || dirfd >= MAX_FD || !proc->fd_table[dirfd] || !proc->fd_table[dirfd]->inode) {
+        return false;
+    }
+    *base = proc->fd_table[dirfd]->inode;
+    return true;
+}
+
+/* 没有权限模型，mode 被忽略 */
+static long do_mkdirat(int dirfd, const char *path, uint32_t mode) {
+    (void)mode;
     process_t *proc = current_process();
     if (!proc) return -1;
 
-    const char *kbuf = as_translate(proc->as, (vaddr_t)buf, PTE_R | PTE_V);
-    if (!kbuf) return -1;
+    char kpath[PATH_MAX_LEN];
+    inode_t *base;
+    if (as_copy_str_from_user(proc->as, kpath, (vaddr_t)path, sizeof(kpath)) < 0 ||
+        !dirfd_base(proc, dirfd, &base)) {
+        return -1;
+    }
+    return efs_mkdir(g_fs, base, kpath);
+}
+
+static long do_unlinkat(int dirfd, const char *path, uint32_t flags) {
+    process_t *proc = current_process();
+    if (!proc) return -1;
 
-    if (fd == FD_STDOUT || fd == FD_STDERR) {
-        for (size_t i = 0; i < count; i++) console_putchar(kbuf[i]);
-        return count;
+    char kpath[PATH_MAX_LEN];
+    inode_t *base;
+    if (as_copy_str_from_user(proc->as, kpath, (vaddr_t)path, sizeof(kpath)) < 0 ||
+        !dirfd_base(proc, dirfd, &base)) {
+        return -1;
     }
+    return efs_unlink(g_fs, base, kpath, (flags & AT_REMOVEDIR) != 0);
+}
 
-    if (fd < 0 || fd >= MAX_FD || !proc->fd_table[fd]) return -1;
-    file_handle_t *fh = proc->fd_table[fd];
-    if (!fh->writable) return -1;
-    return file_write(fh, (const uint8_t *)kbuf, count);
+/* 不支持 RENAME_NOREPLACE 等标志 */
+static long do_renameat2(int olddirfd, const char *oldpath, int newdirfd, const char *newpath,
+                         uint32_t flags) {
+    process_t *proc = current_process();
+    if (!proc || flags != 0) return -1;
+
+    char kold[PATH_MAX_LEN], knew[PATH_MAX_LEN];
+    inode_t *old_base, *new_base;
+    if (as_copy_str_from_user(proc->as, kold, (vaddr_t)oldpath, sizeof(kold)) < 0 ||
+        as_copy_str_from_user(proc->as, knew, (vaddr_t)newpath, sizeof(knew)) < 0 ||
+        !dirfd_base(proc, olddirfd, &old_base) ||
+        !dirfd_base(proc, newdirfd, &new_base)) {
+        return -1;
+    }
+    return efs_rename(g_fs, old_base, kold, new_base, knew);
+}
+
+static long do_getdents64(int fd, void *buf, size_t len) {
+    process_t *proc = current_process();
+    if (!proc || fd < 0 || fd >= MAX_FD || !proc->fd_table[fd]) return -1;
+
+    /* 目录项不能跨页拆开写，先写入内核缓冲区再复制（每次最多返回一缓冲区） */
+    uint8_t kbuf[GETDENTS_BUF_SIZE];
+    if (len > sizeof(kbuf)) len = sizeof(kbuf);
+    ssize_t n = file_getdents64(proc->fd_table[fd], kbuf, len);
+    if (n > 0 && as_copy_to_user(proc->as, (vaddr_t)buf, kbuf, n) != 0) return -1;
+    return n;
+}
+
+static long do_write(int fd, const void *buf, size_t count) {
+    process_t *proc = current_process();
+    if (!proc) return -1;
+
+    file_handle_t *fh = NULL;
+    if (fd != FD_STDOUT && fd != FD_STDERR) {
+        if (fd < 0 || fd >= MAX_FD || !proc->fd_table[fd]) return -1;
+        fh = proc->fd_table[fd];
+        if (!fh->writable) return -1;
+    }
+
+    /* 用户缓冲区逐页访问：相邻虚拟页不一定物理连续 */
+    size_t done = 0;
+    while (done < count) {
+        size_t n;
+        const char *kbuf = as_translate_span(proc->as, (vaddr_t)buf + done, count - done,
+                                             PTE_R | PTE_V, &n);
+        if (!kbuf) return done ? (long)done : -1;
+
+        if (!fh) {
+            for (size_t i = 0; i < n; i++) console_putchar(kbuf[i]);
+            done += n;
+            continue;
+        }
+        ssize_t w = file_write(fh, (const uint8_t *)kbuf, n);
+        if (w < 0) return done ? (long)done : -1;
+        done += w;
+        if ((size_t)w < n) break;
+    }
+    return done;
 }
 
 static long do_read(int fd, void *buf, size_t count) {
     process_t *proc = current_process();
     if (!proc) return -1;
 
-    char *kbuf = as_translate(proc->as, (vaddr_t)buf, PTE_W | PTE_V);
-    if (!kbuf) return -1;
+    file_handle_t *fh = NULL;
+    if (fd != FD_STDIN) {
+        if (fd < 0 || fd >= MAX_FD || !proc->fd_table[fd]) return -1;
+        fh = proc->fd_table[fd];
+        if (!fh->readable) return -1;
+
+        /* 需要的块先异步读入，期间线程睡眠，让出 CPU 给其他线程 */
+        if (count > READ_ASYNC_MAX) count = READ_ASYNC_MAX;
+        if (file_prefetch(fh, count) > 0) return READ_WOULD_BLOCK;
+    }
 
-    if (fd == FD_STDIN) {
-        for (size_t i = 0; i < count; i++) {
-            int c;
-            /* 等待有效输入（console_getchar 在无输入时返回 -1） */
-            while ((c = console_getchar()) < 0) {
-                /* 忙等待 */
+    /* 用户缓冲区逐页访问，每页单独调入并完成写时复制 */
+    size_t done = 0;
+    while (done < count) {
+        size_t n;
+        char *kbuf = as_translate_span(proc->as, (vaddr_t)buf + done, count - done,
+                                       PTE_W | PTE_V, &n);
+        if (!kbuf) return done ? (long)done : -1;
+
+        if (!fh) {
+            for (size_t i = 0; i < n; i++) {
+                int c;
+                /* 等待有效输入（console_getchar 在无输入时返回 -1） */
+                while ((c = console_getchar()) < 0) {
+                    /* 忙等待 */
+                }
+                kbuf[i] = (char)c;
             }
-            kbuf[i] = (char)c;
+            done += n;
+            continue;
         }
-        return count;
+        ssize_t r = file_read(fh, (uint8_t *)kbuf, n);
+        if (r < 0) return done ? (long)done : -1;
+        done += r;
+        if ((size_t)r < n) break;
     }
-
-    if (fd < 0 || fd >= MAX_FD || !proc->fd_table[fd]) return -1;
-    file_handle_t *fh = proc->fd_table[fd];
-    if (!fh->readable) return -1;
-    return file_read(fh, (uint8_t *)kbuf, count);
+    return done;
 }
 
 static void do_exit(int code) { (void)code; }
@@ -344,14 +687,28 @@ static long do_clock_gettime(int clock_id, timespec_t *tp) {
     if (clock_id == CLOCK_MONOTONIC && tp) {
         process_t *proc = current_process();
         if (!proc) return -1;
-        timespec_t *ktp = as_translate(proc->as, (vaddr_t)tp, PTE_W | PTE_V);
-        if (!ktp) return -1;
         uint64_t time = read_time();
         uint64_t ns = time * 80;
-        ktp->tv_sec = ns / 1000000000UL;
-        ktp->tv_nsec = ns % 1000000000UL;
-        return 0;
+        timespec_t ts;
+        ts.tv_sec = ns / 1000000000UL;
+        ts.tv_nsec = ns % 1000000000UL;
+        return as_copy_to_user(proc->as, (vaddr_t)tp, &ts, sizeof(ts));
+    }
+    return -1;
+}
+
+/* fork 中途失败：放回已取得的地址空间与文件，槽位标记为可复用 */
+static long fork_abort(process_t *child) {
+    as_destroy(child->as);
+    child->as = NULL;
+    for (int i = 0; i < MAX_FD; i++) {
+        if (child->fd_table[i]) {
+            file_close(child->fd_table[i]);
+            child->fd_table[i] = NULL;
+        }
     }
+    child->exited = true;
+    child->parent = PID_INVALID;
     return -1;
 }
 
@@ -367,27 +724,25 @@ static long do_fork(void) {
     memset(child, 0, sizeof(process_t));
     child->pid = pid;
     child->as = as_clone(parent->as);
-    if (!child->as) return -1;
+    if (!child->as) return fork_abort(child);
 
     /* 复制 fd_table */
     for (int i = 0; i < MAX_FD; i++) {
         if (parent->fd_table[i]) {
-            child->fd_table[i] = heap_alloc(sizeof(file_handle_t), 8);
-            memcpy(child->fd_table[i], parent->fd_table[i], sizeof(file_handle_t));
-            if (parent->fd_table[i]->inode) {
-                child->fd_table[i]->inode = heap_alloc(sizeof(inode_t), 8);
-                memcpy(child->fd_table[i]->inode, parent->fd_table[i]->inode, sizeof(inode_t));
-            }
+            child->fd_table[i] = file_dup(parent->fd_table[i]);
+            if (!child->fd_table[i]) return fork_abort(child);
         }
     }
 
     signal_fork(&child->signal, &parent->signal);
     child->parent = parent->pid;
+    child->waiting_for = PID_INVALID;
+    child->waiting_tid = TID_INVALID;
 
     /* 创建子线程 */
-    uintptr_t satp = make_satp(as_root_ppn(child->as));
+    uintptr_t satp = as_activate(child->as);
     thread_t *child_thread = create_thread(pid, 0, 0, satp);
-    if (!child_thread) return -1;
+    if (!child_thread) return fork_abort(child);
 
     child_thread->ctx.ctx = parent_thread->ctx.ctx;
     child_thread->ctx.satp = satp;
@@ -404,41 +759,41 @@ static long do_exec(const char *path, size_t len) {
     process_t *proc = current_process();
     if (!proc) return -1;
 
-    const char *kpath = as_translate(proc->as, (vaddr_t)path, PTE_R | PTE_V);
-    if (!kpath) return -1;
-
     char name[32];
     if (len > 31) len = 31;
-    memcpy(name, kpath, len);
+    if (as_copy_from_user(proc->as, name, (vaddr_t)path, len) != 0) return -1;
     name[len] = '\0';
 
-    file_handle_t *fh = file_open(g_fs, name, O_RDONLY);
-    if (!fh) return -1;
-
-    size_t elf_len;
-    uint8_t *elf_data = read_all_file(fh, &elf_len);
-    file_close(fh);
-    if (!elf_data) return -1;
+    /* 程序页在首次访问时才从文件读入 */
+    vm_file_t *file = open_vm_file(name);
+    if (!file) return -1;
 
     /* 创建新地址空间 */
     address_space_t *new_as = as_create();
-    if (!new_as) { heap_free(elf_data, elf_len); return -1; }
+    if (!new_as) { vm_file_put(file); return -1; }
 
     map_kernel_to_user(new_as);
-    uintptr_t entry = elf_load(new_as, elf_data, elf_len);
-    heap_free(elf_data, elf_len);
+    uintptr_t entry = elf_load_lazy(new_as, file);
+    vm_file_put(file);
     if (!entry) { as_destroy(new_as); return -1; }
 
     uintptr_t stack_vpn_end = va_vpn(USER_STACK_TOP);
     uintptr_t stack_vpn_start = stack_vpn_end - (USER_STACK_SIZE / PAGE_SIZE);
-    as_map(new_as, stack_vpn_start, stack_vpn_end, NULL, 0, 0, PTE_V | PTE_R | PTE_W | PTE_U);
+    as_map_anon(new_as, stack_vpn_start, stack_vpn_end, PTE_V | PTE_R | PTE_W | PTE_U);
+
+    thread_t *t = current_thread();
 
+    /* 其余线程随旧地址空间一起结束 */
+    for (int i = 0; i < proc->thread_count; i++) {
+        thread_t *other = get_thread(proc->threads[i]);
+        if (other && other != t) other->exited = true;
+    }
+    as_destroy(proc->as);
     proc->as = new_as;
     signal_clear(&proc->signal);
 
-    thread_t *t = current_thread();
     t->ctx.ctx = context_user(entry);
-    t->ctx.satp = make_satp(as_root_ppn(new_as));
+    t->ctx.satp = as_activate(new_as);
     ctx_set_sp(&t->ctx.ctx, USER_STACK_TOP);
 
     return 0;
@@ -454,11 +809,6 @@ static long do_waitpid(long pid, int *exit_code) {
     thread_t *t = current_thread();
     if (!proc || !t) return -1;
 
-    int *kcode = NULL;
-    if (exit_code) {
-        kcode = as_translate(proc->as, (vaddr_t)exit_code, PTE_W | PTE_V);
-    }
-
     bool has_child = false;
 
     /* 查找子进程 */
@@ -468,8 +818,10 @@ static long do_waitpid(long pid, int *exit_code) {
             if (pid == -1 || (pid_t)pid == i) {
                 if (child->exited) {
                     /* 找到已退出的子进程 */
-                    if (kcode) *kcode = child->exit_code;
-                    child->parent = PID_INVALID;  /* 释放 */
+                    if (exit_code) {
+                        as_copy_to_user(proc->as, (vaddr_t)exit_code, &child->exit_code, sizeof(int));
+                    }
+                    release_process(child);
                     return i;
                 }
                 has_child = true;
@@ -481,7 +833,7 @@ static long do_waitpid(long pid, int *exit_code) {
         /* 有子进程但未退出，记录等待状态 */
         proc->waiting_for = (pid_t)pid;
         proc->waiting_tid = t->tid;
-        proc->waiting_exit_code_ptr = kcode;
+        proc->waiting_exit_code = (vaddr_t)exit_code;
         return -2;  /* 需要阻塞 */
     }
 
@@ -503,12 +855,18 @@ static long do_sigaction(int signum, const void *action, void *old_action) {
     if (!proc) return -1;
 
     if (old_action) {
-        signal_action_t *kold = as_translate(proc->as, (vaddr_t)old_action, PTE_W | PTE_V);
-        if (!kold || !signal_get_action(&proc->signal, (signal_no_t)signum, kold)) return -1;
+        signal_action_t kold;
+        if (!signal_get_action(&proc->signal, (signal_no_t)signum, &kold) ||
+            as_copy_to_user(proc->as, (vaddr_t)old_action, &kold, sizeof(kold)) != 0) {
+            return -1;
+        }
     }
     if (action) {
-        const signal_action_t *kact = as_translate(proc->as, (vaddr_t)action, PTE_R | PTE_V);
-        if (!kact || !signal_set_action(&proc->signal, (signal_no_t)signum, kact)) return -1;
+        signal_action_t kact;
+        if (as_copy_from_user(proc->as, &kact, (vaddr_t)action, sizeof(kact)) != 0 ||
+            !signal_set_action(&proc->signal, (signal_no_t)signum, &kact)) {
+            return -1;
+        }
     }
     return 0;
 }
@@ -534,9 +892,9 @@ static long do_thread_create(uintptr_t entry, uintptr_t arg) {
     uintptr_t stack_base = USER_STACK_TOP - (proc->thread_count + 1) * 3 * PAGE_SIZE;
     uintptr_t stack_vpn_start = va_vpn(stack_base);
     uintptr_t stack_vpn_end = stack_vpn_start + 2;
-    as_map(proc->as, stack_vpn_start, stack_vpn_end, NULL, 0, 0, PTE_V | PTE_R | PTE_W | PTE_U);
+    as_map_anon(proc->as, stack_vpn_start, stack_vpn_end, PTE_V | PTE_R | PTE_W | PTE_U);
 
-    uintptr_t satp = make_satp(as_root_ppn(proc->as));
+    uintptr_t satp = as_activate(proc->as);
     thread_t *t = create_thread(proc->pid, entry, stack_base + 2 * PAGE_SIZE, satp);
     if (!t) return -1;
 
@@ -567,7 +925,8 @@ static long do_mutex_create(int blocking) {
 
     for (int i = 0; i < MAX_SYNC_OBJS; i++) {
         if (!proc->mutexes[i]) {
-            proc->mutexes[i] = heap_alloc(sizeof(mutex_t), 8);
+            proc->mutexes[i] = kmem_cache_alloc(&g_mutex_cache);
+            if (!proc->mutexes[i]) return -1;
             mutex_init(proc->mutexes[i]);
             return i;
         }
@@ -601,7 +960,8 @@ static long do_semaphore_create(int res_count) {
 
     for (int i = 0; i < MAX_SYNC_OBJS; i++) {
         if (!proc->semaphores[i]) {
-            proc->semaphores[i] = heap_alloc(sizeof(semaphore_t), 8);
+            proc->semaphores[i] = kmem_cache_alloc(&g_semaphore_cache);
+            if (!proc->semaphores[i]) return -1;
             sem_init(proc->semaphores[i], res_count);
             return i;
         }
@@ -636,7 +996,8 @@ static long do_condvar_create(int arg) {
 
     for (int i = 0; i < MAX_SYNC_OBJS; i++) {
         if (!proc->condvars[i]) {
-            proc->condvars[i] = heap_alloc(sizeof(condvar_t), 8);
+            proc->condvars[i] = kmem_cache_alloc(&g_condvar_cache);
+            if (!proc->condvars[i]) return -1;
             condvar_init(proc->condvars[i]);
             return i;
         }
@@ -665,11 +1026,74 @@ static long do_condvar_wait(int condvar_id, int mutex_id) {
     return r.need_block ? -1 : 0;
 }
 
+static long do_meminfo(meminfo_t *info) {
+    process_t *proc = current_process();
+    if (!proc || !info) return -1;
+    heap_stats_t stats;
+    heap_get_stats(&stats);
+    meminfo_t kinfo;
+    kinfo.total = stats.total;
+    kinfo.used = stats.used;
+    kinfo.peak = stats.peak;
+    return as_copy_to_user(proc->as, (vaddr_t)info, &kinfo, sizeof(kinfo));
+}
+
+/* PROT_* 转换为用户页表项标志（RISC-V 不允许只写页，可写隐含可读） */
+static uint64_t prot_to_flags(int prot) {
+    uint64_t flags = PTE_U;
+    if (prot & PROT_READ) flags |= PTE_R;
+    if (prot & PROT_WRITE) flags |= PTE_R | PTE_W;
+    if (prot & PROT_EXEC) flags |= PTE_X;
+    return flags;
+}
+
+static long do_mmap(uintptr_t addr, size_t len, int prot, int flags, int fd, size_t offset) {
+    process_t *proc = current_process();
+    if (!proc || len == 0 || (offset & PAGE_MASK)) return -1;
+    if (!(flags & (MAP_PRIVATE | MAP_SHARED))) return -1;
+
+    vm_file_t *file = NULL;
+    if (!(flags & MAP_ANONYMOUS)) {
+        /* 文件映射不写回：只允许私有映射或只读的共享映射 */
+        if ((flags & MAP_SHARED) && (prot & PROT_WRITE)) return -1;
+        if (fd < 0 || fd >= MAX_FD || !proc->fd_table[fd]) return -1;
+        file_handle_t *fh = proc->fd_table[fd];
+        if (!fh->inode || !fh->readable) return -1;
+
+        fh = file_dup(fh);
+        file = fh ? wrap_vm_file(fh) : NULL;
+        if (!file) return -1;
+    } else if (flags & MAP_SHARED) {
+        /* 匿名共享映射在 fork 后会变成写时复制，语义不符 */
+        return -1;
+    }
+
+    vaddr_t va = as_mmap(proc->as, addr, len, prot_to_flags(prot),
+                         (flags & MAP_FIXED) != 0, file, offset);
+    vm_file_put(file);
+    return va ? (long)va : -1;
+}
+
+static long do_munmap(uintptr_t addr, size_t len) {
+    process_t *proc = current_process();
+    uintptr_t vpn_start, vpn_end;
+    if (!proc || !user_vpn_range(addr, len, &vpn_start, &vpn_end)) return -1;
+    return as_unmap(proc->as, vpn_start, vpn_end);
+}
+
+static long do_mprotect(uintptr_t addr, size_t len, int prot) {
+    process_t *proc = current_process();
+    uintptr_t vpn_start, vpn_end;
+    if (!proc || !user_vpn_range(addr, len, &vpn_start, &vpn_end)) return -1;
+    return as_protect(proc->as, vpn_start, vpn_end, prot_to_flags(prot));
+}
+
 /* 接口注册 */
 static syscall_io_t io_impl;
 static syscall_proc_t proc_impl;
 static syscall_sched_t sched_impl;
 static syscall_clock_t clock_impl;
+static syscall_mm_t mm_impl;
 static syscall_signal_t signal_impl_s;
 static syscall_thread_t thread_impl;
 static syscall_sync_t sync_impl;
@@ -679,6 +1103,12 @@ static void init_syscall(void) {
     io_impl.read = do_read;
     io_impl.open = do_open;
     io_impl.close = do_close;
+    io_impl.sync = do_sync;
+    io_impl.fsync = do_fsync;
+    io_impl.mkdirat = do_mkdirat;
+    io_impl.unlinkat = do_unlinkat;
+    io_impl.renameat2 = do_renameat2;
+    io_impl.getdents64 = do_getdents64;
 
     proc_impl.exit = do_exit;
     proc_impl.fork = do_fork;
@@ -688,6 +1118,10 @@ static void init_syscall(void) {
 
     sched_impl.sched_yield = do_sched_yield;
     clock_impl.clock_gettime = do_clock_gettime;
+    mm_impl.meminfo = do_meminfo;
+    mm_impl.mmap = do_mmap;
+    mm_impl.munmap = do_munmap;
+    mm_impl.mprotect = do_mprotect;
 
     signal_impl_s.kill = do_kill;
     signal_impl_s.sigaction = do_sigaction;
@@ -712,6 +1146,7 @@ static void init_syscall(void) {
     syscall_set_proc(&proc_impl);
     syscall_set_sched(&sched_impl);
     syscall_set_clock(&clock_impl);
+    syscall_set_mm(&mm_impl);
     syscall_set_signal(&signal_impl_s);
     syscall_set_thread(&thread_impl);
     syscall_set_sync(&sync_impl);
@@ -745,56 +1180,81 @@ void main(void) {
     heap_init(heap_start, g_memory_end - heap_start);
     printf("[INFO] heap: %p - %p\n", (void *)heap_start, (void *)g_memory_end);
 
-    block_cache_init();
+#ifdef MEM_BENCH
+    mem_bench();
+#endif
+
+    if (block_cache_init(BLOCK_CACHE_DEFAULT_CAPACITY) != 0) { puts("[PANIC] block cache init failed!"); shutdown(); }
     if (virtio_blk_init(&g_virtio_blk) != 0) { puts("[PANIC] virtio init failed!"); shutdown(); }
-    g_block_dev = virtio_blk_as_block_device(&g_virtio_blk);
-    puts("[INFO] virtio block device initialized");
+    g_block_dev = io_sched_init(&g_io_sched, virtio_blk_as_block_device(&g_virtio_blk),
+                                IO_SCHED_POLICY);
+    printf("[INFO] virtio block device initialized, io scheduler: %s\n",
+           io_sched_policy_name(IO_SCHED_POLICY));
 
+    efs_set_readahead(READAHEAD_DEFAULT_INIT, READAHEAD_MAX);
     g_fs = efs_open(g_block_dev);
     if (!g_fs) { puts("[PANIC] failed to open easy-fs!"); shutdown(); }
     g_root = efs_root_inode(g_fs);
-    puts("[INFO] easy-fs mounted");
+    journal_stats_t jst;
+    if (efs_journal_get_stats(g_fs, &jst) == 0) {
+        printf("[INFO] easy-fs mounted, journal replayed %d transactions\n", (int)jst.replayed);
+    } else {
+        puts("[INFO] easy-fs mounted");
+    }
 
     kernel_as = as_create();
-    map_kernel_to_user(kernel_as);
+    map_kernel_space(kernel_as);
     init_syscall();
 
     /* 加载 initproc */
-    file_handle_t *initproc_fh = file_open(g_fs, "initproc", O_RDONLY);
-    if (!initproc_fh) { puts("[PANIC] initproc not found!"); shutdown(); }
-    size_t initproc_len;
-    uint8_t *initproc_data = read_all_file(initproc_fh, &initproc_len);
-    file_close(initproc_fh);
+    vm_file_t *initproc_file = open_vm_file("initproc");
+    if (!initproc_file) { puts("[PANIC] initproc not found!"); shutdown(); }
 
     process_t *init_proc;
     thread_t *init_thread;
-    if (!create_process_from_elf(initproc_data, initproc_len, &init_proc, &init_thread)) {
+    if (!create_process_from_elf(initproc_file, &init_proc, &init_thread)) {
         puts("[PANIC] failed to create initproc!");
         shutdown();
     }
-    heap_free(initproc_data, initproc_len);
+    vm_file_put(initproc_file);
 
     ready_enqueue(init_thread->tid);
     printf("[INFO] initproc created, pid=%d, tid=%d\n", (int)init_proc->pid, (int)init_thread->tid);
     puts("");
 
-    write_satp(make_satp(as_root_ppn(kernel_as)));
+    write_satp(make_satp(as_root_ppn(kernel_as), 0));
+    asid_init();
     puts("[INFO] paging enabled\n");
 
+    /* 磁盘完成中断：用户态运行时陷入调度循环，内核态不开全局中断，空闲时用 wfi 等待 */
+    plic_init();
+    plic_enable(VIRTIO0_IRQ);
+    enable_external_interrupt();
+
     /* 调度循环 */
     while (1) {
         tid_t tid = ready_dequeue();
-        if (tid == TID_INVALID) { puts("no task"); break; }
+        if (tid == TID_INVALID) {
+            if (g_io_waiter_count == 0) { puts("no task"); break; }
+            /* 所有线程都在等磁盘：停下 hart 直到中断到来 */
+            wait_for_interrupt();
+            handle_external_interrupt();
+            continue;
+        }
 
         thread_t *t = get_thread(tid);
         if (!t || t->exited) continue;
 
         g_current_tid = tid;
+        t->ctx.satp = as_activate(get_process(t->pid)->as);
         foreign_ctx_run(&t->ctx);
 
         uintptr_t scause = read_scause();
         uintptr_t code = cause_code(scause);
 
+        /* 每次陷入内核时检查是否到了块缓存的写回周期 */
+        block_cache_tick();
+
         if (is_exception(scause) && code == EXCEP_U_ECALL) {
             context_t *ctx = &t->ctx.ctx;
             ctx_move_next(ctx);
@@ -805,13 +1265,16 @@ void main(void) {
 
             syscall_result_t ret = syscall_dispatch(id, args);
 
+            /* 读操作需要等待磁盘：退回到 ecall，唤醒后重新执行 */
+            bool io_blocked = id == SYS_READ && ret.status == SYSCALL_OK &&
+                              ret.value == READ_WOULD_BLOCK;
+            if (io_blocked) ctx->sepc -= 4;
+
             /* 处理信号 */
             process_t *proc = get_process(t->pid);
             signal_result_t sig_ret = signal_handle(&proc->signal, ctx);
             if (sig_ret.type == SIGNAL_PROCESS_KILLED) {
-                proc->exited = true;
-                proc->exit_code = sig_ret.exit_code;
-                t->exited = true;
+                kill_process(proc, sig_ret.exit_code);
                 continue;
             }
 
@@ -824,32 +1287,9 @@ void main(void) {
                     thread_t *pt = get_thread(proc->threads[i]);
                     if (pt && !pt->exited) { all_exited = false; break; }
                 }
-                if (all_exited) {
-                    proc->exited = true;
-                    proc->exit_code = t->exit_code;
-                    /* 唤醒等待的父进程 */
-                    if (proc->parent != PID_INVALID) {
-                        process_t *parent = get_process(proc->parent);
-                        if (parent && parent->waiting_tid != TID_INVALID) {
-                            if (parent->waiting_for == (pid_t)-1 || parent->waiting_for == proc->pid) {
-                                /* 设置父进程线程的返回值 */
-                                thread_t *pt = get_thread(parent->waiting_tid);
-                                if (pt) {
-                                    ctx_set_arg(&pt->ctx.ctx, 0, proc->pid);
-                                    /* 写入 exit_code */
-                                    if (parent->waiting_exit_code_ptr) {
-                                        *(parent->waiting_exit_code_ptr) = proc->exit_code;
-                                    }
-                                }
-                                ready_enqueue(parent->waiting_tid);
-                                parent->waiting_tid = TID_INVALID;
-                                parent->waiting_for = PID_INVALID;
-                                parent->waiting_exit_code_ptr = NULL;
-                                proc->parent = PID_INVALID;  /* 释放 */
-                            }
-                        }
-                    }
-                }
+                if (all_exited) exit_process(proc, t->exit_code);
+            } else if (io_blocked) {
+                io_wait(tid);
             } else if (id == SYS_WAITPID) {
                 if (ret.value == -2) {
                     /* 需要阻塞等待子进程 */
@@ -871,18 +1311,29 @@ void main(void) {
                 /* 阻塞的线程不入队 */
             } else {
                 printf("[ERROR] tid=%d unsupported syscall %d\n", (int)tid, (int)id);
-                t->exited = true;
+                kill_process(proc, -1);
             }
+        } else if (is_exception(scause) && as_fault_access(code) &&
+                   as_handle_fault(get_process(t->pid)->as, read_stval(),
+                                   as_fault_access(code)) == 0) {
+            /* 缺页已处理（按需调页 / 写时复制），重新执行该指令 */
+            ready_enqueue(tid);
+        } else if (is_interrupt(scause) && code == INTR_S_EXT) {
+            handle_external_interrupt();
+            ready_enqueue(tid);
         } else if (is_exception(scause)) {
             printf("[ERROR] tid=%d killed: %s\n", (int)tid, exception_name(code));
-            t->exited = true;
+            kill_process(get_process(t->pid), -1);
         } else {
             printf("[ERROR] tid=%d killed: unexpected interrupt\n", (int)tid);
-            t->exited = true;
+            kill_process(get_process(t->pid), -1);
         }
 
         g_current_tid = TID_INVALID;
     }
 
+    block_cache_flush(g_block_dev);
+    print_kmem_stats();
+    print_block_cache_stats();
     shutdown();
 }
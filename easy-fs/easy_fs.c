@@ -3,60 +3,419 @@
  */
 #include "easy_fs.h"
 #include "../kernel-alloc/heap.h"
+#include "../kernel-alloc/slab.h"
+#include "../util/riscv.h"
+#include "../util/sbi.h"
 #include <string.h>
 
+/* 内存 inode 与文件句柄的对象缓存 */
+static kmem_cache_t g_inode_cache = KMEM_CACHE_INIT("inode", inode_t, NULL);
+static kmem_cache_t g_file_cache = KMEM_CACHE_INIT("file_handle", file_handle_t, NULL);
+
 /* ============================================================================
  * 块缓存
  * ========================================================================== */
 
-static block_cache_t g_block_cache[BLOCK_CACHE_SIZE];
+static block_cache_t *g_block_cache;
+static size_t g_cache_capacity;
+static block_cache_t **g_cache_buckets;
+static size_t g_bucket_mask;
+static block_cache_t g_lru;             /* LRU 循环链表哨兵 */
+static block_cache_stats_t g_cache_stats;
+static uint64_t g_flush_interval = BLOCK_CACHE_DEFAULT_FLUSH_INTERVAL;
+static uint64_t g_last_flush;
+static size_t g_cache_io_pinned;        /* 异步读入中（被钉住）的缓存项数 */
+
+/* 元数据日志（见“元数据日志”一节） */
+static struct journal *g_journal;       /* 带日志区的文件系统的日志，目前只支持一个设备 */
+static int g_journal_handles;           /* 正在进行的元数据操作数（可嵌套） */
+static void journal_add_block(block_cache_t *cache);
+static bool journal_pending(void);
+static void journal_commit_running(void);
+static bool journal_commit_early(void);
+
+static inline size_t cache_hash(size_t block_id, block_device_t *dev) {
+    size_t h = block_id ^ ((uintptr_t)dev >> 4);
+    return ((h * 0x9E3779B97F4A7C15ULL) >> 32) & g_bucket_mask;
+}
+
+static void lru_unlink(block_cache_t *c) {
+    c->lru_prev->lru_next = c->lru_next;
+    c->lru_next->lru_prev = c->lru_prev;
+}
+
+static void lru_push_front(block_cache_t *c) {
+    c->lru_prev = &g_lru;
+    c->lru_next = g_lru.lru_next;
+    g_lru.lru_next->lru_prev = c;
+    g_lru.lru_next = c;
+}
+
+static void hash_remove(block_cache_t *c) {
+    block_cache_t **pp = &g_cache_buckets[cache_hash(c->block_id, c->block_device)];
+    while (*pp && *pp != c) pp = &(*pp)->hash_next;
+    if (*pp) *pp = c->hash_next;
+    c->hash_next = NULL;
+}
+
+static void hash_insert(block_cache_t *c) {
+    block_cache_t **head = &g_cache_buckets[cache_hash(c->block_id, c->block_device)];
+    c->hash_next = *head;
+    *head = c;
+}
+
+int block_cache_init(size_t capacity) {
+    if (capacity < BLOCK_CACHE_MIN_CAPACITY) capacity = BLOCK_CACHE_MIN_CAPACITY;
+
+    size_t buckets = 1;
+    while (buckets < capacity) buckets <<= 1;
+
+    if (g_block_cache) {
+        journal_commit_running();
+        block_cache_sync_all();
+        heap_free(g_block_cache, g_cache_capacity * sizeof(block_cache_t));
+        heap_free(g_cache_buckets, (g_bucket_mask + 1) * sizeof(block_cache_t *));
+        g_block_cache = NULL;
+        g_cache_buckets = NULL;
+    }
 
-void block_cache_init(void) {
-    memset(g_block_cache, 0, sizeof(g_block_cache));
+    g_block_cache = heap_alloc_zeroed(capacity * sizeof(block_cache_t), 8);
+    g_cache_buckets = heap_alloc_zeroed(buckets * sizeof(block_cache_t *), 8);
+    if (!g_block_cache || !g_cache_buckets) {
+        if (g_block_cache) heap_free(g_block_cache, capacity * sizeof(block_cache_t));
+        if (g_cache_buckets) heap_free(g_cache_buckets, buckets * sizeof(block_cache_t *));
+        g_block_cache = NULL;
+        g_cache_buckets = NULL;
+        return -1;
+    }
+    g_cache_capacity = capacity;
+    g_bucket_mask = buckets - 1;
+    memset(&g_cache_stats, 0, sizeof(g_cache_stats));
+    g_cache_io_pinned = 0;
+    g_last_flush = read_time();
+
+    /* 所有块起初都无效，挂在 LRU 链表上作为淘汰候选 */
+    g_lru.lru_prev = g_lru.lru_next = &g_lru;
+    for (size_t i = 0; i < capacity; i++) {
+        lru_push_front(&g_block_cache[i]);
+    }
+    return 0;
 }
 
 void block_cache_sync(block_cache_t *cache) {
-    if (cache->valid && cache->modified) {
+    if (cache->valid && cache->modified && !cache->journaled) {
         cache->block_device->write_block(cache->block_device, cache->block_id, cache->cache);
         cache->modified = false;
+        g_cache_stats.writebacks++;
+        g_cache_stats.dirty--;
+    }
+}
+
+/* 一批脏块写回完成：写成功的块标记为干净 */
+static void sync_batch_done(block_cache_t **batch, block_request_t *reqs, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (reqs[i].status == 0 && batch[i]->modified) {
+            batch[i]->modified = false;
+            g_cache_stats.writebacks++;
+            g_cache_stats.dirty--;
+        }
     }
+    g_cache_stats.batch_submits++;
 }
 
 void block_cache_sync_all(void) {
-    for (int i = 0; i < BLOCK_CACHE_SIZE; i++) {
-        block_cache_sync(&g_block_cache[i]);
+    uint64_t start = read_time();
+    size_t dirty = g_cache_stats.dirty;
+
+    /* 设备支持批量提交时，同一设备的脏块凑成一批同时下发 */
+    block_cache_t *batch[BLOCK_CACHE_SYNC_BATCH];
+    block_request_t reqs[BLOCK_CACHE_SYNC_BATCH];
+    block_device_t *batch_dev = NULL;
+    size_t n = 0;
+
+    for (size_t i = 0; i < g_cache_capacity && g_cache_stats.dirty > 0; i++) {
+        block_cache_t *c = &g_block_cache[i];
+        if (!c->valid || !c->modified || c->journaled) continue;
+        if (!c->block_device->submit) {
+            block_cache_sync(c);
+            continue;
+        }
+        if (n > 0 && (n == BLOCK_CACHE_SYNC_BATCH || c->block_device != batch_dev)) {
+            batch_dev->submit(batch_dev, reqs, n);
+            sync_batch_done(batch, reqs, n);
+            n = 0;
+        }
+        batch_dev = c->block_device;
+        batch[n] = c;
+        reqs[n].block_id = c->block_id;
+        reqs[n].count = 1;
+        reqs[n].buf = c->cache;
+        reqs[n].write = true;
+        reqs[n].flush = false;
+        reqs[n].status = -1;
+        n++;
+    }
+    if (n > 0) {
+        batch_dev->submit(batch_dev, reqs, n);
+        sync_batch_done(batch, reqs, n);
     }
+
+    g_last_flush = read_time();
+    if (dirty > 0) {
+        uint64_t elapsed = g_last_flush - start;
+        g_cache_stats.flushes++;
+        g_cache_stats.flush_time_total += elapsed;
+        if (elapsed > g_cache_stats.flush_time_max) g_cache_stats.flush_time_max = elapsed;
+    }
+}
+
+int block_cache_flush(block_device_t *dev) {
+    journal_commit_running();
+    block_cache_sync_all();
+    return dev->flush ? dev->flush(dev) : 0;
+}
+
+void block_cache_mark_dirty(block_cache_t *cache) {
+    if (!cache->modified) {
+        cache->modified = true;
+        if (++g_cache_stats.dirty > g_cache_stats.dirty_peak) {
+            g_cache_stats.dirty_peak = g_cache_stats.dirty;
+        }
+    }
+    if (g_journal_handles > 0) journal_add_block(cache);
+}
+
+void block_cache_set_flush_interval(uint64_t interval) {
+    g_flush_interval = interval;
+    if (interval == 0) {
+        journal_commit_running();
+        block_cache_sync_all();
+    }
+}
+
+void block_cache_tick(void) {
+    if (g_flush_interval == 0 || (g_cache_stats.dirty == 0 && !journal_pending())) return;
+    if (read_time() - g_last_flush >= g_flush_interval) {
+        journal_commit_running();
+        block_cache_sync_all();
+    }
+}
+
+/* 一次修改操作结束：写穿模式下立即同步 */
+static void block_cache_commit(void) {
+    if (g_flush_interval == 0) block_cache_sync_all();
+}
+
+static block_cache_t *cache_lookup(size_t block_id, block_device_t *dev) {
+    for (block_cache_t *c = g_cache_buckets[cache_hash(block_id, dev)]; c; c = c->hash_next) {
+        if (c->block_id == block_id && c->block_device == dev) {
+            return c;
+        }
+    }
+    return NULL;
+}
+
+/* 等待异步读入完成 */
+static void cache_wait_io(block_cache_t *c) {
+    if (!c->io_pending) return;
+    g_cache_stats.io_waits++;
+    while (c->io_pending) {
+        c->block_device->poll(c->block_device);
+    }
+}
+
+/*
+ * 同步钉住的块每次操作不超过 BLOCK_CACHE_MIN_CAPACITY 个，异步读入中的块受
+ * block_cache_prefetch 的配额限制，因此正常情况下总有块可淘汰；走到这里说明
+ * 有钉住的块没有释放，无法继续。
+ */
+static void cache_exhausted(void) {
+    const char *msg = "[PANIC] easy-fs: block cache exhausted, all entries are pinned\n";
+    while (*msg) console_putchar(*msg++);
+    shutdown();
+}
+
+/**
+ * 从表尾找最久未使用且未被钉住的块，写回并移出哈希表后返回
+ *
+ * @param must 为 true 时必须取得缓存项（找不到即停机），否则找不到返回 NULL
+ */
+static block_cache_t *cache_evict(bool must) {
+    block_cache_t *victim = g_lru.lru_prev;
+    while (victim != &g_lru && (victim->ref > 0 || victim->journaled)) {
+        victim = victim->lru_prev;
+    }
+    if (victim == &g_lru) {
+        if (!must) return NULL;
+        /* 剩下的可能是未提交的日志块：提前提交正在运行的事务，它们即可写回淘汰 */
+        if (!journal_commit_early()) cache_exhausted();
+        return cache_evict(true);
+    }
+
+    if (victim->valid) {
+        block_cache_sync(victim);
+        hash_remove(victim);
+        g_cache_stats.evictions++;
+    }
+    return victim;
 }
 
 block_cache_t *get_block_cache(size_t block_id, block_device_t *dev) {
-    /* 查找已有缓存 */
-    for (int i = 0; i < BLOCK_CACHE_SIZE; i++) {
-        if (g_block_cache[i].valid &&
-            g_block_cache[i].block_id == block_id &&
-            g_block_cache[i].block_device == dev) {
-            return &g_block_cache[i];
+    /* 命中：移到 LRU 表头 */
+    block_cache_t *c = cache_lookup(block_id, dev);
+    if (c) {
+        lru_unlink(c);
+        lru_push_front(c);
+        c->ref++;
+        g_cache_stats.hits++;
+        cache_wait_io(c);
+        if (c->valid) return c;
+        /* 异步读入失败，缓存项已作废：同步重读 */
+        c->ref--;
+    }
+    g_cache_stats.misses++;
+
+    block_cache_t *victim = cache_evict(true);
+
+    victim->block_id = block_id;
+    victim->block_device = dev;
+    victim->modified = false;
+    victim->valid = true;
+    victim->ref = 1;
+    dev->read_block(dev, block_id, victim->cache);
+    hash_insert(victim);
+    lru_unlink(victim);
+    lru_push_front(victim);
+    return victim;
+}
+
+/* 异步读入完成回调：缓存项就绪并解除钉住，失败则作废 */
+static void cache_fill_done(block_request_t *req) {
+    block_cache_t *c = req->priv;
+    c->io_pending = false;
+    c->ref--;
+    g_cache_io_pinned--;
+    if (req->status == 0) {
+        c->valid = true;
+    } else {
+        hash_remove(c);
+    }
+}
+
+int block_cache_prefetch(size_t block_id, block_device_t *dev) {
+    block_cache_t *c = cache_lookup(block_id, dev);
+    if (c) return c->io_pending ? 1 : 0;
+    if (!dev->start) return -1;
+
+    /* 异步读入中的块一直钉住到读完，最多占用去掉同步操作所需后的一半，
+     * 多个睡眠中的读者同时预读也不会把缓存钉满 */
+    if (g_cache_io_pinned >= (g_cache_capacity - BLOCK_CACHE_MIN_CAPACITY) / 2) return -1;
+    c = cache_evict(false);
+    if (!c) return -1;
+
+    /* 读入期间保持钉住，且在哈希表中占位，避免重复读入 */
+    c->block_id = block_id;
+    c->block_device = dev;
+    c->modified = false;
+    c->valid = false;
+    c->io_pending = true;
+    c->ref = 1;
+    c->req.block_id = block_id;
+    c->req.count = 1;
+    c->req.buf = c->cache;
+    c->req.write = false;
+    c->req.flush = false;
+    c->req.complete = cache_fill_done;
+    c->req.priv = c;
+    hash_insert(c);
+    lru_unlink(c);
+    lru_push_front(c);
+
+    if (dev->start(dev, &c->req) != 0) {
+        hash_remove(c);
+        c->io_pending = false;
+        c->ref = 0;
+        return -1;
+    }
+    g_cache_io_pinned++;
+    g_cache_stats.misses++;
+    g_cache_stats.async_reads++;
+    return 1;
+}
+
+void block_cache_release(block_cache_t *cache) {
+    if (cache && cache->ref > 0) {
+        cache->ref--;
+    }
+}
+
+void block_cache_get_stats(block_cache_stats_t *stats) {
+    *stats = g_cache_stats;
+}
+
+void block_cache_read_direct(block_device_t *dev, size_t block_id, size_t count, uint8_t *buf) {
+    /* 整段都已缓存（例如预先异步读入过）时直接从缓存复制 */
+    size_t cached = 0;
+    while (cached < count) {
+        block_cache_t *c = cache_lookup(block_id + cached, dev);
+        if (!c || !(c->valid || c->io_pending)) break;
+        cached++;
+    }
+    if (cached == count) {
+        for (size_t i = 0; i < count; i++) {
+            block_cache_t *c = cache_lookup(block_id + i, dev);
+            cache_wait_io(c);
+            if (!c->valid) break;
+            memcpy(buf + i * BLOCK_SZ, c->cache, BLOCK_SZ);
+            cached = i + 1;
+        }
+        if (cached == count) {
+            g_cache_stats.hits += count;
+            return;
         }
     }
 
-    /* 查找空闲槽位 */
-    for (int i = 0; i < BLOCK_CACHE_SIZE; i++) {
-        if (!g_block_cache[i].valid) {
-            g_block_cache[i].block_id = block_id;
-            g_block_cache[i].block_device = dev;
-            g_block_cache[i].modified = false;
-            g_block_cache[i].valid = true;
-            dev->read_block(dev, block_id, g_block_cache[i].cache);
-            return &g_block_cache[i];
+    if (dev->read_blocks) {
+        dev->read_blocks(dev, block_id, count, buf);
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            dev->read_block(dev, block_id + i, buf + i * BLOCK_SZ);
         }
     }
 
-    /* 替换第一个缓存（简单策略） */
-    block_cache_sync(&g_block_cache[0]);
-    g_block_cache[0].block_id = block_id;
-    g_block_cache[0].block_device = dev;
-    g_block_cache[0].modified = false;
-    dev->read_block(dev, block_id, g_block_cache[0].cache);
-    return &g_block_cache[0];
+    for (size_t i = 0; i < count; i++) {
+        block_cache_t *c = cache_lookup(block_id + i, dev);
+        if (c && c->modified) {
+            memcpy(buf + i * BLOCK_SZ, c->cache, BLOCK_SZ);
+        }
+    }
+    g_cache_stats.direct_reads += count;
+}
+
+void block_cache_write_direct(block_device_t *dev, size_t block_id, size_t count,
+                              const uint8_t *buf) {
+    if (dev->write_blocks) {
+        dev->write_blocks(dev, block_id, count, buf);
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            dev->write_block(dev, block_id + i, buf + i * BLOCK_SZ);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        block_cache_t *c = cache_lookup(block_id + i, dev);
+        if (c) {
+            /* 等读入完成，否则旧内容会在之后覆盖新写入的数据 */
+            cache_wait_io(c);
+            if (!c->valid) continue;
+            memcpy(c->cache, buf + i * BLOCK_SZ, BLOCK_SZ);
+            if (c->modified) {
+                c->modified = false;
+                g_cache_stats.dirty--;
+            }
+        }
+    }
+    g_cache_stats.direct_writes += count;
 }
 
 /* ============================================================================
@@ -76,22 +435,116 @@ static int ctz64(uint64_t x) {
     return n;
 }
 
-static int bitmap_alloc(bitmap_t *bm, block_device_t *dev) {
-    for (size_t block_id = 0; block_id < bm->blocks; block_id++) {
-        block_cache_t *cache = get_block_cache(block_id + bm->start_block_id, dev);
-        uint64_t *bitmap_block = (uint64_t *)cache->cache;
-
-        for (size_t bits64_pos = 0; bits64_pos < 64; bits64_pos++) {
-            if (bitmap_block[bits64_pos] != ~0ULL) {
-                /* 找到空闲位 */
-                int inner_pos = ctz64(~bitmap_block[bits64_pos]);
-                bitmap_block[bits64_pos] |= (1ULL << inner_pos);
-                cache->modified = true;
-                return block_id * BLOCK_BITS + bits64_pos * 64 + inner_pos;
+/* 计算置位的个数 */
+static int popcount64(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+}
+
+static void bitmap_init(bitmap_t *bm, size_t start_block_id, size_t blocks, size_t maximum) {
+    bm->start_block_id = start_block_id;
+    bm->blocks = blocks;
+    bm->maximum = maximum < blocks * BLOCK_BITS ? maximum : blocks * BLOCK_BITS;
+    bm->cursor = 0;
+    /* 内存不足时不维护摘要，每个位图块都要读出来查找 */
+    bm->free_count = blocks ? heap_alloc(blocks * sizeof(uint16_t), sizeof(uint16_t)) : NULL;
+    if (bm->free_count) {
+        for (size_t i = 0; i < blocks; i++) {
+            bm->free_count[i] = BITMAP_COUNT_UNKNOWN;
+        }
+    }
+}
+
+/* 位图块 block_pos 中有效（可分配）的位数 */
+static size_t bitmap_block_bits(const bitmap_t *bm, size_t block_pos) {
+    size_t first = block_pos * BLOCK_BITS;
+    if (first >= bm->maximum) return 0;
+    return bm->maximum - first < BLOCK_BITS ? bm->maximum - first : BLOCK_BITS;
+}
+
+/* 统计位图块中有效位里的空闲位数 */
+static size_t bitmap_count_free(const uint64_t *words, size_t nbits) {
+    size_t used = 0;
+    for (size_t w = 0; w * 64 < nbits; w++) {
+        uint64_t word = words[w];
+        if (nbits - w * 64 < 64) {
+            word &= (1ULL << (nbits - w * 64)) - 1;
+        }
+        used += popcount64(word);
+    }
+    return nbits - used;
+}
+
+/**
+ * 分配一段连续的空闲位（next-fit）
+ *
+ * 从上次分配结束的位置（cursor）向后找第一个空闲位，再向后尽量延伸到 want 位，
+ * 到位图末尾后绕回开头。空闲数为 0 的位图块直接跳过，不必读入块缓存。
+ * 一段不跨越位图块，调用者需要更多时再次调用即可从下一个位图块的开头接着分配。
+ *
+ * @return 分配到的位数，没有空闲位时返回 0
+ */
+static size_t bitmap_alloc_run(bitmap_t *bm, block_device_t *dev, size_t want, size_t *first) {
+    if (want == 0 || bm->maximum == 0) return 0;
+
+    size_t cursor = bm->cursor < bm->maximum ? bm->cursor : 0;
+    size_t start_block = cursor / BLOCK_BITS;
+
+    /* 多走一轮，绕回后再看起始块中 cursor 之前的部分 */
+    for (size_t i = 0; i <= bm->blocks; i++) {
+        size_t block_pos = (start_block + i) % bm->blocks;
+        size_t nbits = bitmap_block_bits(bm, block_pos);
+        if (nbits == 0) continue;
+        if (bm->free_count && bm->free_count[block_pos] == 0) continue;
+
+        size_t from = i == 0 ? cursor % BLOCK_BITS : 0;
+        block_cache_t *cache = get_block_cache(block_pos + bm->start_block_id, dev);
+        uint64_t *words = (uint64_t *)cache->cache;
+
+        if (bm->free_count && bm->free_count[block_pos] == BITMAP_COUNT_UNKNOWN) {
+            bm->free_count[block_pos] = bitmap_count_free(words, nbits);
+        }
+
+        /* 找 from 之后的第一个空闲位 */
+        size_t bit = nbits;
+        for (size_t w = from / 64; w * 64 < nbits; w++) {
+            uint64_t busy = words[w];
+            if (w == from / 64) busy |= (1ULL << (from % 64)) - 1;
+            if (busy != ~0ULL) {
+                bit = w * 64 + ctz64(~busy);
+                break;
             }
         }
+        if (bit >= nbits) {
+            block_cache_release(cache);
+            continue;
+        }
+
+        /* 向后延伸 */
+        size_t got = 0;
+        while (got < want && bit + got < nbits) {
+            size_t b = bit + got;
+            if (words[b / 64] & (1ULL << (b % 64))) break;
+            words[b / 64] |= 1ULL << (b % 64);
+            got++;
+        }
+        block_cache_mark_dirty(cache);
+        block_cache_release(cache);
+
+        if (bm->free_count) bm->free_count[block_pos] -= got;
+        *first = block_pos * BLOCK_BITS + bit;
+        bm->cursor = *first + got;
+        return got;
     }
-    return -1;
+    return 0;
+}
+
+static int bitmap_alloc(bitmap_t *bm, block_device_t *dev) {
+    size_t bit;
+    if (bitmap_alloc_run(bm, dev, 1, &bit) == 0) return -1;
+    return bit;
 }
 
 static void bitmap_dealloc(bitmap_t *bm, block_device_t *dev, size_t bit) {
@@ -102,7 +555,12 @@ static void bitmap_dealloc(bitmap_t *bm, block_device_t *dev, size_t bit) {
     block_cache_t *cache = get_block_cache(block_pos + bm->start_block_id, dev);
     uint64_t *bitmap_block = (uint64_t *)cache->cache;
     bitmap_block[bits64_pos] &= ~(1ULL << inner_pos);
-    cache->modified = true;
+    block_cache_mark_dirty(cache);
+    block_cache_release(cache);
+
+    if (bm->free_count && bm->free_count[block_pos] != BITMAP_COUNT_UNKNOWN) {
+        bm->free_count[block_pos]++;
+    }
 }
 
 /* ============================================================================
@@ -113,22 +571,99 @@ static uint32_t disk_inode_data_blocks(uint32_t size) {
     return (size + BLOCK_SZ - 1) / BLOCK_SZ;
 }
 
-static uint32_t disk_inode_get_block_id(disk_inode_t *di, uint32_t inner_id, block_device_t *dev) {
+/**
+ * 文件内块号到磁盘块号的映射游标
+ *
+ * 顺序访问时复用当前钉住的一级索引块（以及 indirect2 块），
+ * 只有跨越索引块边界时才重新查找，避免每个数据块都走一遍间接块链。
+ */
+typedef struct {
+    disk_inode_t *di;
+    block_device_t *dev;
+    block_cache_t *level2;      /* indirect2 块，首次需要时钉住 */
+    block_cache_t *level1;      /* 当前一级索引块（indirect1 或 indirect2 的子块） */
+    uint32_t level1_id;
+} block_map_t;
+
+static void block_map_init(block_map_t *m, disk_inode_t *di, block_device_t *dev) {
+    m->di = di;
+    m->dev = dev;
+    m->level2 = NULL;
+    m->level1 = NULL;
+    m->level1_id = 0;
+}
+
+static void block_map_done(block_map_t *m) {
+    block_cache_release(m->level1);
+    block_cache_release(m->level2);
+    m->level1 = m->level2 = NULL;
+}
+
+static uint32_t block_map_get(block_map_t *m, uint32_t inner_id) {
     if (inner_id < INODE_DIRECT_COUNT) {
-        return di->direct[inner_id];
-    } else if (inner_id < INODE_DIRECT_COUNT + INODE_INDIRECT1_COUNT) {
-        block_cache_t *cache = get_block_cache(di->indirect1, dev);
-        uint32_t *indirect_block = (uint32_t *)cache->cache;
-        return indirect_block[inner_id - INODE_DIRECT_COUNT];
+        return m->di->direct[inner_id];
+    }
+
+    uint32_t level1_id;
+    uint32_t index;
+    if (inner_id < INODE_DIRECT_COUNT + INODE_INDIRECT1_COUNT) {
+        level1_id = m->di->indirect1;
+        index = inner_id - INODE_DIRECT_COUNT;
     } else {
         size_t last = inner_id - INODE_DIRECT_COUNT - INODE_INDIRECT1_COUNT;
-        block_cache_t *cache2 = get_block_cache(di->indirect2, dev);
-        uint32_t *indirect2 = (uint32_t *)cache2->cache;
-        uint32_t indirect1_id = indirect2[last / INODE_INDIRECT1_COUNT];
-        block_cache_t *cache1 = get_block_cache(indirect1_id, dev);
-        uint32_t *indirect1 = (uint32_t *)cache1->cache;
-        return indirect1[last % INODE_INDIRECT1_COUNT];
+        if (!m->level2) {
+            m->level2 = get_block_cache(m->di->indirect2, m->dev);
+        }
+        level1_id = ((uint32_t *)m->level2->cache)[last / INODE_INDIRECT1_COUNT];
+        index = last % INODE_INDIRECT1_COUNT;
+    }
+
+    if (!m->level1 || m->level1_id != level1_id) {
+        block_cache_release(m->level1);
+        m->level1 = get_block_cache(level1_id, m->dev);
+        m->level1_id = level1_id;
     }
+    return ((uint32_t *)m->level1->cache)[index];
+}
+
+/* 单次直接读写的最大块数 */
+#define DIRECT_IO_MAX_BLOCKS 128
+
+/**
+ * 从文件内块号 inner_id 开始，统计至多 max 个物理连续的数据块
+ *
+ * @param first 输出第一个块的磁盘块号
+ * @return 连续块数（至少为 1）
+ */
+static size_t block_map_run(block_map_t *m, uint32_t inner_id, size_t max, uint32_t *first) {
+    *first = block_map_get(m, inner_id);
+    if (max > DIRECT_IO_MAX_BLOCKS) max = DIRECT_IO_MAX_BLOCKS;
+
+    size_t n = 1;
+    while (n < max && block_map_get(m, inner_id + n) == *first + n) {
+        n++;
+    }
+    return n;
+}
+
+/**
+ * 确保映射 inner_id 所需的索引块在缓存中，不在的发起异步读入
+ *
+ * @return 0 索引块已就绪（block_map_get 不会等待设备）；1 索引块读入中；-1 无法异步读入
+ */
+static int block_map_prefetch_index(block_map_t *m, uint32_t inner_id) {
+    if (inner_id < INODE_DIRECT_COUNT) return 0;
+    if (inner_id < INODE_DIRECT_COUNT + INODE_INDIRECT1_COUNT) {
+        return block_cache_prefetch(m->di->indirect1, m->dev);
+    }
+
+    int r = block_cache_prefetch(m->di->indirect2, m->dev);
+    if (r != 0) return r;
+    if (!m->level2) {
+        m->level2 = get_block_cache(m->di->indirect2, m->dev);
+    }
+    size_t last = inner_id - INODE_DIRECT_COUNT - INODE_INDIRECT1_COUNT;
+    return block_cache_prefetch(((uint32_t *)m->level2->cache)[last / INODE_INDIRECT1_COUNT], m->dev);
 }
 
 static size_t disk_inode_read_at(disk_inode_t *di, size_t offset, uint8_t *buf, size_t len, block_device_t *dev) {
@@ -139,16 +674,32 @@ static size_t disk_inode_read_at(disk_inode_t *di, size_t offset, uint8_t *buf,
 
     size_t start_block = start / BLOCK_SZ;
     size_t read_size = 0;
+    block_map_t map;
+    block_map_init(&map, di, dev);
 
     while (start < end) {
+        /* 块对齐的大段读取：物理连续的整块合并为一次设备请求 */
+        if (start % BLOCK_SZ == 0 && end - start >= 2 * BLOCK_SZ) {
+            uint32_t first;
+            size_t run = block_map_run(&map, start_block, (end - start) / BLOCK_SZ, &first);
+            if (run >= 2) {
+                block_cache_read_direct(dev, first, run, buf + read_size);
+                read_size += run * BLOCK_SZ;
+                start_block += run;
+                start += run * BLOCK_SZ;
+                continue;
+            }
+        }
+
         size_t end_current_block = (start / BLOCK_SZ + 1) * BLOCK_SZ;
         if (end_current_block > end) end_current_block = end;
 
         size_t block_read_size = end_current_block - start;
-        uint32_t block_id = disk_inode_get_block_id(di, start_block, dev);
+        uint32_t block_id = block_map_get(&map, start_block);
         block_cache_t *cache = get_block_cache(block_id, dev);
 
         memcpy(buf + read_size, cache->cache + (start % BLOCK_SZ), block_read_size);
+        block_cache_release(cache);
         read_size += block_read_size;
 
         if (end_current_block == end) break;
@@ -156,6 +707,7 @@ static size_t disk_inode_read_at(disk_inode_t *di, size_t offset, uint8_t *buf,
         start = end_current_block;
     }
 
+    block_map_done(&map);
     return read_size;
 }
 
@@ -167,17 +719,33 @@ static size_t disk_inode_write_at(disk_inode_t *di, size_t offset, const uint8_t
 
     size_t start_block = start / BLOCK_SZ;
     size_t write_size = 0;
+    block_map_t map;
+    block_map_init(&map, di, dev);
 
     while (start < end) {
+        /* 块对齐的大段写入：物理连续的整块合并为一次设备请求 */
+        if (start % BLOCK_SZ == 0 && end - start >= 2 * BLOCK_SZ) {
+            uint32_t first;
+            size_t run = block_map_run(&map, start_block, (end - start) / BLOCK_SZ, &first);
+            if (run >= 2) {
+                block_cache_write_direct(dev, first, run, buf + write_size);
+                write_size += run * BLOCK_SZ;
+                start_block += run;
+                start += run * BLOCK_SZ;
+                continue;
+            }
+        }
+
         size_t end_current_block = (start / BLOCK_SZ + 1) * BLOCK_SZ;
         if (end_current_block > end) end_current_block = end;
 
         size_t block_write_size = end_current_block - start;
-        uint32_t block_id = disk_inode_get_block_id(di, start_block, dev);
+        uint32_t block_id = block_map_get(&map, start_block);
         block_cache_t *cache = get_block_cache(block_id, dev);
 
         memcpy(cache->cache + (start % BLOCK_SZ), buf + write_size, block_write_size);
-        cache->modified = true;
+        block_cache_mark_dirty(cache);
+        block_cache_release(cache);
         write_size += block_write_size;
 
         if (end_current_block == end) break;
@@ -185,141 +753,1122 @@ static size_t disk_inode_write_at(disk_inode_t *di, size_t offset, const uint8_t
         start = end_current_block;
     }
 
-    return write_size;
+    block_map_done(&map);
+    return write_size;
+}
+
+/* 数据块数为 data_blocks 时共占用的块数（含索引块） */
+static uint32_t disk_inode_total_blocks(uint32_t data_blocks) {
+    uint32_t total = data_blocks;
+    if (data_blocks > INODE_DIRECT_COUNT) total++;
+    if (data_blocks > INODE_DIRECT_COUNT + INODE_INDIRECT1_COUNT) {
+        uint32_t rest = data_blocks - INODE_DIRECT_COUNT - INODE_INDIRECT1_COUNT;
+        total += 1 + (rest + INODE_INDIRECT1_COUNT - 1) / INODE_INDIRECT1_COUNT;
+    }
+    return total;
+}
+
+/**
+ * 扩容时的块来源
+ *
+ * 预先算出还需要的总块数，每次向位图要一整段连续块，按需依次取用。
+ * 数据块与索引块按文件内顺序交错排布，文件在磁盘上保持物理连续。
+ */
+typedef struct {
+    easy_fs_t *fs;
+    uint32_t need;                      /* 还需要的块数 */
+    uint32_t next;                      /* 当前连续段中的下一块 */
+    uint32_t left;                      /* 当前连续段的剩余块数 */
+} block_pool_t;
+
+static uint32_t block_pool_take(block_pool_t *p) {
+    if (p->left == 0) {
+        p->left = efs_alloc_data_n(p->fs, p->need, &p->next);
+        /* 空间已满：块 0 是超级块，不会是数据块 */
+        if (p->left == 0) return 0;
+    }
+    p->need--;
+    p->left--;
+    return p->next++;
+}
+
+/**
+ * 增加 inode 大小
+ *
+ * 空间不足时停在已取得的块上，新建却没有挂上数据块的索引块随即释放。
+ *
+ * @return 扩容后的大小，可能小于 new_size
+ */
+static uint32_t disk_inode_increase_size(disk_inode_t *di, uint32_t new_size, easy_fs_t *fs) {
+    if (new_size <= di->size) return di->size;
+
+    uint32_t old_blocks = disk_inode_data_blocks(di->size);
+    uint32_t new_blocks = disk_inode_data_blocks(new_size);
+
+    block_pool_t pool = {
+        .fs = fs,
+        .need = disk_inode_total_blocks(new_blocks) - disk_inode_total_blocks(old_blocks),
+    };
+    uint32_t current = old_blocks;
+    uint32_t block;
+    block_device_t *dev = fs->block_device;
+
+    /* 填充 direct */
+    while (current < new_blocks && current < INODE_DIRECT_COUNT) {
+        if ((block = block_pool_take(&pool)) == 0) goto out;
+        di->direct[current] = block;
+        current++;
+    }
+
+    if (current >= new_blocks) goto out;
+
+    /* 分配 indirect1 */
+    if (old_blocks <= INODE_DIRECT_COUNT && new_blocks > INODE_DIRECT_COUNT) {
+        if ((block = block_pool_take(&pool)) == 0) goto out;
+        di->indirect1 = block;
+    }
+
+    /* 填充 indirect1 */
+    if (current < INODE_DIRECT_COUNT + INODE_INDIRECT1_COUNT) {
+        block_cache_t *cache = get_block_cache(di->indirect1, dev);
+        uint32_t *indirect1 = (uint32_t *)cache->cache;
+
+        while (current < new_blocks && current < INODE_DIRECT_COUNT + INODE_INDIRECT1_COUNT) {
+            if ((block = block_pool_take(&pool)) == 0) break;
+            indirect1[current - INODE_DIRECT_COUNT] = block;
+            block_cache_mark_dirty(cache);
+            current++;
+        }
+        block_cache_release(cache);
+
+        if (current == INODE_DIRECT_COUNT) {
+            efs_dealloc_data(fs, di->indirect1);
+            di->indirect1 = 0;
+        }
+        if (block == 0) goto out;
+    }
+
+    if (current >= new_blocks) goto out;
+
+    /* 分配 indirect2 */
+    if (old_blocks <= INODE_DIRECT_COUNT + INODE_INDIRECT1_COUNT) {
+        if ((block = block_pool_take(&pool)) == 0) goto out;
+        di->indirect2 = block;
+    }
+
+    /* 填充 indirect2：每个一级索引块只取一次 */
+    block_cache_t *cache2 = get_block_cache(di->indirect2, dev);
+    uint32_t *indirect2 = (uint32_t *)cache2->cache;
+
+    while (current < new_blocks) {
+        size_t last = current - INODE_DIRECT_COUNT - INODE_INDIRECT1_COUNT;
+        size_t a = last / INODE_INDIRECT1_COUNT;
+        size_t b = last % INODE_INDIRECT1_COUNT;
+
+        if (b == 0) {
+            if ((block = block_pool_take(&pool)) == 0) break;
+            indirect2[a] = block;
+            block_cache_mark_dirty(cache2);
+        }
+
+        block_cache_t *cache1 = get_block_cache(indirect2[a], dev);
+        uint32_t *indirect1 = (uint32_t *)cache1->cache;
+        while (current < new_blocks && b < INODE_INDIRECT1_COUNT) {
+            if ((block = block_pool_take(&pool)) == 0) break;
+            indirect1[b++] = block;
+            current++;
+        }
+        block_cache_mark_dirty(cache1);
+        block_cache_release(cache1);
+
+        if (b == 0) {
+            efs_dealloc_data(fs, indirect2[a]);
+            indirect2[a] = 0;
+        }
+        if (block == 0) break;
+    }
+    block_cache_release(cache2);
+
+    if (current == INODE_DIRECT_COUNT + INODE_INDIRECT1_COUNT) {
+        efs_dealloc_data(fs, di->indirect2);
+        di->indirect2 = 0;
+    }
+
+out:
+    if (new_size > current * BLOCK_SZ) new_size = current * BLOCK_SZ;
+    if (new_size > di->size) di->size = new_size;
+    return di->size;
+}
+
+/* ============================================================================
+ * 元数据日志
+ * ========================================================================== */
+
+/**
+ * 重做日志：元数据操作期间 (journal_begin / journal_end) 标记为脏的块加入正在
+ * 运行的事务，提交前不写回原位置。提交时把这些块的内容连同描述块、提交块顺序
+ * 写入日志区并刷写设备，之后它们成为普通脏块按写回策略写回。
+ *
+ * 释放的数据块先记在 freed 中，位图到提交时才清除，因此提交前不会被再分配；
+ * 其中在日志里出现过的块同时写入撤销记录，避免重放时覆盖已被复用的块。
+ */
+typedef struct journal {
+    block_device_t *dev;
+    easy_fs_t *fs;
+    uint32_t start;                     /* 日志区首块（日志头） */
+    uint32_t blocks;                    /* 日志区块数（含日志头） */
+    uint32_t sequence;                  /* 下一个提交的事务序号 */
+    uint32_t head;                      /* 下一个事务在日志区中的起始位置 */
+    size_t ntxn;                        /* 正在运行的事务中的块数 */
+    uint32_t *freed;                    /* 正在运行的事务中推迟释放的数据块 */
+    size_t nfreed;
+    size_t freed_cap;
+    uint32_t *logged;                   /* 上次检查点以来写入日志的块号，容量为 blocks */
+    size_t nlogged;
+    journal_stats_t stats;
+} journal_t;
+
+#define JOURNAL_CHECKSUM_INIT   0x811c9dc5u
+
+static uint32_t journal_checksum(uint32_t sum, const uint8_t *block) {
+    const uint32_t *w = (const uint32_t *)block;
+    for (size_t i = 0; i < BLOCK_SZ / 4; i++) {
+        sum = (sum ^ w[i]) * 16777619u;
+    }
+    return sum;
+}
+
+/* 单个事务允许修改的块数：journaled 块不可淘汰，须给正常操作留出缓存 */
+static size_t journal_txn_limit(void) {
+    size_t limit = g_cache_capacity / 4;
+    return limit < JOURNAL_TXN_MAX_BLOCKS ? limit : JOURNAL_TXN_MAX_BLOCKS;
+}
+
+static void journal_add_block(block_cache_t *cache) {
+    journal_t *j = g_journal;
+    if (!j || cache->block_device != j->dev || cache->journaled) return;
+    cache->journaled = true;
+    j->ntxn++;
+}
+
+static bool journal_pending(void) {
+    return g_journal && (g_journal->ntxn > 0 || g_journal->nfreed > 0);
+}
+
+/* 事务写入日志区所需的块数 */
+static size_t journal_need(journal_t *j, size_t revokes) {
+    size_t tags = j->ntxn + revokes;
+    return (tags + JOURNAL_TAGS_PER_DESC - 1) / JOURNAL_TAGS_PER_DESC + j->ntxn + 1;
+}
+
+static void journal_commit(journal_t *j);
+static void journal_checkpoint(journal_t *j);
+
+/**
+ * 开始一次元数据操作
+ *
+ * 日志区剩余空间可能不够正在运行的事务再加上一次操作时，先提交事务并做检查点。
+ * 检查点只能在没有未提交修改时做：已提交的块若又被新事务修改，其提交的版本
+ * 只存在于日志中，清空日志区前必须先让它写回原位置。
+ */
+static void journal_begin(void) {
+    journal_t *j = g_journal;
+    if (j && g_journal_handles == 0) {
+        size_t reserve = journal_need(j, j->nfreed) + JOURNAL_TXN_MAX_BLOCKS + j->fs->data_bitmap.blocks;
+        if (j->head + reserve > j->blocks && (j->head > 1 || journal_pending())) {
+            journal_commit(j);
+            journal_checkpoint(j);
+        }
+    }
+    g_journal_handles++;
+}
+
+/* 一次元数据操作结束：写穿模式或事务足够大时提交，否则留待组提交 */
+static void journal_end(void) {
+    if (--g_journal_handles > 0) return;
+    journal_t *j = g_journal;
+    if (!j) {
+        block_cache_commit();
+        return;
+    }
+    if (g_flush_interval == 0 || j->ntxn >= journal_txn_limit() || j->nfreed >= JOURNAL_FREE_MAX) {
+        journal_commit(j);
+    }
+}
+
+static void journal_commit_running(void) {
+    if (g_journal && g_journal_handles == 0) journal_commit(g_journal);
+}
+
+/**
+ * 推迟释放数据块到事务提交
+ *
+ * @return 已记录返回 true；不在日志事务中（或内存不足）返回 false，由调用者立即释放
+ */
+static bool journal_defer_free(easy_fs_t *fs, uint32_t block_id) {
+    journal_t *j = fs->journal;
+    if (!j || j != g_journal || g_journal_handles == 0) return false;
+    if (j->nfreed == j->freed_cap) {
+        size_t cap = j->freed_cap ? j->freed_cap * 2 : 64;
+        uint32_t *freed = heap_alloc(cap * sizeof(uint32_t), sizeof(uint32_t));
+        if (!freed) return false;
+        if (j->freed) {
+            memcpy(freed, j->freed, j->nfreed * sizeof(uint32_t));
+            heap_free(j->freed, j->freed_cap * sizeof(uint32_t));
+        }
+        j->freed = freed;
+        j->freed_cap = cap;
+    }
+    j->freed[j->nfreed++] = block_id;
+    return true;
+}
+
+static void journal_write_header(journal_t *j) {
+    uint8_t buf[BLOCK_SZ];
+    memset(buf, 0, BLOCK_SZ);
+    journal_header_t *h = (journal_header_t *)buf;
+    h->magic = JOURNAL_MAGIC;
+    h->sequence = j->sequence;
+    block_cache_write_direct(j->dev, j->start, 1, buf);
+    if (j->dev->flush) j->dev->flush(j->dev);
+}
+
+/* 检查点：把已提交的块全部写回原位置后清空日志区 */
+static void journal_checkpoint(journal_t *j) {
+    block_cache_sync_all();
+    if (j->dev->flush) j->dev->flush(j->dev);
+    journal_write_header(j);
+    j->head = 1;
+    j->nlogged = 0;
+    j->stats.checkpoints++;
+}
+
+/* 块是否需要撤销记录：上次检查点后写入过日志，或在本事务中 */
+static bool journal_needs_revoke(journal_t *j, uint32_t block_id) {
+    for (size_t i = 0; i < j->nlogged; i++) {
+        if (j->logged[i] == block_id) return true;
+    }
+    block_cache_t *c = cache_lookup(block_id, j->dev);
+    return c && c->journaled;
+}
+
+static size_t journal_count_revokes(journal_t *j) {
+    size_t n = 0;
+    for (size_t i = 0; i < j->nfreed; i++) {
+        if (journal_needs_revoke(j, j->freed[i])) n++;
+    }
+    return n;
+}
+
+/**
+ * 日志区写不下事务（或内存不足）时退回直接写回原位置，不具备原子性。
+ * 之后清空日志区，旧事务不会在重放时覆盖这次写回的块。
+ */
+static void journal_overflow(journal_t *j) {
+    for (size_t i = 0; i < g_cache_capacity; i++) {
+        g_block_cache[i].journaled = false;
+    }
+    journal_checkpoint(j);
+    j->stats.overflows++;
+}
+
+/* 把事务的描述块、数据块与提交块（revokes 为 true 时还有撤销记录）拼接到 buf 中，返回块数 */
+static size_t journal_build(journal_t *j, uint8_t *buf, bool revokes) {
+    size_t n = 0;
+    journal_desc_t *desc = NULL;
+    size_t cache_pos = 0, freed_pos = 0;
+
+    for (;;) {
+        /* 下一个标签：先是事务中的块，再是撤销记录 */
+        uint32_t tag;
+        block_cache_t *c = NULL;
+        while (cache_pos < g_cache_capacity && !g_block_cache[cache_pos].journaled) cache_pos++;
+        if (cache_pos < g_cache_capacity) {
+            c = &g_block_cache[cache_pos++];
+            tag = c->block_id;
+        } else {
+            if (!revokes) break;
+            while (freed_pos < j->nfreed && !journal_needs_revoke(j, j->freed[freed_pos])) freed_pos++;
+            if (freed_pos == j->nfreed) break;
+            tag = JOURNAL_TAG_REVOKE | j->freed[freed_pos++];
+            j->stats.revokes++;
+        }
+
+        if (!desc || desc->count == JOURNAL_TAGS_PER_DESC) {
+            desc = (journal_desc_t *)(buf + n * BLOCK_SZ);
+            memset(desc, 0, BLOCK_SZ);
+            desc->magic = JOURNAL_MAGIC;
+            desc->type = JOURNAL_BLOCK_DESC;
+            desc->sequence = j->sequence;
+            n++;
+        }
+        desc->tags[desc->count++] = tag;
+        if (c) {
+            memcpy(buf + n * BLOCK_SZ, c->cache, BLOCK_SZ);
+            n++;
+        }
+    }
+
+    uint32_t sum = JOURNAL_CHECKSUM_INIT;
+    for (size_t i = 0; i < n; i++) {
+        sum = journal_checksum(sum, buf + i * BLOCK_SZ);
+    }
+
+    journal_commit_t *commit = (journal_commit_t *)(buf + n * BLOCK_SZ);
+    memset(commit, 0, BLOCK_SZ);
+    commit->magic = JOURNAL_MAGIC;
+    commit->type = JOURNAL_BLOCK_COMMIT;
+    commit->sequence = j->sequence;
+    commit->checksum = sum;
+    return n + 1;
+}
+
+/* 把事务中的块写入日志区，之后它们成为普通脏块；日志区写不下时退回 journal_overflow */
+static void journal_write_txn(journal_t *j, bool revokes) {
+    size_t need = journal_need(j, revokes ? journal_count_revokes(j) : 0);
+    uint8_t *buf = j->head + need <= j->blocks ? heap_alloc(need * BLOCK_SZ, 8) : NULL;
+    if (!buf) {
+        journal_overflow(j);
+    } else {
+        size_t n = journal_build(j, buf, revokes);
+        block_cache_write_direct(j->dev, j->start + j->head, n, buf);
+        if (j->dev->flush) j->dev->flush(j->dev);
+        heap_free(buf, need * BLOCK_SZ);
+
+        /* 已提交：成为普通脏块 */
+        for (size_t i = 0; i < g_cache_capacity; i++) {
+            block_cache_t *c = &g_block_cache[i];
+            if (!c->journaled) continue;
+            c->journaled = false;
+            j->logged[j->nlogged++] = c->block_id;
+        }
+        j->stats.logged_blocks += j->ntxn;
+        j->stats.commits++;
+        j->head += n;
+        j->sequence++;
+    }
+    j->ntxn = 0;
+}
+
+static void journal_commit(journal_t *j) {
+    if (j->ntxn == 0 && j->nfreed == 0) return;
+
+    /* 推迟的释放：清除位图，位图块随本事务提交 */
+    g_journal_handles++;
+    for (size_t i = 0; i < j->nfreed; i++) {
+        bitmap_dealloc(&j->fs->data_bitmap, j->dev, j->freed[i] - j->fs->data_area_start_block);
+    }
+    g_journal_handles--;
+
+    journal_write_txn(j, true);
+
+    /* 释放已生效，清零这些块（普通写回） */
+    for (size_t i = 0; i < j->nfreed; i++) {
+        block_cache_t *cache = get_block_cache(j->freed[i], j->dev);
+        memset(cache->cache, 0, BLOCK_SZ);
+        block_cache_mark_dirty(cache);
+        block_cache_release(cache);
+    }
+    j->nfreed = 0;
+}
+
+/**
+ * 块缓存被钉住的块和未提交的日志块占满时，在操作中途提交已修改的块
+ *
+ * 嵌套的大操作（如 rename 覆盖目标时清空其 inode）可能超出 journal_txn_limit。
+ * 推迟的释放与撤销记录留给操作结束时的提交：释放在那之前不生效，
+ * 被撤销的块也就不会被复用。中途崩溃时重放得到的是操作的前一部分，
+ * 与 journal_overflow 一样不具备原子性。
+ *
+ * @return 提交了块返回 true，事务中没有块返回 false
+ */
+static bool journal_commit_early(void) {
+    journal_t *j = g_journal;
+    if (!j || j->ntxn == 0) return false;
+    journal_write_txn(j, false);
+    j->stats.early_commits++;
+    return true;
+}
+
+/* 在已完整提交的事务中，块 block_id 是否在序号不小于 seq 的事务里被撤销 */
+typedef struct {
+    uint32_t block_id;
+    uint32_t sequence;
+} journal_revoke_t;
+
+typedef struct {
+    journal_revoke_t *items;
+    size_t count;
+    size_t cap;
+} journal_revokes_t;
+
+static bool journal_revoked(const journal_revokes_t *r, uint32_t block_id, uint32_t seq) {
+    for (size_t i = 0; i < r->count; i++) {
+        if (r->items[i].block_id == block_id && r->items[i].sequence >= seq) return true;
+    }
+    return false;
+}
+
+static bool journal_revokes_push(journal_revokes_t *r, uint32_t block_id, uint32_t seq) {
+    if (r->count == r->cap) {
+        size_t cap = r->cap ? r->cap * 2 : 64;
+        journal_revoke_t *items = heap_alloc(cap * sizeof(*items), 8);
+        if (!items) return false;
+        if (r->items) {
+            memcpy(items, r->items, r->count * sizeof(*items));
+            heap_free(r->items, r->cap * sizeof(*items));
+        }
+        r->items = items;
+        r->cap = cap;
+    }
+    r->items[r->count].block_id = block_id;
+    r->items[r->count].sequence = seq;
+    r->count++;
+    return true;
+}
+
+/**
+ * 扫描从 pos 开始、序号为 seq 的事务
+ *
+ * revokes 非 NULL 时只校验并收集撤销记录；为 NULL 时按 replay_revokes 重放数据块。
+ *
+ * @return 事务完整时返回下一个事务的位置，否则返回 0
+ */
+static uint32_t journal_scan_txn(journal_t *j, uint32_t pos, uint32_t seq,
+                                 journal_revokes_t *revokes, const journal_revokes_t *replay_revokes) {
+    uint8_t desc_buf[BLOCK_SZ];
+    uint8_t block[BLOCK_SZ];
+    journal_desc_t *desc = (journal_desc_t *)desc_buf;
+    uint32_t sum = JOURNAL_CHECKSUM_INIT;
+
+    for (;;) {
+        if (pos >= j->blocks) return 0;
+        j->dev->read_block(j->dev, j->start + pos, desc_buf);
+        if (desc->magic != JOURNAL_MAGIC || desc->sequence != seq) return 0;
+        if (desc->type == JOURNAL_BLOCK_COMMIT) {
+            if (revokes && ((journal_commit_t *)desc)->checksum != sum) return 0;
+            return pos + 1;
+        }
+        if (desc->type != JOURNAL_BLOCK_DESC || desc->count > JOURNAL_TAGS_PER_DESC) return 0;
+        sum = journal_checksum(sum, desc_buf);
+        pos++;
+
+        for (uint32_t i = 0; i < desc->count; i++) {
+            uint32_t tag = desc->tags[i];
+            if (tag & JOURNAL_TAG_REVOKE) {
+                if (revokes && !journal_revokes_push(revokes, tag & ~JOURNAL_TAG_REVOKE, seq)) return 0;
+                continue;
+            }
+            if (pos >= j->blocks) return 0;
+            j->dev->read_block(j->dev, j->start + pos, block);
+            sum = journal_checksum(sum, block);
+            if (!revokes && !journal_revoked(replay_revokes, tag, seq)) {
+                block_cache_write_direct(j->dev, tag, 1, block);
+            }
+            pos++;
+        }
+    }
+}
+
+/* 重放日志中已完整提交的事务，然后清空日志区 */
+static void journal_recover(journal_t *j) {
+    uint8_t buf[BLOCK_SZ];
+    j->dev->read_block(j->dev, j->start, buf);
+    journal_header_t *h = (journal_header_t *)buf;
+    uint32_t first = h->magic == JOURNAL_MAGIC ? h->sequence : 1;
+
+    /* 第一遍：找出完整的事务并收集撤销记录 */
+    journal_revokes_t revokes = { NULL, 0, 0 };
+    uint32_t seq = first;
+    uint32_t pos = 1;
+    if (h->magic == JOURNAL_MAGIC) {
+        for (;;) {
+            size_t mark = revokes.count;
+            uint32_t next = journal_scan_txn(j, pos, seq, &revokes, NULL);
+            if (!next) {
+                revokes.count = mark;
+                break;
+            }
+            pos = next;
+            seq++;
+        }
+    }
+
+    /* 第二遍：重放 */
+    pos = 1;
+    for (uint32_t s = first; s != seq; s++) {
+        pos = journal_scan_txn(j, pos, s, NULL, &revokes);
+        j->stats.replayed++;
+    }
+    if (revokes.items) heap_free(revokes.items, revokes.cap * sizeof(*revokes.items));
+    if (seq != first && j->dev->flush) j->dev->flush(j->dev);
+
+    /* 已重放的事务不再有效 */
+    j->sequence = seq;
+    j->head = 1;
+    journal_write_header(j);
+}
+
+static journal_t *journal_open(easy_fs_t *fs, const super_block_t *sb) {
+    if (sb->journal_blocks < 2) return NULL;
+
+    /* 同一设备再次挂载时共用日志；目前只支持一个带日志的设备 */
+    if (g_journal) return g_journal->dev == fs->block_device ? g_journal : NULL;
+
+    journal_t *j = heap_alloc(sizeof(journal_t), 8);
+    if (!j) return NULL;
+    memset(j, 0, sizeof(*j));
+    j->logged = heap_alloc(sb->journal_blocks * sizeof(uint32_t), sizeof(uint32_t));
+    if (!j->logged) {
+        heap_free(j, sizeof(journal_t));
+        return NULL;
+    }
+    j->dev = fs->block_device;
+    j->fs = fs;
+    j->start = sb->journal_start;
+    j->blocks = sb->journal_blocks;
+    journal_recover(j);
+    g_journal = j;
+    return j;
+}
+
+int efs_journal_get_stats(easy_fs_t *fs, journal_stats_t *stats) {
+    if (!fs->journal) return -1;
+    *stats = fs->journal->stats;
+    return 0;
+}
+
+/* ============================================================================
+ * 文件系统操作
+ * ========================================================================== */
+
+void efs_get_disk_inode_pos(easy_fs_t *fs, uint32_t inode_id, uint32_t *block_id, size_t *offset) {
+    size_t inode_size = sizeof(disk_inode_t);
+    size_t inodes_per_block = BLOCK_SZ / inode_size;
+    *block_id = fs->inode_area_start_block + inode_id / inodes_per_block;
+    *offset = (inode_id % inodes_per_block) * inode_size;
+}
+
+uint32_t efs_alloc_inode(easy_fs_t *fs) {
+    return bitmap_alloc(&fs->inode_bitmap, fs->block_device);
+}
+
+void efs_dealloc_inode(easy_fs_t *fs, uint32_t inode_id) {
+    bitmap_dealloc(&fs->inode_bitmap, fs->block_device, inode_id);
+}
+
+uint32_t efs_alloc_data(easy_fs_t *fs) {
+    int bit = bitmap_alloc(&fs->data_bitmap, fs->block_device);
+    if (bit < 0) return 0;
+    return fs->data_area_start_block + bit;
+}
+
+uint32_t efs_alloc_data_n(easy_fs_t *fs, uint32_t count, uint32_t *first) {
+    size_t bit;
+    size_t got = bitmap_alloc_run(&fs->data_bitmap, fs->block_device, count, &bit);
+    if (got) *first = fs->data_area_start_block + bit;
+    return got;
+}
+
+void efs_dealloc_data(easy_fs_t *fs, uint32_t block_id) {
+    /* 日志事务中：提交后才释放并清零 */
+    if (journal_defer_free(fs, block_id)) return;
+
+    /* 清零块 */
+    block_cache_t *cache = get_block_cache(block_id, fs->block_device);
+    memset(cache->cache, 0, BLOCK_SZ);
+    block_cache_mark_dirty(cache);
+    block_cache_release(cache);
+    /* 释放位图 */
+    bitmap_dealloc(&fs->data_bitmap, fs->block_device, block_id - fs->data_area_start_block);
+}
+
+easy_fs_t *efs_open(block_device_t *dev) {
+    block_cache_t *cache = get_block_cache(0, dev);
+    if (!cache) return NULL;
+    super_block_t sb_copy = *(super_block_t *)cache->cache;
+    super_block_t *sb = &sb_copy;
+    block_cache_release(cache);
+
+    if (sb->magic != EFS_MAGIC) {
+        return NULL;
+    }
+
+    easy_fs_t *fs = heap_alloc(sizeof(easy_fs_t), 8);
+    if (!fs) return NULL;
+
+    fs->block_device = dev;
+
+    bitmap_init(&fs->inode_bitmap, 1, sb->inode_bitmap_blocks,
+                (size_t)sb->inode_area_blocks * (BLOCK_SZ / sizeof(disk_inode_t)));
+
+    uint32_t inode_total_blocks = sb->inode_bitmap_blocks + sb->inode_area_blocks;
+    bitmap_init(&fs->data_bitmap, 1 + inode_total_blocks, sb->data_bitmap_blocks,
+                sb->data_area_blocks);
+
+    fs->inode_area_start_block = 1 + sb->inode_bitmap_blocks;
+    fs->data_area_start_block = 1 + inode_total_blocks + sb->data_bitmap_blocks;
+    fs->dir_indexes = NULL;
+    fs->journal = journal_open(fs, sb);
+
+    return fs;
+}
+
+inode_t *efs_root_inode(easy_fs_t *fs) {
+    return efs_iget(fs, 0);
+}
+
+/* ============================================================================
+ * 目录索引
+ * ========================================================================== */
+
+/**
+ * 目录的内存哈希索引：名字哈希 -> 目录项下标
+ *
+ * 首次在某个目录中查找时扫描一遍目录建立索引，之后 inode_create 添加目录项时
+ * 同步更新。候选项会读出磁盘上的目录项核对名字，因此哈希冲突或索引过时都不会
+ * 得到错误结果；磁盘格式不变。内存不足时该目录退回线性扫描。
+ */
+#define DIR_INDEX_INIT_BUCKETS  64
+#define DIRENTS_PER_BLOCK       (BLOCK_SZ / DIRENT_SZ)
+
+typedef struct dir_index_entry {
+    struct dir_index_entry *next;
+    uint32_t hash;
+    uint32_t slot;                      /* 目录项下标 */
+} dir_index_entry_t;
+
+typedef struct dir_index {
+    struct dir_index *next;             /* 同一文件系统中已建索引的目录 */
+    size_t block_id;                    /* 目录 inode 的位置 */
+    size_t block_offset;
+    dir_index_entry_t **buckets;
+    size_t nbuckets;                    /* 2 的幂 */
+    size_t count;
+    dir_index_entry_t *free_slots;      /* 已删除目录项留下的空位 */
+} dir_index_t;
+
+static kmem_cache_t g_dir_index_cache = KMEM_CACHE_INIT("dir_index", dir_index_t, NULL);
+static kmem_cache_t g_dir_entry_cache = KMEM_CACHE_INIT("dir_index_entry", dir_index_entry_t, NULL);
+
+/* FNV-1a */
+static uint32_t name_hash(const char *name) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < NAME_LENGTH_LIMIT && name[i]; i++) {
+        h = (h ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return h;
+}
+
+/* 负载超过 2 时桶数翻倍，分配失败则保持原样 */
+static void dir_index_grow(dir_index_t *idx) {
+    size_t n = idx->nbuckets * 2;
+    dir_index_entry_t **buckets = heap_alloc_zeroed(n * sizeof(*buckets), 8);
+    if (!buckets) return;
+
+    for (size_t i = 0; i < idx->nbuckets; i++) {
+        dir_index_entry_t *e = idx->buckets[i];
+        while (e) {
+            dir_index_entry_t *next = e->next;
+            e->next = buckets[e->hash & (n - 1)];
+            buckets[e->hash & (n - 1)] = e;
+            e = next;
+        }
+    }
+    heap_free(idx->buckets, idx->nbuckets * sizeof(*buckets));
+    idx->buckets = buckets;
+    idx->nbuckets = n;
+}
+
+static int dir_index_insert(dir_index_t *idx, uint32_t hash, uint32_t slot) {
+    dir_index_entry_t *e = kmem_cache_alloc(&g_dir_entry_cache);
+    if (!e) return -1;
+    e->hash = hash;
+    e->slot = slot;
+    e->next = idx->buckets[hash & (idx->nbuckets - 1)];
+    idx->buckets[hash & (idx->nbuckets - 1)] = e;
+    if (++idx->count > 2 * idx->nbuckets) {
+        dir_index_grow(idx);
+    }
+    return 0;
+}
+
+static int dir_index_push_free(dir_index_t *idx, uint32_t slot) {
+    dir_index_entry_t *e = kmem_cache_alloc(&g_dir_entry_cache);
+    if (!e) return -1;
+    e->hash = 0;
+    e->slot = slot;
+    e->next = idx->free_slots;
+    idx->free_slots = e;
+    return 0;
+}
+
+static void dir_index_free_list(dir_index_entry_t *e) {
+    while (e) {
+        dir_index_entry_t *next = e->next;
+        kmem_cache_free(&g_dir_entry_cache, e);
+        e = next;
+    }
+}
+
+static void dir_index_free(dir_index_t *idx) {
+    for (size_t i = 0; i < idx->nbuckets; i++) {
+        dir_index_free_list(idx->buckets[i]);
+    }
+    dir_index_free_list(idx->free_slots);
+    heap_free(idx->buckets, idx->nbuckets * sizeof(*idx->buckets));
+    kmem_cache_free(&g_dir_index_cache, idx);
 }
 
-/* 增加 inode 大小 */
-static void disk_inode_increase_size(disk_inode_t *di, uint32_t new_size, easy_fs_t *fs) {
-    if (new_size <= di->size) return;
+static dir_index_t *dir_index_lookup(inode_t *dir) {
+    for (dir_index_t *idx = dir->fs->dir_indexes; idx; idx = idx->next) {
+        if (idx->block_id == dir->block_id && idx->block_offset == dir->block_offset) {
+            return idx;
+        }
+    }
+    return NULL;
+}
 
-    uint32_t old_blocks = disk_inode_data_blocks(di->size);
-    uint32_t new_blocks = disk_inode_data_blocks(new_size);
-    di->size = new_size;
+/* 从链表中移除并释放目录的索引（之后的查找会重建） */
+static void dir_index_drop(inode_t *dir) {
+    for (dir_index_t **pp = &dir->fs->dir_indexes; *pp; pp = &(*pp)->next) {
+        dir_index_t *idx = *pp;
+        if (idx->block_id == dir->block_id && idx->block_offset == dir->block_offset) {
+            *pp = idx->next;
+            dir_index_free(idx);
+            return;
+        }
+    }
+}
 
-    uint32_t current = old_blocks;
-    block_device_t *dev = fs->block_device;
+/* 取得目录的索引，尚未建立时扫描目录建立；内存不足返回 NULL */
+static dir_index_t *dir_index_get(inode_t *dir, disk_inode_t *di) {
+    dir_index_t *idx = dir_index_lookup(dir);
+    if (idx) return idx;
+
+    idx = kmem_cache_alloc(&g_dir_index_cache);
+    if (!idx) return NULL;
+    idx->block_id = dir->block_id;
+    idx->block_offset = dir->block_offset;
+    idx->count = 0;
+    idx->free_slots = NULL;
+    idx->nbuckets = DIR_INDEX_INIT_BUCKETS;
+    idx->buckets = heap_alloc_zeroed(idx->nbuckets * sizeof(*idx->buckets), 8);
+    if (!idx->buckets) {
+        kmem_cache_free(&g_dir_index_cache, idx);
+        return NULL;
+    }
 
-    /* 填充 direct */
-    while (current < new_blocks && current < INODE_DIRECT_COUNT) {
-        di->direct[current] = efs_alloc_data(fs);
-        current++;
+    /* 按块读取目录项 */
+    size_t file_count = di->size / DIRENT_SZ;
+    dir_entry_t ents[DIRENTS_PER_BLOCK];
+    for (size_t i = 0; i < file_count; i += DIRENTS_PER_BLOCK) {
+        size_t n = file_count - i < DIRENTS_PER_BLOCK ? file_count - i : DIRENTS_PER_BLOCK;
+        disk_inode_read_at(di, i * DIRENT_SZ, (uint8_t *)ents, n * DIRENT_SZ, dir->fs->block_device);
+        for (size_t j = 0; j < n; j++) {
+            int r;
+            if (ents[j].name[0] == '\0') {
+                r = dir_index_push_free(idx, i + j);
+            } else {
+                r = dir_index_insert(idx, name_hash(ents[j].name), i + j);
+            }
+            if (r != 0) {
+                dir_index_free(idx);
+                return NULL;
+            }
+        }
     }
 
-    if (current >= new_blocks) return;
+    idx->next = dir->fs->dir_indexes;
+    dir->fs->dir_indexes = idx;
+    return idx;
+}
 
-    /* 分配 indirect1 */
-    if (old_blocks < INODE_DIRECT_COUNT && new_blocks > INODE_DIRECT_COUNT) {
-        di->indirect1 = efs_alloc_data(fs);
+/* 目录新增了下标为 slot 的目录项：已建索引时同步加入，失败则丢弃索引 */
+static void dir_index_add(inode_t *dir, const char *name, uint32_t slot) {
+    dir_index_t *idx = dir_index_lookup(dir);
+    if (idx && dir_index_insert(idx, name_hash(name), slot) != 0) {
+        dir_index_drop(dir);
     }
+}
 
-    /* 填充 indirect1 */
-    if (current < INODE_DIRECT_COUNT + INODE_INDIRECT1_COUNT) {
-        block_cache_t *cache = get_block_cache(di->indirect1, dev);
-        uint32_t *indirect1 = (uint32_t *)cache->cache;
-
-        while (current < new_blocks && current < INODE_DIRECT_COUNT + INODE_INDIRECT1_COUNT) {
-            indirect1[current - INODE_DIRECT_COUNT] = efs_alloc_data(fs);
-            cache->modified = true;
-            current++;
+/* 目录删除了下标为 slot 的目录项：从哈希表移到空位链表 */
+static void dir_index_remove(inode_t *dir, const char *name, uint32_t slot) {
+    dir_index_t *idx = dir_index_lookup(dir);
+    if (!idx) return;
+
+    uint32_t hash = name_hash(name);
+    for (dir_index_entry_t **pp = &idx->buckets[hash & (idx->nbuckets - 1)]; *pp; pp = &(*pp)->next) {
+        dir_index_entry_t *e = *pp;
+        if (e->slot == slot) {
+            *pp = e->next;
+            e->next = idx->free_slots;
+            idx->free_slots = e;
+            idx->count--;
+            return;
         }
     }
+}
 
-    /* indirect2 略（大文件支持） */
+/* 取出一个空位的下标，没有空位（或目录未建索引）返回 -1 */
+static long dir_index_take_free(inode_t *dir) {
+    dir_index_t *idx = dir_index_lookup(dir);
+    if (!idx || !idx->free_slots) return -1;
+
+    dir_index_entry_t *e = idx->free_slots;
+    idx->free_slots = e->next;
+    long slot = e->slot;
+    kmem_cache_free(&g_dir_entry_cache, e);
+    return slot;
 }
 
 /* ============================================================================
- * 文件系统操作
+ * inode 缓存与目录项缓存
  * ========================================================================== */
 
-void efs_get_disk_inode_pos(easy_fs_t *fs, uint32_t inode_id, uint32_t *block_id, size_t *offset) {
-    size_t inode_size = sizeof(disk_inode_t);
-    size_t inodes_per_block = BLOCK_SZ / inode_size;
-    *block_id = fs->inode_area_start_block + inode_id / inodes_per_block;
-    *offset = (inode_id % inodes_per_block) * inode_size;
+static name_cache_stats_t g_name_stats;
+
+/* 目录项缓存：固定数量的项，按 LRU 复用 */
+typedef struct dentry {
+    easy_fs_t *fs;                      /* NULL 表示空闲 */
+    uint32_t parent;                    /* 父目录 inode 号 */
+    int inode_id;                       /* -1 表示负项 */
+    uint32_t hash;
+    char name[NAME_LENGTH_LIMIT + 1];
+    struct dentry *hash_next;
+    struct dentry *lru_prev;
+    struct dentry *lru_next;
+} dentry_t;
+
+static dentry_t g_dentries[DENTRY_CACHE_SIZE];
+static dentry_t *g_dentry_buckets[DENTRY_CACHE_BUCKETS];
+static dentry_t g_dentry_lru;           /* LRU 循环链表哨兵，表头为最近使用 */
+
+static void dcache_init(void) {
+    if (g_dentry_lru.lru_next) return;
+    g_dentry_lru.lru_prev = g_dentry_lru.lru_next = &g_dentry_lru;
+    for (size_t i = 0; i < DENTRY_CACHE_SIZE; i++) {
+        dentry_t *d = &g_dentries[i];
+        d->lru_next = g_dentry_lru.lru_next;
+        d->lru_prev = &g_dentry_lru;
+        g_dentry_lru.lru_next->lru_prev = d;
+        g_dentry_lru.lru_next = d;
+    }
 }
 
-uint32_t efs_alloc_inode(easy_fs_t *fs) {
-    return bitmap_alloc(&fs->inode_bitmap, fs->block_device);
+static void dentry_touch(dentry_t *d) {
+    d->lru_prev->lru_next = d->lru_next;
+    d->lru_next->lru_prev = d->lru_prev;
+    d->lru_next = g_dentry_lru.lru_next;
+    d->lru_prev = &g_dentry_lru;
+    g_dentry_lru.lru_next->lru_prev = d;
+    g_dentry_lru.lru_next = d;
 }
 
-uint32_t efs_alloc_data(easy_fs_t *fs) {
-    int bit = bitmap_alloc(&fs->data_bitmap, fs->block_device);
-    return fs->data_area_start_block + bit;
+static inline uint32_t dentry_hash(uint32_t parent, const char *name) {
+    return name_hash(name) ^ (parent * 2654435761u);
 }
 
-void efs_dealloc_data(easy_fs_t *fs, uint32_t block_id) {
-    /* 清零块 */
-    block_cache_t *cache = get_block_cache(block_id, fs->block_device);
-    memset(cache->cache, 0, BLOCK_SZ);
-    cache->modified = true;
-    /* 释放位图 */
-    bitmap_dealloc(&fs->data_bitmap, fs->block_device, block_id - fs->data_area_start_block);
+static void dentry_unhash(dentry_t *d) {
+    dentry_t **pp = &g_dentry_buckets[d->hash & (DENTRY_CACHE_BUCKETS - 1)];
+    while (*pp != d) pp = &(*pp)->hash_next;
+    *pp = d->hash_next;
+    d->fs = NULL;
 }
 
-easy_fs_t *efs_open(block_device_t *dev) {
-    block_cache_t *cache = get_block_cache(0, dev);
-    super_block_t *sb = (super_block_t *)cache->cache;
+static dentry_t *dcache_find(inode_t *dir, const char *name, uint32_t hash) {
+    for (dentry_t *d = g_dentry_buckets[hash & (DENTRY_CACHE_BUCKETS - 1)]; d; d = d->hash_next) {
+        if (d->hash == hash && d->fs == dir->fs && d->parent == dir->inode_id &&
+            strcmp(d->name, name) == 0) {
+            return d;
+        }
+    }
+    return NULL;
+}
 
-    if (sb->magic != EFS_MAGIC) {
-        return NULL;
+/*
+ * 记录 dir 下 name 对应的 inode 号（-1 为负项）。超长的名字在磁盘上被截断，
+ * 截断后可能与另一个名字相同，因此不缓存。
+ */
+static void dcache_set(inode_t *dir, const char *name, int inode_id) {
+    if (strlen(name) > NAME_LENGTH_LIMIT) return;
+    dcache_init();
+
+    uint32_t hash = dentry_hash(dir->inode_id, name);
+    dentry_t *d = dcache_find(dir, name, hash);
+    if (!d) {
+        /* 复用最久未用的项 */
+        d = g_dentry_lru.lru_prev;
+        if (d->fs) dentry_unhash(d);
+        d->fs = dir->fs;
+        d->parent = dir->inode_id;
+        d->hash = hash;
+        strncpy(d->name, name, NAME_LENGTH_LIMIT + 1);
+        d->hash_next = g_dentry_buckets[hash & (DENTRY_CACHE_BUCKETS - 1)];
+        g_dentry_buckets[hash & (DENTRY_CACHE_BUCKETS - 1)] = d;
     }
+    d->inode_id = inode_id;
+    dentry_touch(d);
+}
 
-    easy_fs_t *fs = heap_alloc(sizeof(easy_fs_t), 8);
-    if (!fs) return NULL;
+/* 丢弃父目录为 parent 的所有项 */
+static void dcache_purge_parent(easy_fs_t *fs, uint32_t parent) {
+    for (size_t i = 0; i < DENTRY_CACHE_SIZE; i++) {
+        dentry_t *d = &g_dentries[i];
+        if (d->fs == fs && d->parent == parent) {
+            dentry_unhash(d);
+        }
+    }
+}
 
-    fs->block_device = dev;
+/* 查找目录项缓存，命中返回 true 并通过 inode_id 返回 inode 号（负项为 -1） */
+static bool dcache_lookup(inode_t *dir, const char *name, int *inode_id) {
+    if (!g_dentry_lru.lru_next || strlen(name) > NAME_LENGTH_LIMIT) return false;
+
+    dentry_t *d = dcache_find(dir, name, dentry_hash(dir->inode_id, name));
+    if (!d) {
+        g_name_stats.dentry_misses++;
+        return false;
+    }
+    dentry_touch(d);
+    *inode_id = d->inode_id;
+    if (d->inode_id < 0) {
+        g_name_stats.dentry_negative_hits++;
+    } else {
+        g_name_stats.dentry_hits++;
+    }
+    return true;
+}
 
-    fs->inode_bitmap.start_block_id = 1;
-    fs->inode_bitmap.blocks = sb->inode_bitmap_blocks;
+static inode_t *g_inode_buckets[INODE_CACHE_BUCKETS];
+static inode_t g_inode_lru = { .lru_prev = &g_inode_lru, .lru_next = &g_inode_lru };
+static size_t g_inode_unused;
 
-    uint32_t inode_total_blocks = sb->inode_bitmap_blocks + sb->inode_area_blocks;
-    fs->data_bitmap.start_block_id = 1 + inode_total_blocks;
-    fs->data_bitmap.blocks = sb->data_bitmap_blocks;
+static inline size_t inode_hash(easy_fs_t *fs, uint32_t inode_id) {
+    return (inode_id ^ ((uintptr_t)fs >> 4)) & (INODE_CACHE_BUCKETS - 1);
+}
 
-    fs->inode_area_start_block = 1 + sb->inode_bitmap_blocks;
-    fs->data_area_start_block = 1 + inode_total_blocks + sb->data_bitmap_blocks;
+static void inode_lru_unlink(inode_t *inode) {
+    inode->lru_prev->lru_next = inode->lru_next;
+    inode->lru_next->lru_prev = inode->lru_prev;
+}
 
-    return fs;
+static void inode_hash_remove(inode_t *inode) {
+    inode_t **pp = &g_inode_buckets[inode_hash(inode->fs, inode->inode_id)];
+    while (*pp != inode) pp = &(*pp)->hash_next;
+    *pp = inode->hash_next;
 }
 
-inode_t *efs_root_inode(easy_fs_t *fs) {
-    inode_t *inode = heap_alloc(sizeof(inode_t), 8);
+inode_t *efs_iget(easy_fs_t *fs, uint32_t inode_id) {
+    size_t h = inode_hash(fs, inode_id);
+    for (inode_t *inode = g_inode_buckets[h]; inode; inode = inode->hash_next) {
+        if (inode->fs == fs && inode->inode_id == inode_id) {
+            if (inode->ref++ == 0) {
+                inode_lru_unlink(inode);
+                g_inode_unused--;
+            }
+            g_name_stats.inode_hits++;
+            return inode;
+        }
+    }
+    g_name_stats.inode_misses++;
+
+    inode_t *inode = kmem_cache_alloc(&g_inode_cache);
     if (!inode) return NULL;
 
     uint32_t block_id;
     size_t offset;
-    efs_get_disk_inode_pos(fs, 0, &block_id, &offset);
+    efs_get_disk_inode_pos(fs, inode_id, &block_id, &offset);
 
     inode->block_id = block_id;
     inode->block_offset = offset;
     inode->fs = fs;
+    inode->inode_id = inode_id;
+    inode->ref = 1;
+    inode->unlinked = false;
+    inode->hash_next = g_inode_buckets[h];
+    g_inode_buckets[h] = inode;
+    return inode;
+}
 
+inode_t *inode_dup(inode_t *inode) {
+    inode->ref++;
     return inode;
 }
 
+void inode_put(inode_t *inode) {
+    if (!inode || --inode->ref > 0) return;
+
+    /* 已删除：回收数据块与 inode，并丢弃以它为父目录的缓存（inode 号会被复用） */
+    if (inode->unlinked) {
+        inode_hash_remove(inode);
+        dir_index_drop(inode);
+        dcache_purge_parent(inode->fs, inode->inode_id);
+        journal_begin();
+        inode_clear(inode);
+        efs_dealloc_inode(inode->fs, inode->inode_id);
+        journal_end();
+        kmem_cache_free(&g_inode_cache, inode);
+        return;
+    }
+
+    /* 放到未引用 LRU 表头，超出上限时释放最久未用的 */
+    inode->lru_next = g_inode_lru.lru_next;
+    inode->lru_prev = &g_inode_lru;
+    g_inode_lru.lru_next->lru_prev = inode;
+    g_inode_lru.lru_next = inode;
+    if (++g_inode_unused > INODE_CACHE_UNUSED_MAX) {
+        inode_t *victim = g_inode_lru.lru_prev;
+        inode_lru_unlink(victim);
+        inode_hash_remove(victim);
+        kmem_cache_free(&g_inode_cache, victim);
+        g_inode_unused--;
+    }
+}
+
+void name_cache_get_stats(name_cache_stats_t *stats) {
+    *stats = g_name_stats;
+}
+
 /* ============================================================================
  * Inode 操作
  * ========================================================================== */
 
-static disk_inode_t *inode_get_disk_inode(inode_t *inode) {
-    block_cache_t *cache = get_block_cache(inode->block_id, inode->fs->block_device);
-    return (disk_inode_t *)(cache->cache + inode->block_offset);
+/* 取得 inode 所在的缓存块（已钉住，用完须 block_cache_release） */
+static block_cache_t *inode_get_cache(inode_t *inode) {
+    return get_block_cache(inode->block_id, inode->fs->block_device);
 }
 
-static void inode_mark_modified(inode_t *inode) {
-    block_cache_t *cache = get_block_cache(inode->block_id, inode->fs->block_device);
-    cache->modified = true;
+static inline disk_inode_t *cache_disk_inode(block_cache_t *cache, inode_t *inode) {
+    return (disk_inode_t *)(cache->cache + inode->block_offset);
 }
 
-static int inode_find_inode_id(inode_t *dir, const char *name, disk_inode_t *di) {
-    if (di->type_ != INODE_DIRECTORY) return -1;
+/* 在目录中查找名字，返回 inode 号并通过 slot（可为 NULL）返回目录项下标，不存在返回 -1 */
+static int inode_find_inode_id(inode_t *dir, const char *name, disk_inode_t *di, size_t *slot) {
+    if (di->type_ != INODE_DIRECTORY || name[0] == '\0') return -1;
 
     size_t file_count = di->size / DIRENT_SZ;
     dir_entry_t dirent;
 
+    dir_index_t *idx = dir_index_get(dir, di);
+    if (idx) {
+        uint32_t hash = name_hash(name);
+        for (dir_index_entry_t *e = idx->buckets[hash & (idx->nbuckets - 1)]; e; e = e->next) {
+            if (e->hash != hash || e->slot >= file_count) continue;
+            disk_inode_read_at(di, e->slot * DIRENT_SZ, (uint8_t *)&dirent, DIRENT_SZ,
+                               dir->fs->block_device);
+            if (strcmp(dirent.name, name) == 0) {
+                if (slot) *slot = e->slot;
+                return dirent.inode_number;
+            }
+        }
+        return -1;
+    }
+
     for (size_t i = 0; i < file_count; i++) {
         disk_inode_read_at(di, i * DIRENT_SZ, (uint8_t *)&dirent, DIRENT_SZ, dir->fs->block_device);
         if (strcmp(dirent.name, name) == 0) {
+            if (slot) *slot = i;
             return dirent.inode_number;
         }
     }
@@ -327,29 +1876,96 @@ static int inode_find_inode_id(inode_t *dir, const char *name, disk_inode_t *di)
 }
 
 inode_t *inode_find(inode_t *dir, const char *name) {
-    disk_inode_t *di = inode_get_disk_inode(dir);
-    int inode_id = inode_find_inode_id(dir, name, di);
+    int inode_id;
+    if (!dcache_lookup(dir, name, &inode_id)) {
+        block_cache_t *cache = inode_get_cache(dir);
+        inode_id = inode_find_inode_id(dir, name, cache_disk_inode(cache, dir), NULL);
+        block_cache_release(cache);
+        dcache_set(dir, name, inode_id);
+    }
     if (inode_id < 0) return NULL;
+    return efs_iget(dir->fs, inode_id);
+}
 
-    inode_t *inode = heap_alloc(sizeof(inode_t), 8);
-    if (!inode) return NULL;
+bool inode_is_dir(inode_t *inode) {
+    block_cache_t *cache = inode_get_cache(inode);
+    bool is_dir = cache_disk_inode(cache, inode)->type_ == INODE_DIRECTORY;
+    block_cache_release(cache);
+    return is_dir;
+}
 
-    uint32_t block_id;
-    size_t offset;
-    efs_get_disk_inode_pos(dir->fs, inode_id, &block_id, &offset);
+/* 在目录中添加目录项：优先复用已删除的空位，否则追加到末尾 */
+static int dir_add_entry(inode_t *dir, const char *name, uint32_t inode_id) {
+    easy_fs_t *fs = dir->fs;
+    block_cache_t *dir_cache = inode_get_cache(dir);
+    disk_inode_t *dir_di = cache_disk_inode(dir_cache, dir);
+
+    dir_index_get(dir, dir_di);
+    long slot = dir_index_take_free(dir);
+    if (slot < 0) {
+        slot = dir_di->size / DIRENT_SZ;
+        uint32_t size = disk_inode_increase_size(dir_di, (slot + 1) * DIRENT_SZ, fs);
+        block_cache_mark_dirty(dir_cache);
+        if (size < (slot + 1) * DIRENT_SZ) {
+            block_cache_release(dir_cache);
+            return -1;
+        }
+    }
 
-    inode->block_id = block_id;
-    inode->block_offset = offset;
-    inode->fs = dir->fs;
+    dir_entry_t dirent;
+    memset(&dirent, 0, sizeof(dirent));
+    strncpy(dirent.name, name, NAME_LENGTH_LIMIT);
+    dirent.inode_number = inode_id;
 
-    return inode;
+    disk_inode_write_at(dir_di, slot * DIRENT_SZ, (uint8_t *)&dirent, DIRENT_SZ, fs->block_device);
+    block_cache_release(dir_cache);
+    dir_index_add(dir, dirent.name, slot);
+    dcache_set(dir, name, inode_id);
+    return 0;
 }
 
-inode_t *inode_create(inode_t *dir, const char *name) {
+/* 清空下标为 slot 的目录项，留下空位 */
+static void dir_remove_entry(inode_t *dir, size_t slot, const char *name) {
+    block_cache_t *dir_cache = inode_get_cache(dir);
+    dir_entry_t dirent;
+    memset(&dirent, 0, sizeof(dirent));
+    disk_inode_write_at(cache_disk_inode(dir_cache, dir), slot * DIRENT_SZ, (uint8_t *)&dirent,
+                        DIRENT_SZ, dir->fs->block_device);
+    block_cache_release(dir_cache);
+    dir_index_remove(dir, name, slot);
+    dcache_set(dir, name, -1);
+}
+
+/* 目录中除 "." 与 ".." 外没有目录项 */
+static bool dir_is_empty(inode_t *dir) {
+    block_cache_t *cache = inode_get_cache(dir);
+    disk_inode_t *di = cache_disk_inode(cache, dir);
+    size_t file_count = di->size / DIRENT_SZ;
+    bool empty = true;
+
+    dir_entry_t dirent;
+    for (size_t i = 0; i < file_count && empty; i++) {
+        disk_inode_read_at(di, i * DIRENT_SZ, (uint8_t *)&dirent, DIRENT_SZ, dir->fs->block_device);
+        if (dirent.name[0] != '\0' && strcmp(dirent.name, ".") != 0 && strcmp(dirent.name, "..") != 0) {
+            empty = false;
+        }
+    }
+    block_cache_release(cache);
+    return empty;
+}
+
+static inode_t *inode_create_type(inode_t *dir, const char *name, inode_type_t type) {
     easy_fs_t *fs = dir->fs;
+    if (dir->unlinked) return NULL;
+
+    journal_begin();
 
     /* 分配新 inode */
-    uint32_t new_inode_id = efs_alloc_inode(fs);
+    int new_inode_id = efs_alloc_inode(fs);
+    if (new_inode_id < 0) {
+        journal_end();
+        return NULL;
+    }
 
     /* 初始化新 inode */
     uint32_t new_block_id;
@@ -359,57 +1975,214 @@ inode_t *inode_create(inode_t *dir, const char *name) {
     block_cache_t *new_cache = get_block_cache(new_block_id, fs->block_device);
     disk_inode_t *new_di = (disk_inode_t *)(new_cache->cache + new_offset);
     memset(new_di, 0, sizeof(disk_inode_t));
-    new_di->type_ = INODE_FILE;
-    new_cache->modified = true;
+    new_di->type_ = type;
+    block_cache_mark_dirty(new_cache);
+    block_cache_release(new_cache);
+
+    inode_t *inode = efs_iget(fs, new_inode_id);
+    if (!inode) {
+        efs_dealloc_inode(fs, new_inode_id);
+        journal_end();
+        return NULL;
+    }
 
-    /* 在目录中添加目录项 */
-    disk_inode_t *dir_di = inode_get_disk_inode(dir);
-    size_t file_count = dir_di->size / DIRENT_SZ;
-    uint32_t new_size = (file_count + 1) * DIRENT_SZ;
+    /* 空间不足：新 inode 按已删除处理，释放时一并回收 */
+    if ((type == INODE_DIRECTORY &&
+         (dir_add_entry(inode, ".", new_inode_id) != 0 ||
+          dir_add_entry(inode, "..", dir->inode_id) != 0)) ||
+        dir_add_entry(dir, name, new_inode_id) != 0) {
+        inode->unlinked = true;
+        inode_put(inode);
+        journal_end();
+        return NULL;
+    }
+
+    journal_end();
+    return inode;
+}
 
-    disk_inode_increase_size(dir_di, new_size, fs);
-    inode_mark_modified(dir);
+inode_t *inode_create(inode_t *dir, const char *name) {
+    return inode_create_type(dir, name, INODE_FILE);
+}
 
-    /* 写目录项 */
-    dir_entry_t dirent;
-    memset(&dirent, 0, sizeof(dirent));
-    strncpy(dirent.name, name, NAME_LENGTH_LIMIT);
-    dirent.inode_number = new_inode_id;
+inode_t *inode_mkdir(inode_t *dir, const char *name) {
+    inode_t *exist = inode_find(dir, name);
+    if (exist) {
+        inode_put(exist);
+        return NULL;
+    }
+    return inode_create_type(dir, name, INODE_DIRECTORY);
+}
 
-    disk_inode_write_at(dir_di, file_count * DIRENT_SZ, (uint8_t *)&dirent, DIRENT_SZ, fs->block_device);
+static int inode_remove(inode_t *dir, const char *name, bool want_dir) {
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) return -1;
+
+    block_cache_t *cache = inode_get_cache(dir);
+    size_t slot;
+    int inode_id = inode_find_inode_id(dir, name, cache_disk_inode(cache, dir), &slot);
+    block_cache_release(cache);
+    if (inode_id < 0) return -1;
+
+    inode_t *inode = efs_iget(dir->fs, inode_id);
+    if (!inode) return -1;
+    bool is_dir = inode_is_dir(inode);
+    if (is_dir != want_dir || (is_dir && !dir_is_empty(inode))) {
+        inode_put(inode);
+        return -1;
+    }
 
-    block_cache_sync_all();
+    /* 仍被打开时推迟到最后一个引用释放时回收 */
+    journal_begin();
+    dir_remove_entry(dir, slot, name);
+    inode->unlinked = true;
+    inode_put(inode);
+    journal_end();
+    return 0;
+}
 
-    /* 返回新 inode */
-    inode_t *inode = heap_alloc(sizeof(inode_t), 8);
-    if (!inode) return NULL;
+int inode_unlink(inode_t *dir, const char *name) {
+    return inode_remove(dir, name, false);
+}
 
-    inode->block_id = new_block_id;
-    inode->block_offset = new_offset;
-    inode->fs = fs;
+int inode_rmdir(inode_t *dir, const char *name) {
+    return inode_remove(dir, name, true);
+}
 
-    return inode;
+/* 把目录项 name 指向的 inode 号改为 inode_id */
+static void dir_set_entry(inode_t *dir, const char *name, uint32_t inode_id) {
+    block_cache_t *cache = inode_get_cache(dir);
+    disk_inode_t *di = cache_disk_inode(cache, dir);
+    size_t slot;
+    if (inode_find_inode_id(dir, name, di, &slot) >= 0) {
+        disk_inode_write_at(di, slot * DIRENT_SZ + offsetof(dir_entry_t, inode_number),
+                            (uint8_t *)&inode_id, sizeof(inode_id), dir->fs->block_device);
+        dcache_set(dir, name, inode_id);
+    }
+    block_cache_release(cache);
+}
+
+/* ancestor 是否为 dir 自身或其祖先目录 */
+static bool dir_is_ancestor(inode_t *ancestor, inode_t *dir) {
+    inode_t *cur = inode_dup(dir);
+    bool found = false;
+    while (cur) {
+        if (cur->inode_id == ancestor->inode_id) {
+            found = true;
+            break;
+        }
+        if (cur->inode_id == 0) break;
+        inode_t *parent = inode_find(cur, "..");
+        inode_put(cur);
+        cur = parent;
+    }
+    inode_put(cur);
+    return found;
+}
+
+int inode_rename(inode_t *old_dir, const char *old_name, inode_t *new_dir, const char *new_name) {
+    if (strcmp(old_name, ".") == 0 || strcmp(old_name, "..") == 0 ||
+        strcmp(new_name, ".") == 0 || strcmp(new_name, "..") == 0 ||
+        new_name[0] == '\0' || strlen(new_name) > NAME_LENGTH_LIMIT || new_dir->unlinked) {
+        return -1;
+    }
+
+    block_cache_t *cache = inode_get_cache(old_dir);
+    size_t slot;
+    int inode_id = inode_find_inode_id(old_dir, old_name, cache_disk_inode(cache, old_dir), &slot);
+    block_cache_release(cache);
+    if (inode_id < 0) return -1;
+    if (old_dir == new_dir && strcmp(old_name, new_name) == 0) return 0;
+
+    inode_t *src = efs_iget(old_dir->fs, inode_id);
+    if (!src) return -1;
+    bool src_dir = inode_is_dir(src);
+    if (src_dir && dir_is_ancestor(src, new_dir)) {
+        inode_put(src);
+        return -1;
+    }
+
+    /* 覆盖目标、添加与删除目录项在同一事务中 */
+    journal_begin();
+    inode_t *target = inode_find(new_dir, new_name);
+    if (target) {
+        bool target_dir = inode_is_dir(target);
+        inode_put(target);
+        if (src_dir || target_dir || inode_unlink(new_dir, new_name) != 0) {
+            inode_put(src);
+            journal_end();
+            return -1;
+        }
+    }
+
+    if (dir_add_entry(new_dir, new_name, inode_id) != 0) {
+        inode_put(src);
+        journal_end();
+        return -1;
+    }
+    dir_remove_entry(old_dir, slot, old_name);
+    if (src_dir && old_dir != new_dir) {
+        dir_set_entry(src, "..", new_dir->inode_id);
+    }
+    inode_put(src);
+    journal_end();
+    return 0;
 }
 
 size_t inode_read_at(inode_t *inode, size_t offset, uint8_t *buf, size_t len) {
-    disk_inode_t *di = inode_get_disk_inode(inode);
-    return disk_inode_read_at(di, offset, buf, len, inode->fs->block_device);
+    block_cache_t *cache = inode_get_cache(inode);
+    size_t result = disk_inode_read_at(cache_disk_inode(cache, inode), offset, buf, len,
+                                       inode->fs->block_device);
+    block_cache_release(cache);
+    return result;
 }
 
 size_t inode_write_at(inode_t *inode, size_t offset, const uint8_t *buf, size_t len) {
-    disk_inode_t *di = inode_get_disk_inode(inode);
+    /* 截断到单个文件的最大长度 */
+    size_t max_size = (size_t)INODE_MAX_BLOCKS * BLOCK_SZ;
+    if (offset >= max_size) return 0;
+    if (len > max_size - offset) len = max_size - offset;
+
+    block_cache_t *cache = inode_get_cache(inode);
+    disk_inode_t *di = cache_disk_inode(cache, inode);
     uint32_t new_size = offset + len;
-    if (new_size > di->size) {
-        disk_inode_increase_size(di, new_size, inode->fs);
-        inode_mark_modified(inode);
+
+    /* 分段扩容，每段一个操作，限制单个事务修改的索引块与位图块数；
+     * 空间不足时停在已分配的大小，写入相应变短 */
+    while (new_size > di->size) {
+        uint32_t step = (disk_inode_data_blocks(di->size) + JOURNAL_EXTEND_BLOCKS) * BLOCK_SZ;
+        if (step > new_size) step = new_size;
+        journal_begin();
+        uint32_t size = disk_inode_increase_size(di, step, inode->fs);
+        block_cache_mark_dirty(cache);
+        journal_end();
+        if (size < step) break;
     }
+
+    /* 文件数据不经过日志；disk_inode_write_at 截断到 di->size */
     size_t result = disk_inode_write_at(di, offset, buf, len, inode->fs->block_device);
-    block_cache_sync_all();
+    block_cache_release(cache);
+    if (!inode->fs->journal) block_cache_commit();
     return result;
 }
 
+/* 释放一级索引块的前 count 个数据块及索引块本身 */
+static void free_index_block(easy_fs_t *fs, uint32_t block_id, uint32_t count) {
+    block_cache_t *cache = get_block_cache(block_id, fs->block_device);
+    uint32_t *ids = (uint32_t *)cache->cache;
+    if (count > INODE_INDIRECT1_COUNT) count = INODE_INDIRECT1_COUNT;
+    for (uint32_t i = 0; i < count; i++) {
+        if (ids[i] != 0) {
+            efs_dealloc_data(fs, ids[i]);
+        }
+    }
+    block_cache_release(cache);
+    efs_dealloc_data(fs, block_id);
+}
+
 void inode_clear(inode_t *inode) {
-    disk_inode_t *di = inode_get_disk_inode(inode);
+    journal_begin();
+    block_cache_t *inode_cache = inode_get_cache(inode);
+    disk_inode_t *di = cache_disk_inode(inode_cache, inode);
     easy_fs_t *fs = inode->fs;
 
     /* 释放数据块 */
@@ -423,54 +2196,256 @@ void inode_clear(inode_t *inode) {
 
     /* 处理 indirect1 */
     if (di->indirect1 != 0 && data_blocks > INODE_DIRECT_COUNT) {
-        block_cache_t *cache = get_block_cache(di->indirect1, fs->block_device);
-        uint32_t *indirect1 = (uint32_t *)cache->cache;
-        for (uint32_t i = 0; i < data_blocks - INODE_DIRECT_COUNT && i < INODE_INDIRECT1_COUNT; i++) {
-            if (indirect1[i] != 0) {
-                efs_dealloc_data(fs, indirect1[i]);
+        free_index_block(fs, di->indirect1, data_blocks - INODE_DIRECT_COUNT);
+        di->indirect1 = 0;
+    }
+
+    /* 处理 indirect2 */
+    if (di->indirect2 != 0 && data_blocks > INODE_DIRECT_COUNT + INODE_INDIRECT1_COUNT) {
+        uint32_t remain = data_blocks - INODE_DIRECT_COUNT - INODE_INDIRECT1_COUNT;
+        block_cache_t *cache2 = get_block_cache(di->indirect2, fs->block_device);
+        uint32_t *indirect2 = (uint32_t *)cache2->cache;
+        for (uint32_t a = 0; remain > 0 && a < INODE_INDIRECT1_COUNT; a++) {
+            uint32_t n = remain < INODE_INDIRECT1_COUNT ? remain : INODE_INDIRECT1_COUNT;
+            if (indirect2[a] != 0) {
+                free_index_block(fs, indirect2[a], n);
             }
+            remain -= n;
         }
-        efs_dealloc_data(fs, di->indirect1);
-        di->indirect1 = 0;
+        block_cache_release(cache2);
+        efs_dealloc_data(fs, di->indirect2);
+        di->indirect2 = 0;
     }
 
     di->size = 0;
-    inode_mark_modified(inode);
-    block_cache_sync_all();
+    block_cache_mark_dirty(inode_cache);
+    block_cache_release(inode_cache);
+    journal_end();
 }
 
 size_t inode_readdir(inode_t *dir, char names[][NAME_LENGTH_LIMIT + 1], size_t max_count) {
-    disk_inode_t *di = inode_get_disk_inode(dir);
+    block_cache_t *cache = inode_get_cache(dir);
+    disk_inode_t *di = cache_disk_inode(cache, dir);
     size_t file_count = di->size / DIRENT_SZ;
-    if (file_count > max_count) file_count = max_count;
 
     dir_entry_t dirent;
-    for (size_t i = 0; i < file_count; i++) {
+    size_t count = 0;
+    for (size_t i = 0; i < file_count && count < max_count; i++) {
         disk_inode_read_at(di, i * DIRENT_SZ, (uint8_t *)&dirent, DIRENT_SZ, dir->fs->block_device);
-        strncpy(names[i], dirent.name, NAME_LENGTH_LIMIT);
-        names[i][NAME_LENGTH_LIMIT] = '\0';
+        if (dirent.name[0] == '\0') continue;      /* 已删除的空位 */
+        strncpy(names[count], dirent.name, NAME_LENGTH_LIMIT);
+        names[count][NAME_LENGTH_LIMIT] = '\0';
+        count++;
     }
+    block_cache_release(cache);
 
-    return file_count;
+    return count;
 }
 
 uint32_t inode_size(inode_t *inode) {
-    disk_inode_t *di = inode_get_disk_inode(inode);
-    return di->size;
+    block_cache_t *cache = inode_get_cache(inode);
+    uint32_t size = cache_disk_inode(cache, inode)->size;
+    block_cache_release(cache);
+    return size;
+}
+
+size_t inode_prefetch(inode_t *inode, size_t offset, size_t len) {
+    block_device_t *dev = inode->fs->block_device;
+    if (!dev->start) return 0;
+
+    block_cache_t *cache = inode_get_cache(inode);
+    disk_inode_t *di = cache_disk_inode(cache, inode);
+    size_t end = offset + len;
+    if (end > di->size) end = di->size;
+
+    size_t pending = 0;
+    if (offset < end) {
+        block_map_t map;
+        block_map_init(&map, di, dev);
+        if (dev->plug) dev->plug(dev);
+        for (size_t i = offset / BLOCK_SZ; i <= (end - 1) / BLOCK_SZ; i++) {
+            int r = block_cache_prefetch(block_map_get(&map, i), dev);
+            if (r < 0) break;       /* 缓存项或描述符用尽，其余块读取时同步读入 */
+            pending += r;
+        }
+        if (dev->unplug) dev->unplug(dev);
+        block_map_done(&map);
+    }
+    block_cache_release(cache);
+    return pending;
+}
+
+/* ============================================================================
+ * 路径解析
+ * ========================================================================== */
+
+inode_t *efs_walk(easy_fs_t *fs, inode_t *base, const char *path, char *last) {
+    inode_t *cur = (!base || path[0] == '/') ? efs_root_inode(fs) : inode_dup(base);
+    char comp[NAME_LENGTH_LIMIT + 1];
+
+    while (cur) {
+        while (*path == '/') path++;
+        if (*path == '\0') break;
+
+        size_t len = 0;
+        while (path[len] && path[len] != '/') len++;
+        if (len > NAME_LENGTH_LIMIT) break;
+        memcpy(comp, path, len);
+        comp[len] = '\0';
+        path += len;
+
+        /* 最后一个分量：交给调用者 */
+        const char *rest = path;
+        while (*rest == '/') rest++;
+        if (last && *rest == '\0') {
+            if (strcmp(comp, ".") == 0 || strcmp(comp, "..") == 0) break;
+            memcpy(last, comp, len + 1);
+            return cur;
+        }
+
+        if (strcmp(comp, ".") == 0) continue;
+        if (strcmp(comp, "..") == 0 && cur->inode_id == 0) continue;
+
+        inode_t *next = inode_find(cur, comp);
+        inode_put(cur);
+        cur = next;
+    }
+
+    /* 分量过长，或要求最后一个分量却没有（如 "/"） */
+    if (cur && (*path != '\0' || last)) {
+        inode_put(cur);
+        return NULL;
+    }
+    return cur;
+}
+
+int efs_mkdir(easy_fs_t *fs, inode_t *base, const char *path) {
+    char name[NAME_LENGTH_LIMIT + 1];
+    inode_t *dir = efs_walk(fs, base, path, name);
+    if (!dir) return -1;
+    inode_t *inode = inode_mkdir(dir, name);
+    inode_put(dir);
+    if (!inode) return -1;
+    inode_put(inode);
+    return 0;
+}
+
+int efs_unlink(easy_fs_t *fs, inode_t *base, const char *path, bool dir) {
+    char name[NAME_LENGTH_LIMIT + 1];
+    inode_t *parent = efs_walk(fs, base, path, name);
+    if (!parent) return -1;
+    int ret = dir ? inode_rmdir(parent, name) : inode_unlink(parent, name);
+    inode_put(parent);
+    return ret;
+}
+
+int efs_rename(easy_fs_t *fs, inode_t *old_base, const char *old_path,
+               inode_t *new_base, const char *new_path) {
+    char old_name[NAME_LENGTH_LIMIT + 1];
+    char new_name[NAME_LENGTH_LIMIT + 1];
+    inode_t *old_dir = efs_walk(fs, old_base, old_path, old_name);
+    if (!old_dir) return -1;
+    inode_t *new_dir = efs_walk(fs, new_base, new_path, new_name);
+    if (!new_dir) {
+        inode_put(old_dir);
+        return -1;
+    }
+    int ret = inode_rename(old_dir, old_name, new_dir, new_name);
+    inode_put(old_dir);
+    inode_put(new_dir);
+    return ret;
 }
 
 /* ============================================================================
  * 文件操作
  * ========================================================================== */
 
+static uint32_t g_ra_init = READAHEAD_DEFAULT_INIT;
+static uint32_t g_ra_max = READAHEAD_DEFAULT_MAX;
+
+void efs_set_readahead(uint32_t init, uint32_t max) {
+    g_ra_init = init ? init : 1;
+    g_ra_max = max;
+}
+
+/**
+ * 为文件内块 [from, to) 发起预读
+ *
+ * 索引块不在缓存中时只预读索引块并停下，下次触发时再继续映射其后的数据块。
+ *
+ * @return 预读推进到的文件内块号
+ */
+static uint32_t inode_readahead(inode_t *inode, uint32_t from, uint32_t to) {
+    block_device_t *dev = inode->fs->block_device;
+    block_cache_t *cache = inode_get_cache(inode);
+    disk_inode_t *di = cache_disk_inode(cache, inode);
+    uint32_t blocks = (di->size + BLOCK_SZ - 1) / BLOCK_SZ;
+    if (to > blocks) to = blocks;
+
+    size_t issued = g_cache_stats.async_reads;
+    uint32_t i = from;
+    block_map_t map;
+    block_map_init(&map, di, dev);
+    if (dev->plug) dev->plug(dev);
+    for (; i < to; i++) {
+        if (block_map_prefetch_index(&map, i) != 0) break;
+        if (block_cache_prefetch(block_map_get(&map, i), dev) < 0) break;
+    }
+    if (dev->unplug) dev->unplug(dev);
+    block_map_done(&map);
+    block_cache_release(cache);
+
+    g_cache_stats.readahead += g_cache_stats.async_reads - issued;
+    return i;
+}
+
+/* 根据本次读取 [offset, offset + len) 更新顺序读状态，需要时向后预读 */
+static void file_readahead(file_handle_t *fh, size_t offset, size_t len) {
+    readahead_t *ra = &fh->ra;
+    bool sequential = offset == 0 || offset == ra->next;
+    ra->next = offset + len;
+    if (!sequential) {
+        ra->window = 0;
+        ra->ahead = 0;
+        return;
+    }
+
+    /*
+     * 新发起的窗口、上一窗口未读到的半个窗口、以及期间读过的一个窗口同时留在
+     * LRU 上（读过的块更靠近表头），窗口超过缓存的 1/4 时预读的块会在读到前被淘汰
+     */
+    uint32_t max = g_ra_max;
+    if (max > g_cache_capacity / 4) max = g_cache_capacity / 4;
+    if (len == 0 || max == 0 || !fh->inode->fs->block_device->start) return;
+
+    uint32_t cur = (offset + len) / BLOCK_SZ;   /* 下一次读取开始的块 */
+    if (ra->window == 0) {
+        ra->window = g_ra_init < max ? g_ra_init : max;
+    } else if (ra->ahead > cur && ra->ahead - cur > ra->window / 2) {
+        return;     /* 已预读的块还够用 */
+    } else {
+        ra->window = ra->window * 2 < max ? ra->window * 2 : max;
+    }
+    if (ra->ahead < cur) ra->ahead = cur;
+    ra->ahead = inode_readahead(fh->inode, ra->ahead, ra->ahead + ra->window);
+}
+
 file_handle_t *file_open(easy_fs_t *fs, const char *path, uint32_t flags) {
-    inode_t *root = efs_root_inode(fs);
-    if (!root) return NULL;
+    char name[NAME_LENGTH_LIMIT + 1];
+    inode_t *dir = efs_walk(fs, NULL, path, name);
+    if (!dir) return NULL;
 
     bool readable = (flags == O_RDONLY) || (flags & O_RDWR);
     bool writable = (flags & O_WRONLY) || (flags & O_RDWR);
 
-    inode_t *inode = inode_find(root, path);
+    inode_t *inode = inode_find(dir, name);
+
+    /* 目录只能只读打开（用于 getdents64） */
+    if (inode && (writable || (flags & (O_CREATE | O_TRUNC))) && inode_is_dir(inode)) {
+        inode_put(inode);
+        inode_put(dir);
+        return NULL;
+    }
 
     if (flags & O_CREATE) {
         if (inode) {
@@ -478,11 +2453,11 @@ file_handle_t *file_open(easy_fs_t *fs, const char *path, uint32_t flags) {
             inode_clear(inode);
         } else {
             /* 创建新文件 */
-            inode = inode_create(root, path);
+            inode = inode_create(dir, name);
         }
     } else {
         if (!inode) {
-            heap_free(root, sizeof(inode_t));
+            inode_put(dir);
             return NULL;
         }
         if (flags & O_TRUNC) {
@@ -490,30 +2465,46 @@ file_handle_t *file_open(easy_fs_t *fs, const char *path, uint32_t flags) {
         }
     }
 
-    heap_free(root, sizeof(inode_t));
+    inode_put(dir);
 
     if (!inode) return NULL;
 
-    file_handle_t *fh = heap_alloc(sizeof(file_handle_t), 8);
+    file_handle_t *fh = file_alloc(inode, readable, writable);
     if (!fh) {
-        heap_free(inode, sizeof(inode_t));
+        inode_put(inode);
         return NULL;
     }
+    return fh;
+}
+
+file_handle_t *file_alloc(inode_t *inode, bool readable, bool writable) {
+    file_handle_t *fh = kmem_cache_alloc(&g_file_cache);
+    if (!fh) return NULL;
 
     fh->inode = inode;
     fh->readable = readable;
     fh->writable = writable;
     fh->offset = 0;
+    memset(&fh->ra, 0, sizeof(fh->ra));
 
     return fh;
 }
 
+file_handle_t *file_dup(const file_handle_t *fh) {
+    file_handle_t *dup = kmem_cache_alloc(&g_file_cache);
+    if (!dup) return NULL;
+
+    *dup = *fh;
+    if (fh->inode) {
+        inode_dup(fh->inode);
+    }
+    return dup;
+}
+
 void file_close(file_handle_t *fh) {
     if (fh) {
-        if (fh->inode) {
-            heap_free(fh->inode, sizeof(inode_t));
-        }
-        heap_free(fh, sizeof(file_handle_t));
+        inode_put(fh->inode);
+        kmem_cache_free(&g_file_cache, fh);
     }
 }
 
@@ -521,10 +2512,16 @@ ssize_t file_read(file_handle_t *fh, uint8_t *buf, size_t count) {
     if (!fh || !fh->readable || !fh->inode) return -1;
 
     size_t read = inode_read_at(fh->inode, fh->offset, buf, count);
+    file_readahead(fh, fh->offset, read);
     fh->offset += read;
     return read;
 }
 
+size_t file_prefetch(file_handle_t *fh, size_t count) {
+    if (!fh || !fh->readable || !fh->inode) return 0;
+    return inode_prefetch(fh->inode, fh->offset, count);
+}
+
 ssize_t file_write(file_handle_t *fh, const uint8_t *buf, size_t count) {
     if (!fh || !fh->writable || !fh->inode) return -1;
 
@@ -532,3 +2529,47 @@ ssize_t file_write(file_handle_t *fh, const uint8_t *buf, size_t count) {
     fh->offset += written;
     return written;
 }
+
+ssize_t file_getdents64(file_handle_t *fh, uint8_t *buf, size_t len) {
+    if (!fh || !fh->readable || !fh->inode) return -1;
+
+    inode_t *dir = fh->inode;
+    block_cache_t *cache = inode_get_cache(dir);
+    disk_inode_t *di = cache_disk_inode(cache, dir);
+    if (di->type_ != INODE_DIRECTORY) {
+        block_cache_release(cache);
+        return -1;
+    }
+
+    size_t file_count = di->size / DIRENT_SZ;
+    size_t used = 0;
+    dir_entry_t dirent;
+    for (size_t i = fh->offset / DIRENT_SZ; i < file_count; i++) {
+        disk_inode_read_at(di, i * DIRENT_SZ, (uint8_t *)&dirent, DIRENT_SZ, dir->fs->block_device);
+        if (dirent.name[0] == '\0') {
+            fh->offset = (i + 1) * DIRENT_SZ;
+            continue;
+        }
+
+        size_t name_len = strlen(dirent.name);
+        size_t reclen = (offsetof(dirent64_t, d_name) + name_len + 1 + 7) & ~(size_t)7;
+        if (used + reclen > len) break;
+
+        inode_t *child = efs_iget(dir->fs, dirent.inode_number);
+        dirent64_t *d = (dirent64_t *)(buf + used);
+        d->d_ino = dirent.inode_number;
+        d->d_off = (i + 1) * DIRENT_SZ;
+        d->d_reclen = reclen;
+        d->d_type = (child && inode_is_dir(child)) ? DT_DIR : DT_REG;
+        memcpy(d->d_name, dirent.name, name_len + 1);
+        inode_put(child);
+
+        used += reclen;
+        fh->offset = (i + 1) * DIRENT_SZ;
+    }
+    block_cache_release(cache);
+
+    /* 还有目录项但一条也放不下 */
+    if (used == 0 && fh->offset / DIRENT_SZ < file_count) return -1;
+    return used;
+}
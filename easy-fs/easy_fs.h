@@ -23,14 +23,46 @@ typedef long ssize_t;
 #define DIRENT_SZ           32
 #define BLOCK_BITS          (BLOCK_SZ * 8)
 #define INODE_INDIRECT1_COUNT (BLOCK_SZ / 4)
+#define INODE_INDIRECT2_COUNT (INODE_INDIRECT1_COUNT * INODE_INDIRECT1_COUNT)
+#define INODE_MAX_BLOCKS    (INODE_DIRECT_COUNT + INODE_INDIRECT1_COUNT + INODE_INDIRECT2_COUNT)
 
 /* ============================================================================
  * 块设备接口
  * ========================================================================== */
 
+#define BLOCK_REQ_PENDING   1   /* block_request_t.status：请求尚未完成 */
+
+/* 块设备请求，用于批量或异步提交 */
+typedef struct block_request {
+    size_t block_id;
+    size_t count;           /* 连续块数 */
+    uint8_t *buf;           /* count * BLOCK_SZ 字节，须物理连续 */
+    bool write;
+    bool flush;             /* 刷写设备写缓存（忽略 block_id/count/buf） */
+    int status;             /* 完成后由设备填写：0 成功，-1 失败 */
+    /* 异步请求的完成回调（由设备的 poll / 中断处理调用），同步请求为 NULL */
+    void (*complete)(struct block_request *req);
+    void *priv;
+} block_request_t;
+
 typedef struct block_device {
     void (*read_block)(struct block_device *dev, size_t block_id, uint8_t *buf);
     void (*write_block)(struct block_device *dev, size_t block_id, const uint8_t *buf);
+    /* 可选：一次读写 count 个连续块，为 NULL 时逐块调用 read_block / write_block */
+    void (*read_blocks)(struct block_device *dev, size_t block_id, size_t count, uint8_t *buf);
+    void (*write_blocks)(struct block_device *dev, size_t block_id, size_t count,
+                         const uint8_t *buf);
+    /* 可选：一次提交多个独立请求并等待全部完成，全部成功返回 0 */
+    int (*submit)(struct block_device *dev, block_request_t *reqs, size_t n);
+    /* 可选：异步提交一个请求，立即返回；成功返回 0。提供 start 时必须提供 poll */
+    int (*start)(struct block_device *dev, block_request_t *req);
+    /* 回收已完成的异步请求（调用其 complete），不等待 */
+    void (*poll)(struct block_device *dev);
+    /* 可选：把设备易失写缓存中的数据刷到介质，成功返回 0 */
+    int (*flush)(struct block_device *dev);
+    /* 可选：开始/结束一段批量提交，期间的异步请求可被合并后一起下发 */
+    void (*plug)(struct block_device *dev);
+    void (*unplug)(struct block_device *dev);
     void *priv;
 } block_device_t;
 
@@ -38,7 +70,12 @@ typedef struct block_device {
  * 磁盘数据结构（与 Rust 版本完全兼容）
  * ========================================================================== */
 
-/* 超级块 (24 字节) */
+/**
+ * 超级块 (32 字节)
+ *
+ * 前 24 字节与 Rust 版本相同；末尾的日志区字段是扩展，Rust 版本忽略，
+ * 其写出的镜像中为 0，表示没有日志区。
+ */
 typedef struct __attribute__((packed)) {
     uint32_t magic;
     uint32_t total_blocks;
@@ -46,6 +83,8 @@ typedef struct __attribute__((packed)) {
     uint32_t inode_area_blocks;
     uint32_t data_bitmap_blocks;
     uint32_t data_area_blocks;
+    uint32_t journal_start;             /* 日志区首块（日志头） */
+    uint32_t journal_blocks;            /* 日志区块数（含日志头），0 表示没有日志 */
 } super_block_t;
 
 /* inode 类型 */
@@ -63,7 +102,43 @@ typedef struct __attribute__((packed)) {
     uint32_t type_;     /* inode_type_t */
 } disk_inode_t;
 
-/* 目录项 (32 字节) */
+/**
+ * 元数据重做日志
+ *
+ * 日志区首块是日志头，记录下一个待重放的事务序号；其后从第 1 块起顺序存放事务：
+ * 一个或多个描述块（每个后面紧跟其记录的块的新内容），最后是提交块。
+ * 提交块中的校验和覆盖整个事务，未完整写入的事务在重放时被忽略。
+ * 描述块中带 JOURNAL_TAG_REVOKE 的标签是撤销记录：该块在本事务中被释放，
+ * 不再重放更早事务中记录的它的内容（块可能已被复用为文件数据）。
+ */
+#define JOURNAL_MAGIC           0x4a524e4c      /* "JRNL" */
+#define JOURNAL_BLOCK_DESC      1
+#define JOURNAL_BLOCK_COMMIT    2
+#define JOURNAL_TAG_REVOKE      0x80000000u
+#define JOURNAL_TAGS_PER_DESC   ((BLOCK_SZ - 16) / 4)
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t sequence;                  /* 下一个待重放的事务序号 */
+} journal_header_t;
+
+/* 描述块与提交块共用前 12 字节 */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t type;
+    uint32_t sequence;
+    uint32_t count;                     /* 标签数 */
+    uint32_t tags[JOURNAL_TAGS_PER_DESC];   /* 磁盘块号，或 JOURNAL_TAG_REVOKE | 块号 */
+} journal_desc_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t type;
+    uint32_t sequence;
+    uint32_t checksum;                  /* 本事务各描述块与数据块的校验和 */
+} journal_commit_t;
+
+/* 目录项 (32 字节)，name 为空表示已删除的空位 */
 typedef struct __attribute__((packed)) {
     char name[NAME_LENGTH_LIMIT + 1];   /* 28 字节 */
     uint32_t inode_number;              /* 4 字节 */
@@ -74,11 +149,19 @@ typedef struct __attribute__((packed)) {
  * ========================================================================== */
 
 /* 位图 */
+#define BITMAP_COUNT_UNKNOWN    0xFFFF  /* 该位图块的空闲数尚未统计 */
+
 typedef struct {
     size_t start_block_id;
     size_t blocks;
+    size_t maximum;                     /* 有效位数，超出的位不分配 */
+    size_t cursor;                      /* next-fit：下次从这一位开始查找 */
+    uint16_t *free_count;               /* 每个位图块的空闲位数，首次访问时统计；NULL 表示不维护 */
 } bitmap_t;
 
+struct dir_index;
+struct journal;
+
 /* 文件系统 */
 typedef struct {
     block_device_t *block_device;
@@ -86,23 +169,65 @@ typedef struct {
     bitmap_t data_bitmap;
     uint32_t inode_area_start_block;
     uint32_t data_area_start_block;
+    struct dir_index *dir_indexes;      /* 已建立内存哈希索引的目录 */
+    struct journal *journal;            /* 元数据日志，镜像没有日志区时为 NULL */
 } easy_fs_t;
 
-/* inode (内存表示) */
-typedef struct {
+/**
+ * inode (内存表示)
+ *
+ * 由 inode 缓存按 inode 号共享并计引用：efs_root_inode / inode_find / inode_create
+ * 返回一个新引用，用完须 inode_put。引用归零的 inode 留在缓存中供再次打开复用。
+ */
+typedef struct inode {
     size_t block_id;
     size_t block_offset;
     easy_fs_t *fs;
+    uint32_t inode_id;
+    uint32_t ref;
+    bool unlinked;                      /* 已从目录中删除，最后一个引用释放时回收 */
+    struct inode *hash_next;
+    struct inode *lru_prev;             /* 未被引用的 inode 组成的 LRU 链表 */
+    struct inode *lru_next;
 } inode_t;
 
+/**
+ * 顺序读预读状态（每个文件句柄一份）
+ *
+ * 读取的起点恰好是上一次读取的终点（或文件开头）时视为顺序读：首次发起
+ * init 块的预读窗口，之后每当已预读而未读到的块不足半个窗口时，窗口翻倍
+ * （至多 max 块，且不超过块缓存容量的 1/4）并继续向后预读。非顺序读取清空状态。
+ */
+typedef struct {
+    size_t next;            /* 顺序读时下一次读取的起始偏移 */
+    uint32_t window;        /* 当前窗口块数，0 表示尚未检测到顺序读 */
+    uint32_t ahead;         /* 已发起预读的文件内块号上界（不含） */
+} readahead_t;
+
+#define READAHEAD_DEFAULT_INIT  4
+#define READAHEAD_DEFAULT_MAX   32
+
 /* 文件句柄 */
 typedef struct {
     inode_t *inode;
     bool readable;
     bool writable;
     size_t offset;
+    readahead_t ra;
 } file_handle_t;
 
+/* getdents64 返回的目录项记录（与 Linux struct linux_dirent64 布局一致） */
+typedef struct {
+    uint64_t d_ino;
+    int64_t d_off;          /* 下一条记录的位置 */
+    uint16_t d_reclen;      /* 本条记录长度，按 8 字节对齐 */
+    uint8_t d_type;
+    char d_name[];
+} dirent64_t;
+
+#define DT_DIR      4
+#define DT_REG      8
+
 /* 打开标志 */
 #define O_RDONLY    0
 #define O_WRONLY    (1 << 0)
@@ -114,28 +239,197 @@ typedef struct {
  * 块缓存
  * ========================================================================== */
 
-#define BLOCK_CACHE_SIZE 16
+/**
+ * 块缓存以哈希表索引、按 LRU 淘汰。
+ *
+ * get_block_cache 返回的缓存块被钉住（引用计数 +1），在 block_cache_release
+ * 之前不会被淘汰，因此可以放心持有其中的指针（如 disk_inode_t *）。
+ *
+ * 默认采用写回策略：修改只标记脏块，脏块在被淘汰、周期刷写
+ * (block_cache_tick) 或显式同步 (fsync / sync) 时写回设备。
+ *
+ * 文件系统带日志区时，元数据操作中修改的块加入正在运行的日志事务，
+ * 事务提交（写入日志）之前不会写回原位置；周期刷写与显式同步先提交事务。
+ */
+#define BLOCK_CACHE_DEFAULT_CAPACITY    64
+#define BLOCK_CACHE_MIN_CAPACITY        8   /* 单次操作最多同时钉住的块数的上界 */
+#define BLOCK_CACHE_DEFAULT_FLUSH_INTERVAL 1250000  /* 100 ms（time 频率 12.5 MHz） */
+#define BLOCK_CACHE_SYNC_BATCH          32  /* 全量同步时每批提交的脏块数上限 */
 
-typedef struct {
+typedef struct block_cache {
     uint8_t cache[BLOCK_SZ];
     size_t block_id;
     block_device_t *block_device;
     bool modified;
     bool valid;
+    bool io_pending;                    /* 异步读入中：已占位但内容尚未就绪 */
+    bool journaled;                     /* 属于尚未提交的日志事务：提交前不可写回、不可淘汰 */
+    uint32_t ref;                       /* 钉住计数，非 0 时不可淘汰 */
+    struct block_cache *hash_next;      /* 哈希桶链表 */
+    struct block_cache *lru_prev;       /* LRU 链表，表头为最近使用 */
+    struct block_cache *lru_next;
+    block_request_t req;                /* 异步读入使用的请求 */
 } block_cache_t;
 
-/* 初始化块缓存系统 */
-void block_cache_init(void);
+/* 块缓存统计 */
+typedef struct {
+    size_t hits;
+    size_t misses;
+    size_t evictions;       /* 淘汰有效块的次数 */
+    size_t writebacks;      /* 写回脏块的次数 */
+    size_t dirty;           /* 当前脏块数 */
+    size_t dirty_peak;      /* 脏块数峰值 */
+    size_t flushes;         /* 写回了至少一个块的全量同步次数 */
+    uint64_t flush_time_total;  /* 全量同步累计耗时（time 计数） */
+    uint64_t flush_time_max;    /* 单次全量同步最长耗时 */
+    size_t direct_reads;    /* 绕过缓存直接读取的块数 */
+    size_t direct_writes;   /* 绕过缓存直接写入的块数 */
+    size_t batch_submits;   /* 全量同步时批量提交的次数 */
+    size_t async_reads;     /* 异步读入的块数 */
+    size_t io_waits;        /* 访问读入中的块而不得不等待的次数 */
+    size_t readahead;       /* 顺序读预读发起的块数（含索引块） */
+} block_cache_stats_t;
 
-/* 获取块缓存 */
+/**
+ * 初始化块缓存系统
+ *
+ * @param capacity 缓存块数，不足 BLOCK_CACHE_MIN_CAPACITY 时按最小值
+ * @return 成功返回 0，内存不足返回 -1
+ */
+int block_cache_init(size_t capacity);
+
+/**
+ * 获取并钉住块缓存
+ *
+ * 总能返回缓存块：钉住的块有上限（见 BLOCK_CACHE_MIN_CAPACITY 与
+ * block_cache_prefetch），若仍全部被钉住说明有引用泄漏，直接停机。
+ */
 block_cache_t *get_block_cache(size_t block_id, block_device_t *dev);
 
+/* 释放 get_block_cache 取得的引用 */
+void block_cache_release(block_cache_t *cache);
+
+/* 标记缓存块已修改 */
+void block_cache_mark_dirty(block_cache_t *cache);
+
+/**
+ * 设置写回周期
+ *
+ * @param interval 脏块最长滞留的 time 计数；0 表示写穿（每次修改操作后同步）
+ */
+void block_cache_set_flush_interval(uint64_t interval);
+
+/* 周期刷写：距上次全量同步超过写回周期且有脏块时同步，由内核在陷入时调用 */
+void block_cache_tick(void);
+
 /* 同步所有块缓存 */
 void block_cache_sync_all(void);
 
+/**
+ * 持久化：写回所有脏块，再让设备刷写其写缓存（设备提供 flush 时）
+ *
+ * @return 成功返回 0，设备刷写失败返回 -1
+ */
+int block_cache_flush(block_device_t *dev);
+
 /* 同步单个块缓存 */
 void block_cache_sync(block_cache_t *cache);
 
+/* 获取块缓存统计 */
+void block_cache_get_stats(block_cache_stats_t *stats);
+
+/**
+ * 为块发起异步读入
+ *
+ * 设备提供 start/poll 时，为未缓存的块分配缓存项并提交异步读，立即返回；
+ * 读入完成前访问该块 (get_block_cache) 会轮询设备直到就绪。
+ *
+ * 读入中的块在完成前一直钉住，总数不超过 (容量 - BLOCK_CACHE_MIN_CAPACITY) / 2，
+ * 超出时不再发起。
+ *
+ * @return 0 已在缓存中；1 正在读入；-1 无法异步读入（设备不支持、配额用尽或没有可用缓存项）
+ */
+int block_cache_prefetch(size_t block_id, block_device_t *dev);
+
+/**
+ * 绕过缓存读取连续块
+ *
+ * 已在缓存中的块以缓存内容为准（可能比磁盘新）；全部命中时不访问设备。
+ */
+void block_cache_read_direct(block_device_t *dev, size_t block_id, size_t count, uint8_t *buf);
+
+/**
+ * 绕过缓存写入连续块
+ *
+ * 已在缓存中的块同步更新为新内容并视为干净。
+ */
+void block_cache_write_direct(block_device_t *dev, size_t block_id, size_t count,
+                              const uint8_t *buf);
+
+/* ============================================================================
+ * inode 缓存与目录项缓存
+ * ========================================================================== */
+
+/**
+ * inode 缓存以 inode 号为键；目录项缓存以 (父目录 inode 号, 名字) 为键，
+ * 记录名字对应的 inode 号，也记录名字不存在（负项）。两者命中时打开同一路径
+ * 不访问块缓存。
+ */
+#define INODE_CACHE_BUCKETS     64
+#define INODE_CACHE_UNUSED_MAX  32      /* 保留的未被引用 inode 数上限 */
+#define DENTRY_CACHE_SIZE       128
+#define DENTRY_CACHE_BUCKETS    64
+
+typedef struct {
+    size_t inode_hits;
+    size_t inode_misses;
+    size_t dentry_hits;
+    size_t dentry_negative_hits;        /* 命中负项（名字不存在）的次数 */
+    size_t dentry_misses;
+} name_cache_stats_t;
+
+/* 取得 inode 号对应的 inode（新引用），内存不足返回 NULL */
+inode_t *efs_iget(easy_fs_t *fs, uint32_t inode_id);
+
+/* 增加引用 */
+inode_t *inode_dup(inode_t *inode);
+
+/* 释放引用 */
+void inode_put(inode_t *inode);
+
+/* 获取 inode / 目录项缓存统计 */
+void name_cache_get_stats(name_cache_stats_t *stats);
+
+/* ============================================================================
+ * 元数据日志
+ * ========================================================================== */
+
+/**
+ * inode、位图、目录与索引块的修改按操作归入事务，多个操作的修改合并到同一个
+ * 正在运行的事务中（组提交），在以下时机一次写入日志区并刷写设备：
+ * 周期刷写到期、事务修改的块数达到上限、fsync / sync，写穿模式下每个操作之后。
+ * 提交后的块按写回策略写回原位置；日志区写满时先把所有脏块写回（检查点）再从头使用。
+ * 挂载时重放日志中已完整提交的事务。
+ *
+ * 操作中释放的数据块要到事务提交后才能再分配，并在提交后清零。
+ */
+#define JOURNAL_TXN_MAX_BLOCKS  64      /* 单个事务修改的块数上限，另受块缓存容量的 1/4 限制 */
+#define JOURNAL_FREE_MAX        1024    /* 推迟释放的数据块达到该数时在操作结束后提交 */
+#define JOURNAL_EXTEND_BLOCKS   512     /* 写入时每个事务最多扩展的数据块数 */
+
+typedef struct {
+    size_t commits;         /* 提交的事务数 */
+    size_t logged_blocks;   /* 写入日志的块数（不含描述块与提交块） */
+    size_t revokes;         /* 撤销记录数 */
+    size_t checkpoints;     /* 日志区写满后的检查点次数 */
+    size_t overflows;       /* 事务超出日志区容量、退回直接写回原位置的次数 */
+    size_t early_commits;   /* 块缓存占满、在操作中途提交的次数 */
+    size_t replayed;        /* 挂载时重放的事务数 */
+} journal_stats_t;
+
+/* 获取日志统计，文件系统没有日志时返回 -1 */
+int efs_journal_get_stats(easy_fs_t *fs, journal_stats_t *stats);
+
 /* ============================================================================
  * 文件系统 API
  * ========================================================================== */
@@ -146,25 +440,94 @@ easy_fs_t *efs_open(block_device_t *dev);
 /* 获取根 inode */
 inode_t *efs_root_inode(easy_fs_t *fs);
 
+/**
+ * 逐级解析路径
+ *
+ * 以 '/' 开头或 base 为 NULL 时从根目录开始，否则相对于目录 base。空分量和 "."
+ * 被跳过，根目录的 ".." 仍是根目录。
+ *
+ * @param last 非 NULL 时不解析最后一个分量，而是把它拷贝到 last
+ *             （NAME_LENGTH_LIMIT + 1 字节）并返回其所在目录；
+ *             最后一个分量为空、"." 或 ".." 时失败
+ * @return 新引用，路径不存在、分量过长或中间分量不是目录时返回 NULL
+ */
+inode_t *efs_walk(easy_fs_t *fs, inode_t *base, const char *path, char *last);
+
+/* 按路径创建目录、删除文件 (dir 为 false) 或空目录 (dir 为 true)、重命名，成功返回 0 */
+int efs_mkdir(easy_fs_t *fs, inode_t *base, const char *path);
+int efs_unlink(easy_fs_t *fs, inode_t *base, const char *path, bool dir);
+int efs_rename(easy_fs_t *fs, inode_t *old_base, const char *old_path,
+               inode_t *new_base, const char *new_path);
+
 /* inode 操作 */
 inode_t *inode_find(inode_t *dir, const char *name);
 inode_t *inode_create(inode_t *dir, const char *name);
+/* 创建子目录（含 "." 与 ".." 目录项），名字已存在时返回 NULL */
+inode_t *inode_mkdir(inode_t *dir, const char *name);
+/* 删除目录项：inode_unlink 只删除非目录，inode_rmdir 只删除空目录；成功返回 0 */
+int inode_unlink(inode_t *dir, const char *name);
+int inode_rmdir(inode_t *dir, const char *name);
+/**
+ * 把 old_dir 下的 old_name 移动为 new_dir 下的 new_name
+ *
+ * 目标已存在时：源和目标都是普通文件则替换目标，否则失败。
+ * 目录不能移动到自己的子目录中。
+ */
+int inode_rename(inode_t *old_dir, const char *old_name, inode_t *new_dir, const char *new_name);
+bool inode_is_dir(inode_t *inode);
 size_t inode_read_at(inode_t *inode, size_t offset, uint8_t *buf, size_t len);
 size_t inode_write_at(inode_t *inode, size_t offset, const uint8_t *buf, size_t len);
 void inode_clear(inode_t *inode);
 size_t inode_readdir(inode_t *dir, char names[][NAME_LENGTH_LIMIT + 1], size_t max_count);
 uint32_t inode_size(inode_t *inode);
+/* 为 [offset, offset + len) 覆盖的数据块发起异步读入，返回仍在读入中的块数 */
+size_t inode_prefetch(inode_t *inode, size_t offset, size_t len);
 
 /* 文件操作 */
+/* 按路径（从根目录解析）打开，O_CREATE 时在所在目录中创建；目录只能只读打开 */
 file_handle_t *file_open(easy_fs_t *fs, const char *path, uint32_t flags);
 void file_close(file_handle_t *fh);
+/* 创建文件句柄（inode 为 NULL 表示标准输入输出），句柄接管调用者持有的 inode 引用 */
+file_handle_t *file_alloc(inode_t *inode, bool readable, bool writable);
+/* 复制文件句柄（共享 inode，增加其引用），用于 fork 复制 fd 表 */
+file_handle_t *file_dup(const file_handle_t *fh);
+/* 读取并推进偏移，顺序读时在设备支持异步读入的情况下向后预读 */
 ssize_t file_read(file_handle_t *fh, uint8_t *buf, size_t count);
+/* 为从当前偏移起的 count 字节发起异步读入，返回仍在读入中的块数（0 表示可直接读取） */
+size_t file_prefetch(file_handle_t *fh, size_t count);
 ssize_t file_write(file_handle_t *fh, const uint8_t *buf, size_t count);
+/**
+ * 从目录句柄的当前位置起读取目录项，填入 dirent64_t 记录
+ *
+ * @return 写入 buf 的字节数，读完返回 0；句柄不是目录或 buf 放不下一条记录返回 -1
+ */
+ssize_t file_getdents64(file_handle_t *fh, uint8_t *buf, size_t len);
+
+/**
+ * 设置顺序读预读窗口
+ *
+ * @param init 检测到顺序读时的初始窗口块数
+ * @param max  窗口上限块数，0 表示关闭预读
+ */
+void efs_set_readahead(uint32_t init, uint32_t max);
 
 /* 辅助函数 */
 void efs_get_disk_inode_pos(easy_fs_t *fs, uint32_t inode_id, uint32_t *block_id, size_t *offset);
 uint32_t efs_alloc_inode(easy_fs_t *fs);
+void efs_dealloc_inode(easy_fs_t *fs, uint32_t inode_id);
+/* 分配一个数据块，空间已满返回 0（块 0 是超级块） */
 uint32_t efs_alloc_data(easy_fs_t *fs);
+
+/**
+ * 分配一段物理连续的数据块
+ *
+ * 从上次分配结束处向后找，一次最多给出 count 块，但不保证给满：
+ * 遇到已占用的块或位图块边界时就停下，调用者按需再次调用。
+ *
+ * @param first 返回第一块的磁盘块号
+ * @return 分配到的块数，空间已满时返回 0
+ */
+uint32_t efs_alloc_data_n(easy_fs_t *fs, uint32_t count, uint32_t *first);
 void efs_dealloc_data(easy_fs_t *fs, uint32_t block_id);
 
 #endif /* EASY_FS_H */
@@ -31,12 +31,15 @@
 /* 默认参数 */
 #define DEFAULT_TOTAL_BLOCKS    (64 * 2048)     /* 64MB */
 #define DEFAULT_INODE_BITMAP_BLOCKS 1
+#define DEFAULT_JOURNAL_BLOCKS  1024            /* 512KB 元数据日志区，-j 0 不预留 */
+
+#define JOURNAL_MAGIC           0x4a524e4c
 
 /* ============================================================================
  * 磁盘数据结构（与 Rust 版本完全兼容）
  * ========================================================================== */
 
-/* 超级块 (24 字节) */
+/* 超级块 (32 字节，末尾的日志区字段为扩展，Rust 版本忽略) */
 typedef struct __attribute__((packed)) {
     uint32_t magic;
     uint32_t total_blocks;
@@ -44,8 +47,16 @@ typedef struct __attribute__((packed)) {
     uint32_t inode_area_blocks;
     uint32_t data_bitmap_blocks;
     uint32_t data_area_blocks;
+    uint32_t journal_start;
+    uint32_t journal_blocks;
 } super_block_t;
 
+/* 日志头：日志区首块 */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t sequence;
+} journal_header_t;
+
 /* inode 类型 */
 typedef enum {
     INODE_FILE = 0,
@@ -183,6 +194,17 @@ static int bitmap_alloc(bitmap_t *bm, block_file_t *dev) {
     return -1;
 }
 
+static void bitmap_dealloc(bitmap_t *bm, block_file_t *dev, size_t bit) {
+    size_t block_pos = bit / BLOCK_BITS;
+    size_t bits64_pos = (bit % BLOCK_BITS) / 64;
+    size_t inner_pos = bit % 64;
+
+    block_cache_t *cache = get_block_cache(block_pos + bm->start_block_id, dev);
+    uint64_t *bitmap_block = (uint64_t *)cache->cache;
+    bitmap_block[bits64_pos] &= ~(1ULL << inner_pos);
+    cache->modified = true;
+}
+
 static size_t bitmap_maximum(bitmap_t *bm) {
     return bm->blocks * BLOCK_BITS;
 }
@@ -216,12 +238,20 @@ static uint32_t efs_alloc_data(easy_fs_t *fs) {
     return fs->data_area_start_block + bit;
 }
 
+static void efs_dealloc_data(easy_fs_t *fs, uint32_t block_id) {
+    /* 清零块，保证新分配的块内容为零 */
+    block_cache_t *cache = get_block_cache(block_id, fs->dev);
+    memset(cache->cache, 0, BLOCK_SZ);
+    cache->modified = true;
+    bitmap_dealloc(&fs->data_bitmap, fs->dev, block_id - fs->data_area_start_block);
+}
+
 /* ============================================================================
  * 创建文件系统
  * ========================================================================== */
 
 static easy_fs_t *efs_create(block_file_t *dev, uint32_t total_blocks,
-                             uint32_t inode_bitmap_blocks) {
+                             uint32_t inode_bitmap_blocks, uint32_t journal_blocks) {
     easy_fs_t *fs = malloc(sizeof(easy_fs_t));
     if (!fs) return NULL;
 
@@ -235,7 +265,8 @@ static easy_fs_t *efs_create(block_file_t *dev, uint32_t total_blocks,
     uint32_t inode_area_blocks = (inode_num * sizeof(disk_inode_t) + BLOCK_SZ - 1) / BLOCK_SZ;
     uint32_t inode_total_blocks = inode_bitmap_blocks + inode_area_blocks;
 
-    uint32_t data_total_blocks = total_blocks - 1 - inode_total_blocks;
+    /* 日志区放在镜像末尾 */
+    uint32_t data_total_blocks = total_blocks - 1 - inode_total_blocks - journal_blocks;
     uint32_t data_bitmap_blocks = (data_total_blocks + 4096) / 4097;
     uint32_t data_area_blocks = data_total_blocks - data_bitmap_blocks;
 
@@ -263,12 +294,23 @@ static easy_fs_t *efs_create(block_file_t *dev, uint32_t total_blocks,
     sb->inode_area_blocks = inode_area_blocks;
     sb->data_bitmap_blocks = data_bitmap_blocks;
     sb->data_area_blocks = data_area_blocks;
+    sb->journal_start = journal_blocks ? total_blocks - journal_blocks : 0;
+    sb->journal_blocks = journal_blocks;
     sb_cache->modified = true;
 
+    if (journal_blocks) {
+        block_cache_t *jh_cache = get_block_cache(sb->journal_start, dev);
+        journal_header_t *jh = (journal_header_t *)jh_cache->cache;
+        jh->magic = JOURNAL_MAGIC;
+        jh->sequence = 1;
+        jh_cache->modified = true;
+    }
+
     printf("  inode_bitmap_blocks: %u\n", inode_bitmap_blocks);
     printf("  inode_area_blocks: %u\n", inode_area_blocks);
     printf("  data_bitmap_blocks: %u\n", data_bitmap_blocks);
     printf("  data_area_blocks: %u\n", data_area_blocks);
+    printf("  journal_blocks: %u\n", journal_blocks);
 
     /* 创建根目录 inode */
     printf("Creating root inode...\n");
@@ -382,6 +424,7 @@ static void disk_inode_increase_size(disk_inode_t *di, uint32_t new_size, easy_f
     block_cache_t *cache2 = get_block_cache(di->indirect2, fs->dev);
     uint32_t *indirect2 = (uint32_t *)cache2->cache;
 
+    /* 每个一级索引块只取一次 */
     while (current < new_blocks) {
         size_t idx = current - INODE_DIRECT_COUNT - INODE_INDIRECT1_COUNT;
         size_t a = idx / INODE_INDIRECT1_COUNT;
@@ -394,11 +437,61 @@ static void disk_inode_increase_size(disk_inode_t *di, uint32_t new_size, easy_f
 
         block_cache_t *cache1 = get_block_cache(indirect2[a], fs->dev);
         uint32_t *indirect1 = (uint32_t *)cache1->cache;
-        indirect1[b] = efs_alloc_data(fs);
+        while (current < new_blocks && b < INODE_INDIRECT1_COUNT) {
+            indirect1[b++] = efs_alloc_data(fs);
+            current++;
+        }
         cache1->modified = true;
+    }
+}
 
-        current++;
+/* 释放一级索引块的前 count 个数据块及索引块本身 */
+static void free_index_block(easy_fs_t *fs, uint32_t block_id, uint32_t count) {
+    block_cache_t *cache = get_block_cache(block_id, fs->dev);
+    uint32_t ids[INODE_INDIRECT1_COUNT];
+    memcpy(ids, cache->cache, sizeof(ids));
+    if (count > INODE_INDIRECT1_COUNT) count = INODE_INDIRECT1_COUNT;
+    for (uint32_t i = 0; i < count; i++) {
+        if (ids[i] != 0) {
+            efs_dealloc_data(fs, ids[i]);
+        }
     }
+    efs_dealloc_data(fs, block_id);
+}
+
+/* 释放 inode 的全部数据块与索引块，大小清零 */
+static void disk_inode_clear_size(disk_inode_t *di, easy_fs_t *fs) {
+    uint32_t data_blocks = disk_inode_data_blocks(di->size);
+
+    for (uint32_t i = 0; i < data_blocks && i < INODE_DIRECT_COUNT; i++) {
+        if (di->direct[i] != 0) {
+            efs_dealloc_data(fs, di->direct[i]);
+            di->direct[i] = 0;
+        }
+    }
+
+    if (di->indirect1 != 0 && data_blocks > INODE_DIRECT_COUNT) {
+        free_index_block(fs, di->indirect1, data_blocks - INODE_DIRECT_COUNT);
+        di->indirect1 = 0;
+    }
+
+    if (di->indirect2 != 0 && data_blocks > INODE_DIRECT_COUNT + INODE_INDIRECT1_COUNT) {
+        uint32_t remain = data_blocks - INODE_DIRECT_COUNT - INODE_INDIRECT1_COUNT;
+        uint32_t level1[INODE_INDIRECT1_COUNT];
+        block_cache_t *cache2 = get_block_cache(di->indirect2, fs->dev);
+        memcpy(level1, cache2->cache, sizeof(level1));
+        for (uint32_t a = 0; remain > 0 && a < INODE_INDIRECT1_COUNT; a++) {
+            uint32_t n = remain < INODE_INDIRECT1_COUNT ? remain : INODE_INDIRECT1_COUNT;
+            if (level1[a] != 0) {
+                free_index_block(fs, level1[a], n);
+            }
+            remain -= n;
+        }
+        efs_dealloc_data(fs, di->indirect2);
+        di->indirect2 = 0;
+    }
+
+    di->size = 0;
 }
 
 static size_t disk_inode_write_at(disk_inode_t *di, size_t offset, const uint8_t *buf,
@@ -535,6 +628,43 @@ static size_t inode_write_at(inode_t *inode, size_t offset, const uint8_t *buf,
     return result;
 }
 
+/* 在目录中查找文件 */
+static inode_t *inode_find(inode_t *dir, const char *name) {
+    disk_inode_t *di = inode_get_disk_inode(dir);
+    size_t file_count = di->size / DIRENT_SZ;
+
+    dir_entry_t dirent;
+    for (size_t i = 0; i < file_count; i++) {
+        disk_inode_read_at(di, i * DIRENT_SZ, (uint8_t *)&dirent, DIRENT_SZ, dir->fs->dev);
+        if (strncmp(dirent.name, name, NAME_LENGTH_LIMIT) == 0) {
+            inode_t *inode = malloc(sizeof(inode_t));
+            if (!inode) return NULL;
+            efs_get_disk_inode_pos(dir->fs, dirent.inode_number,
+                                   &inode->block_id, &inode->block_offset);
+            inode->fs = dir->fs;
+            return inode;
+        }
+    }
+    return NULL;
+}
+
+/* 清空文件，释放其全部数据块 */
+static void inode_clear(inode_t *inode) {
+    disk_inode_clear_size(inode_get_disk_inode(inode), inode->fs);
+    inode_mark_modified(inode);
+    block_cache_sync_all();
+}
+
+/* 打开并清空同名文件（重复打包时覆盖旧内容），不存在则创建 */
+static inode_t *inode_create_or_truncate(inode_t *dir, const char *name) {
+    inode_t *inode = inode_find(dir, name);
+    if (inode) {
+        inode_clear(inode);
+        return inode;
+    }
+    return inode_create(dir, name);
+}
+
 /* 读取目录 */
 static size_t inode_readdir(inode_t *dir, char names[][NAME_LENGTH_LIMIT + 1], size_t max_count) {
     disk_inode_t *di = inode_get_disk_inode(dir);
@@ -556,9 +686,11 @@ static size_t inode_readdir(inode_t *dir, char names[][NAME_LENGTH_LIMIT + 1], s
  * ========================================================================== */
 
 static void print_usage(const char *prog) {
-    printf("Usage: %s <output_img> <input_dir> [file1] [file2] ...\n", prog);
+    printf("Usage: %s [-j journal_blocks] <output_img> <input_dir> [file1] [file2] ...\n", prog);
     printf("\n");
     printf("Options:\n");
+    printf("  -j N          Reserve N blocks for the metadata journal (default %d, 0 for none)\n",
+           DEFAULT_JOURNAL_BLOCKS);
     printf("  <output_img>  Output fs.img path\n");
     printf("  <input_dir>   Directory containing ELF files\n");
     printf("  [files...]    Files to pack (if not specified, pack all files in input_dir)\n");
@@ -596,8 +728,20 @@ static uint8_t *read_file(const char *path, size_t *size_out) {
 }
 
 int main(int argc, char *argv[]) {
+    const char *prog = argv[0];
+    uint32_t journal_blocks = DEFAULT_JOURNAL_BLOCKS;
+    if (argc >= 3 && strcmp(argv[1], "-j") == 0) {
+        journal_blocks = (uint32_t)strtoul(argv[2], NULL, 10);
+        argc -= 2;
+        argv += 2;
+    }
+    if (journal_blocks == 1 || journal_blocks >= DEFAULT_TOTAL_BLOCKS / 2) {
+        fprintf(stderr, "Error: Invalid journal size: %u blocks\n", journal_blocks);
+        return 1;
+    }
+
     if (argc < 3) {
-        print_usage(argv[0]);
+        print_usage(prog);
         return 1;
     }
 
@@ -632,7 +776,8 @@ int main(int argc, char *argv[]) {
 
     /* 创建文件系统 */
     printf("\nCreating file system...\n");
-    easy_fs_t *fs = efs_create(&dev, DEFAULT_TOTAL_BLOCKS, DEFAULT_INODE_BITMAP_BLOCKS);
+    easy_fs_t *fs = efs_create(&dev, DEFAULT_TOTAL_BLOCKS, DEFAULT_INODE_BITMAP_BLOCKS,
+                               journal_blocks);
     if (!fs) {
         fprintf(stderr, "Error: Failed to create file system\n");
         fclose(img_file);
@@ -676,7 +821,7 @@ int main(int argc, char *argv[]) {
 
             printf("  %s (%zu bytes)\n", name, data_size);
 
-            inode_t *inode = inode_create(root, name);
+            inode_t *inode = inode_create_or_truncate(root, name);
             if (!inode) {
                 fprintf(stderr, "Error: Failed to create inode for %s\n", name);
                 free(data);
@@ -724,7 +869,7 @@ int main(int argc, char *argv[]) {
 
             printf("  %s (%zu bytes)\n", basename, data_size);
 
-            inode_t *inode = inode_create(root, basename);
+            inode_t *inode = inode_create_or_truncate(root, basename);
             if (!inode) {
                 fprintf(stderr, "Error: Failed to create inode for %s\n", basename);
                 free(data);
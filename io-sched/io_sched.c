@@ -0,0 +1,402 @@
+/**
+ * I/O 调度层实现
+ */
+#include "io_sched.h"
+#include "../kernel-alloc/heap.h"
+#include "../util/riscv.h"
+#include <string.h>
+
+/* ============================================================================
+ * 辅助函数
+ * ========================================================================== */
+
+static inline io_sched_t *to_sched(block_device_t *dev) {
+    return (io_sched_t *)dev->priv;
+}
+
+static void record_latency(io_sched_t *s, uint64_t ticks, bool write) {
+    size_t bucket = 0;
+    while (bucket + 1 < IO_SCHED_HIST_BUCKETS && (ticks >> (bucket + 1)) != 0) {
+        bucket++;
+    }
+    if (write) s->stats.write_hist[bucket]++;
+    else s->stats.read_hist[bucket]++;
+}
+
+static inline bool entry_before(const io_entry_t *a, const io_entry_t *b) {
+    return a->req->block_id < b->req->block_id;
+}
+
+/* 按块号插入排序（队列很短） */
+static void sort_by_block(io_entry_t *e, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        io_entry_t x = e[i];
+        size_t j = i;
+        while (j > 0 && entry_before(&x, &e[j - 1])) {
+            e[j] = e[j - 1];
+            j--;
+        }
+        e[j] = x;
+    }
+}
+
+static bool expired(const io_entry_t *e, uint64_t now) {
+    uint64_t expire = e->req->write ? IO_SCHED_WRITE_EXPIRE : IO_SCHED_READ_EXPIRE;
+    return now - e->queued_at > expire;
+}
+
+/* 按策略排列 e[0..n) 的下发顺序 */
+static void order_entries(io_sched_t *s, io_entry_t *e, size_t n) {
+    if (s->policy == IO_SCHED_NOOP || n < 2) return;
+
+    if (s->policy == IO_SCHED_ELEVATOR) {
+        /* 升序排列后从第一个不小于 head_pos 的请求开始，回绕到最小块号 */
+        sort_by_block(e, n);
+        size_t start = 0;
+        while (start < n && e[start].req->block_id < s->head_pos) start++;
+        if (start == 0 || start == n) return;
+
+        io_entry_t tmp[IO_SCHED_MAX_QUEUE];
+        memcpy(tmp, e + start, (n - start) * sizeof(io_entry_t));
+        memcpy(tmp + n - start, e, start * sizeof(io_entry_t));
+        memcpy(e, tmp, n * sizeof(io_entry_t));
+        return;
+    }
+
+    /* deadline：超期的按到达顺序在前，其后是读、写，各自按块号排序 */
+    io_entry_t tmp[IO_SCHED_MAX_QUEUE];
+    size_t k = 0;
+    uint64_t now = read_time();
+    for (size_t i = 0; i < n; i++) {
+        if (expired(&e[i], now)) tmp[k++] = e[i];
+    }
+    size_t reads = k;
+    for (size_t i = 0; i < n; i++) {
+        if (!expired(&e[i], now) && !e[i].req->write) tmp[k++] = e[i];
+    }
+    size_t writes = k;
+    for (size_t i = 0; i < n; i++) {
+        if (!expired(&e[i], now) && e[i].req->write) tmp[k++] = e[i];
+    }
+    sort_by_block(tmp + reads, writes - reads);
+    sort_by_block(tmp + writes, n - writes);
+    memcpy(e, tmp, n * sizeof(io_entry_t));
+}
+
+/* 从 e[0] 开始能合并成一次传输的请求数：同向、块号首尾衔接、总块数不超上限 */
+static size_t merge_len(const io_entry_t *e, size_t n) {
+    if (e[0].req->flush) return 1;
+    size_t blocks = e[0].req->count;
+    size_t k = 1;
+    while (k < n && k < IO_SCHED_MAX_MERGE) {
+        const block_request_t *prev = e[k - 1].req;
+        const block_request_t *next = e[k].req;
+        if (next->flush || next->write != prev->write ||
+            next->block_id != prev->block_id + prev->count ||
+            blocks + next->count > IO_SCHED_MAX_MERGE) {
+            break;
+        }
+        blocks += next->count;
+        k++;
+    }
+    return k;
+}
+
+/**
+ * 用 e[0..k) 填写一次下发
+ *
+ * 合并多个请求时分配拼接缓冲区并拷入写数据；分配失败则只下发第一个请求。
+ *
+ * @return 实际放入的请求数
+ */
+static size_t fill_dispatch(io_sched_t *s, io_dispatch_t *d, const io_entry_t *e, size_t k) {
+    if (k > 1) {
+        d->bounce = heap_alloc(IO_SCHED_MAX_MERGE * BLOCK_SZ, 8);
+        if (!d->bounce) k = 1;
+    } else {
+        d->bounce = NULL;
+    }
+
+    block_request_t *lower = d->lower;
+    *lower = *e[0].req;
+    lower->complete = NULL;
+    lower->priv = d;
+    if (d->bounce) {
+        size_t off = 0;
+        for (size_t i = 0; i < k; i++) {
+            if (e[i].req->write) {
+                memcpy(d->bounce + off, e[i].req->buf, e[i].req->count * BLOCK_SZ);
+            }
+            off += e[i].req->count * BLOCK_SZ;
+        }
+        lower->count = off / BLOCK_SZ;
+        lower->buf = d->bounce;
+    }
+
+    memcpy(d->parts, e, k * sizeof(io_entry_t));
+    d->nparts = k;
+    d->sched = s;
+
+    s->stats.dispatched++;
+    s->stats.merged += k - 1;
+    s->head_pos = lower->block_id + lower->count;
+    return k;
+}
+
+/* 下发完成：拷回读数据、填写各请求状态并统计延迟（不调用回调） */
+static void finish_dispatch(io_dispatch_t *d) {
+    io_sched_t *s = d->sched;
+    int status = d->lower->status;
+    uint64_t now = read_time();
+    size_t off = 0;
+
+    for (size_t i = 0; i < d->nparts; i++) {
+        block_request_t *r = d->parts[i].req;
+        if (d->bounce && !r->write && status == 0) {
+            memcpy(r->buf, d->bounce + off, r->count * BLOCK_SZ);
+        }
+        off += r->count * BLOCK_SZ;
+        r->status = status;
+        record_latency(s, now - d->parts[i].queued_at, r->write);
+    }
+    if (d->bounce) {
+        heap_free(d->bounce, IO_SCHED_MAX_MERGE * BLOCK_SZ);
+        d->bounce = NULL;
+    }
+}
+
+/* ============================================================================
+ * 异步下发
+ * ========================================================================== */
+
+static void async_done(block_request_t *lower) {
+    io_dispatch_t *d = lower->priv;
+    finish_dispatch(d);
+
+    /* 先释放槽位再回调：回调中可能再次提交请求 */
+    block_request_t *parts[IO_SCHED_MAX_MERGE];
+    size_t n = d->nparts;
+    for (size_t i = 0; i < n; i++) parts[i] = d->parts[i].req;
+    d->busy = false;
+
+    for (size_t i = 0; i < n; i++) {
+        parts[i]->complete(parts[i]);
+    }
+}
+
+/* 取一个空闲的异步槽位，没有时回收下层已完成的请求直到有空位 */
+static io_dispatch_t *get_async_slot(io_sched_t *s) {
+    while (1) {
+        for (size_t i = 0; i < IO_SCHED_MAX_QUEUE; i++) {
+            if (!s->async[i].busy) {
+                s->async[i].busy = true;
+                return &s->async[i];
+            }
+        }
+        s->lower->poll(s->lower);
+    }
+}
+
+/* 排序、合并并下发所有排队的异步请求 */
+static void run_queue(io_sched_t *s) {
+    if (s->nqueued == 0) return;
+
+    /* 取出整个队列：下发过程中的完成回调可能再次入队 */
+    io_entry_t e[IO_SCHED_MAX_QUEUE];
+    size_t n = s->nqueued;
+    memcpy(e, s->queue, n * sizeof(io_entry_t));
+    s->nqueued = 0;
+
+    order_entries(s, e, n);
+    size_t i = 0;
+    while (i < n) {
+        io_dispatch_t *d = get_async_slot(s);
+        i += fill_dispatch(s, d, e + i, merge_len(e + i, n - i));
+        d->lower->complete = async_done;
+        while (s->lower->start(s->lower, d->lower) != 0) {
+            /* 下层队列已满：回收完成的请求腾出位置 */
+            s->lower->poll(s->lower);
+        }
+    }
+}
+
+/* ============================================================================
+ * block_device_t 回调
+ * ========================================================================== */
+
+static void sched_read_block(block_device_t *dev, size_t block_id, uint8_t *buf) {
+    io_sched_t *s = to_sched(dev);
+    run_queue(s);
+    uint64_t start = read_time();
+    s->lower->read_block(s->lower, block_id, buf);
+    s->stats.requests++;
+    s->stats.dispatched++;
+    record_latency(s, read_time() - start, false);
+}
+
+static void sched_write_block(block_device_t *dev, size_t block_id, const uint8_t *buf) {
+    io_sched_t *s = to_sched(dev);
+    run_queue(s);
+    uint64_t start = read_time();
+    s->lower->write_block(s->lower, block_id, buf);
+    s->stats.requests++;
+    s->stats.dispatched++;
+    record_latency(s, read_time() - start, true);
+}
+
+static void sched_read_blocks(block_device_t *dev, size_t block_id, size_t count, uint8_t *buf) {
+    io_sched_t *s = to_sched(dev);
+    run_queue(s);
+    uint64_t start = read_time();
+    s->lower->read_blocks(s->lower, block_id, count, buf);
+    s->stats.requests++;
+    s->stats.dispatched++;
+    record_latency(s, read_time() - start, false);
+}
+
+static void sched_write_blocks(block_device_t *dev, size_t block_id, size_t count,
+                               const uint8_t *buf) {
+    io_sched_t *s = to_sched(dev);
+    run_queue(s);
+    uint64_t start = read_time();
+    s->lower->write_blocks(s->lower, block_id, count, buf);
+    s->stats.requests++;
+    s->stats.dispatched++;
+    record_latency(s, read_time() - start, true);
+}
+
+/* 同步批量：分段排序合并后一次交给下层 */
+static int sched_submit(block_device_t *dev, block_request_t *reqs, size_t n) {
+    io_sched_t *s = to_sched(dev);
+    run_queue(s);
+
+    int ret = 0;
+    size_t done = 0;
+    while (done < n) {
+        io_entry_t e[IO_SCHED_MAX_QUEUE];
+        size_t k = n - done;
+        if (k > IO_SCHED_MAX_QUEUE) k = IO_SCHED_MAX_QUEUE;
+        uint64_t now = read_time();
+        for (size_t i = 0; i < k; i++) {
+            e[i].req = &reqs[done + i];
+            e[i].queued_at = now;
+        }
+        s->stats.requests += k;
+
+        order_entries(s, e, k);
+        size_t m = 0;
+        for (size_t i = 0; i < k; m++) {
+            io_dispatch_t *d = &s->batch[m];
+            d->lower = &s->batch_reqs[m];
+            i += fill_dispatch(s, d, e + i, merge_len(e + i, k - i));
+        }
+
+        if (s->lower->submit) {
+            s->lower->submit(s->lower, s->batch_reqs, m);
+        } else {
+            for (size_t i = 0; i < m; i++) {
+                block_request_t *r = &s->batch_reqs[i];
+                if (r->write) s->lower->write_blocks(s->lower, r->block_id, r->count, r->buf);
+                else s->lower->read_blocks(s->lower, r->block_id, r->count, r->buf);
+                r->status = 0;
+            }
+        }
+
+        for (size_t i = 0; i < m; i++) {
+            finish_dispatch(&s->batch[i]);
+            if (s->batch_reqs[i].status != 0) ret = -1;
+        }
+        done += k;
+    }
+    return ret;
+}
+
+static int sched_start(block_device_t *dev, block_request_t *req) {
+    io_sched_t *s = to_sched(dev);
+    s->queue[s->nqueued].req = req;
+    s->queue[s->nqueued].queued_at = read_time();
+    s->nqueued++;
+    s->stats.requests++;
+    req->status = BLOCK_REQ_PENDING;
+
+    if (s->plug_depth == 0 || s->nqueued == IO_SCHED_MAX_QUEUE) {
+        run_queue(s);
+    }
+    return 0;
+}
+
+static void sched_poll(block_device_t *dev) {
+    io_sched_t *s = to_sched(dev);
+    run_queue(s);
+    s->lower->poll(s->lower);
+}
+
+static int sched_flush(block_device_t *dev) {
+    io_sched_t *s = to_sched(dev);
+    run_queue(s);
+    return s->lower->flush(s->lower);
+}
+
+static void sched_plug(block_device_t *dev) {
+    io_sched_plug(to_sched(dev));
+}
+
+static void sched_unplug(block_device_t *dev) {
+    io_sched_unplug(to_sched(dev));
+}
+
+/* ============================================================================
+ * 公共接口
+ * ========================================================================== */
+
+block_device_t *io_sched_init(io_sched_t *s, block_device_t *lower, io_sched_policy_t policy) {
+    memset(s, 0, sizeof(*s));
+    s->lower = lower;
+    s->policy = policy;
+    for (size_t i = 0; i < IO_SCHED_MAX_QUEUE; i++) {
+        s->async[i].lower = &s->async_reqs[i];
+    }
+
+    /* 下层缺少的可选接口在本层同样缺省 */
+    s->dev.read_block = sched_read_block;
+    s->dev.write_block = sched_write_block;
+    s->dev.read_blocks = lower->read_blocks ? sched_read_blocks : NULL;
+    s->dev.write_blocks = lower->write_blocks ? sched_write_blocks : NULL;
+    s->dev.submit = (lower->read_blocks && lower->write_blocks) || lower->submit ?
+                    sched_submit : NULL;
+    s->dev.start = lower->start && lower->poll ? sched_start : NULL;
+    s->dev.poll = lower->poll ? sched_poll : NULL;
+    s->dev.flush = lower->flush ? sched_flush : NULL;
+    s->dev.plug = sched_plug;
+    s->dev.unplug = sched_unplug;
+    s->dev.priv = s;
+    return &s->dev;
+}
+
+void io_sched_set_policy(io_sched_t *s, io_sched_policy_t policy) {
+    run_queue(s);
+    s->policy = policy;
+}
+
+void io_sched_plug(io_sched_t *s) {
+    s->plug_depth++;
+}
+
+void io_sched_unplug(io_sched_t *s) {
+    if (s->plug_depth > 0 && --s->plug_depth == 0) {
+        run_queue(s);
+    }
+}
+
+void io_sched_get_stats(const io_sched_t *s, io_sched_stats_t *stats) {
+    *stats = s->stats;
+}
+
+const char *io_sched_policy_name(io_sched_policy_t policy) {
+    switch (policy) {
+    case IO_SCHED_NOOP:     return "noop";
+    case IO_SCHED_DEADLINE: return "deadline";
+    case IO_SCHED_ELEVATOR: return "elevator";
+    }
+    return "unknown";
+}
@@ -1,38 +1,211 @@
 /**
- * 简单堆分配器实现
+ * 伙伴系统堆分配器实现
  *
- * Bump allocator: 只向上增长，不真正释放
+ * 每个阶 (order) 维护一个双向空闲链表和一张空闲位图：
+ * - 阶 k 的块大小为 HEAP_MIN_BLOCK << k，地址按块大小对齐（绝对地址）
+ * - 块 addr 的伙伴为 addr ^ size
+ * - 位图中置位表示"该阶在此处有一个空闲块挂在链表上"，用于 O(1) 判断伙伴是否空闲
  */
 #include "heap.h"
+#include <stdbool.h>
 #include <string.h>
 
+typedef struct free_block {
+    struct free_block *prev;
+    struct free_block *next;
+} free_block_t;
+
+static free_block_t g_free_lists[HEAP_MAX_ORDER + 1];  /* 循环链表哨兵 */
+static uint64_t *g_free_bitmap[HEAP_MAX_ORDER + 1];
+
 static uintptr_t heap_start;
 static uintptr_t heap_end;
-static uintptr_t heap_current;
+
+/* 页引用计数，按 (addr >> 12) - g_ref_base 索引 */
+static uint16_t *g_page_ref;
+static uintptr_t g_ref_base;
+
+static heap_stats_t g_stats;
+
+/* ============================================================================
+ * 辅助函数
+ * ========================================================================== */
+
+static inline size_t order_size(int order) {
+    return HEAP_MIN_BLOCK << order;
+}
+
+static inline uintptr_t align_up(uintptr_t x, size_t align) {
+    return (x + align - 1) & ~(uintptr_t)(align - 1);
+}
+
+/* 块在其所在阶位图中的下标 */
+static inline size_t bit_index(uintptr_t addr, int order) {
+    int shift = HEAP_MIN_BLOCK_BITS + order;
+    return (addr >> shift) - (heap_start >> shift);
+}
+
+static inline bool bit_test(int order, uintptr_t addr) {
+    size_t i = bit_index(addr, order);
+    return (g_free_bitmap[order][i / 64] >> (i % 64)) & 1;
+}
+
+static inline void bit_set(int order, uintptr_t addr) {
+    size_t i = bit_index(addr, order);
+    g_free_bitmap[order][i / 64] |= 1ULL << (i % 64);
+}
+
+static inline void bit_clear(int order, uintptr_t addr) {
+    size_t i = bit_index(addr, order);
+    g_free_bitmap[order][i / 64] &= ~(1ULL << (i % 64));
+}
+
+static void list_push(int order, uintptr_t addr) {
+    free_block_t *head = &g_free_lists[order];
+    free_block_t *blk = (free_block_t *)addr;
+    blk->prev = head;
+    blk->next = head->next;
+    head->next->prev = blk;
+    head->next = blk;
+    bit_set(order, addr);
+}
+
+static void list_remove(int order, uintptr_t addr) {
+    free_block_t *blk = (free_block_t *)addr;
+    blk->prev->next = blk->next;
+    blk->next->prev = blk->prev;
+    bit_clear(order, addr);
+}
+
+/* 满足 size 的最小阶 */
+static int size_to_order(size_t size) {
+    int order = 0;
+    while (order <= HEAP_MAX_ORDER && order_size(order) < size) {
+        order++;
+    }
+    return order;
+}
+
+/* 放入一个空闲块，并尽可能与伙伴合并 */
+static void free_block(uintptr_t addr, int order) {
+    /* 重复释放：直接忽略 */
+    if (bit_test(order, addr)) return;
+
+    while (order < HEAP_MAX_ORDER) {
+        uintptr_t buddy = addr ^ order_size(order);
+        if (buddy < heap_start || buddy + order_size(order) > heap_end) break;
+        if (!bit_test(order, buddy)) break;
+
+        list_remove(order, buddy);
+        if (buddy < addr) addr = buddy;
+        order++;
+    }
+    list_push(order, addr);
+}
+
+/* 把 [addr, addr + len) 拆成尽可能大的对齐块后释放 */
+static void free_range(uintptr_t addr, uintptr_t len) {
+    uintptr_t end = addr + len;
+    while (addr < end) {
+        int order = HEAP_MAX_ORDER;
+        while (order > 0 &&
+               ((addr & (order_size(order) - 1)) != 0 || addr + order_size(order) > end)) {
+            order--;
+        }
+        free_block(addr, order);
+        addr += order_size(order);
+    }
+}
+
+/* ============================================================================
+ * 公共接口
+ * ========================================================================== */
 
 void heap_init(uintptr_t start, size_t size) {
-    heap_start = start;
-    heap_end = start + size;
-    heap_current = start;
+    uintptr_t end = (start + size) & ~(HEAP_MIN_BLOCK - 1);
+    start = align_up(start, 8);
+
+    /* 从区域开头切出各阶位图（按原始区域计算位数，是实际所需的上界） */
+    uintptr_t cursor = start;
+    for (int order = 0; order <= HEAP_MAX_ORDER; order++) {
+        int shift = HEAP_MIN_BLOCK_BITS + order;
+        size_t bits = ((end - 1) >> shift) - (start >> shift) + 1;
+        size_t bytes = ((bits + 63) / 64) * sizeof(uint64_t);
+        g_free_bitmap[order] = (uint64_t *)cursor;
+        memset((void *)cursor, 0, bytes);
+        cursor += bytes;
+    }
+
+    /* 页引用计数表 */
+    g_ref_base = start >> HEAP_PAGE_BITS;
+    size_t pages = ((end - 1) >> HEAP_PAGE_BITS) - g_ref_base + 1;
+    cursor = align_up(cursor, sizeof(uint16_t));
+    g_page_ref = (uint16_t *)cursor;
+    memset((void *)cursor, 0, pages * sizeof(uint16_t));
+    cursor += pages * sizeof(uint16_t);
+
+    /* 让分配区域按页对齐，保证页级分配天然对齐 */
+    heap_start = align_up(cursor, HEAP_PAGE_SIZE);
+    heap_end = end;
+
+    for (int order = 0; order <= HEAP_MAX_ORDER; order++) {
+        g_free_lists[order].prev = &g_free_lists[order];
+        g_free_lists[order].next = &g_free_lists[order];
+    }
+
+    memset(&g_stats, 0, sizeof(g_stats));
+    if (heap_start < heap_end) {
+        g_stats.total = heap_end - heap_start;
+        free_range(heap_start, heap_end - heap_start);
+    }
 }
 
 void *heap_alloc(size_t size, size_t align) {
-    /* 对齐当前指针 */
-    uintptr_t aligned = (heap_current + align - 1) & ~(align - 1);
+    size_t need = align_up(size ? size : 1, HEAP_MIN_BLOCK);
+    size_t block = need > align ? need : align;
+    int order = size_to_order(block);
 
-    /* 检查是否有足够空间 */
-    if (aligned + size > heap_end) {
+    /* 找到最小的非空阶 */
+    int found = order;
+    while (found <= HEAP_MAX_ORDER && g_free_lists[found].next == &g_free_lists[found]) {
+        found++;
+    }
+    if (found > HEAP_MAX_ORDER) {
+        g_stats.failed_count++;
         return NULL;
     }
 
-    heap_current = aligned + size;
-    return (void *)aligned;
+    uintptr_t addr = (uintptr_t)g_free_lists[found].next;
+    list_remove(found, addr);
+
+    /* 逐级拆分，后半部分挂回空闲链表 */
+    while (found > order) {
+        found--;
+        list_push(found, addr + order_size(found));
+    }
+
+    /* 归还尾部不需要的部分 */
+    if (order_size(order) > need) {
+        free_range(addr + need, order_size(order) - need);
+    }
+
+    g_stats.used += need;
+    if (g_stats.used > g_stats.peak) g_stats.peak = g_stats.used;
+    g_stats.alloc_count++;
+    return (void *)addr;
 }
 
 void heap_free(void *ptr, size_t size) {
-    /* Bump allocator 不真正释放 */
-    (void)ptr;
-    (void)size;
+    uintptr_t addr = (uintptr_t)ptr;
+    if (!ptr || addr < heap_start || addr >= heap_end) return;
+    if (addr & (HEAP_MIN_BLOCK - 1)) return;
+
+    size_t len = align_up(size ? size : 1, HEAP_MIN_BLOCK);
+    if (addr + len > heap_end) return;
+
+    free_range(addr, len);
+    g_stats.used -= len;
+    g_stats.free_count++;
 }
 
 void *heap_alloc_zeroed(size_t size, size_t align) {
@@ -42,3 +215,13 @@ void *heap_alloc_zeroed(size_t size, size_t align) {
     }
     return ptr;
 }
+
+void heap_get_stats(heap_stats_t *stats) {
+    *stats = g_stats;
+}
+
+uint16_t *heap_page_ref(const void *page) {
+    uintptr_t addr = (uintptr_t)page;
+    if (addr < heap_start || addr >= heap_end) return NULL;
+    return &g_page_ref[(addr >> HEAP_PAGE_BITS) - g_ref_base];
+}
@@ -1,8 +1,12 @@
 /**
- * 简单堆分配器
+ * 内核堆分配器
  *
- * 使用 bump allocator（递增分配），不支持释放。
- * 足够用于教学演示。
+ * 基于伙伴系统 (buddy system) 管理整个堆区：
+ * - 块大小为 2 的幂，最小 HEAP_MIN_BLOCK 字节，天然按自身大小对齐
+ * - 分配/释放均为 O(log n)，释放时与空闲伙伴合并
+ * - 非 2 的幂请求会把尾部多余部分立即归还，释放时按同样的大小拆分
+ *
+ * 物理页帧（页表页、用户数据页）与小对象都从这里分配。
  */
 #ifndef HEAP_H
 #define HEAP_H
@@ -10,9 +14,28 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#define HEAP_MIN_BLOCK_BITS 6
+#define HEAP_MIN_BLOCK      (1UL << HEAP_MIN_BLOCK_BITS)   /* 64 B */
+#define HEAP_MAX_ORDER      20                              /* 最大块 64 MB */
+
+#define HEAP_PAGE_BITS      12
+#define HEAP_PAGE_SIZE      (1UL << HEAP_PAGE_BITS)
+
+/* 堆使用统计 */
+typedef struct {
+    size_t total;           /* 可管理的总字节数 */
+    size_t used;            /* 当前已分配字节数 */
+    size_t peak;            /* 已分配字节数峰值 */
+    size_t alloc_count;     /* 累计分配次数 */
+    size_t free_count;      /* 累计释放次数 */
+    size_t failed_count;    /* 分配失败次数 */
+} heap_stats_t;
+
 /**
  * 初始化堆
  *
+ * 伙伴系统的空闲位图从区域开头切出，剩余部分参与分配。
+ *
  * @param start 堆起始地址
  * @param size  堆大小
  */
@@ -22,13 +45,16 @@ void heap_init(uintptr_t start, size_t size);
  * 分配内存
  *
  * @param size  请求大小
- * @param align 对齐要求
+ * @param align 对齐要求（2 的幂）
  * @return 分配的内存指针，失败返回 NULL
  */
 void *heap_alloc(size_t size, size_t align);
 
 /**
- * 释放内存 (bump allocator 不真正释放)
+ * 释放内存
+ *
+ * size 必须与分配时一致；也可以只释放一次分配中按页对齐的一部分
+ * （例如多页分配中的单页），剩余部分之后再分别释放。
  */
 void heap_free(void *ptr, size_t size);
 
@@ -37,4 +63,20 @@ void heap_free(void *ptr, size_t size);
  */
 void *heap_alloc_zeroed(size_t size, size_t align);
 
+/**
+ * 获取堆使用统计
+ */
+void heap_get_stats(heap_stats_t *stats);
+
+/**
+ * 获取物理页的引用计数器
+ *
+ * 堆为区域内每一页维护一个 16 位计数器，初始为 0，释放页时不会自动清零。
+ * 计数含义由使用者约定（kernel-vm 用它记录写时复制页的额外共享者数量）。
+ *
+ * @param page 页内任意地址
+ * @return 计数器指针，地址不在堆内时返回 NULL
+ */
+uint16_t *heap_page_ref(const void *page);
+
 #endif /* HEAP_H */
@@ -0,0 +1,179 @@
+/**
+ * 对象缓存 (slab) 分配器实现
+ */
+#include "slab.h"
+#include "heap.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define SLAB_MIN_SIZE    4096
+#define SLAB_MIN_OBJS    8
+
+/* slab 头部，位于 slab 起始处 */
+typedef struct kmem_slab {
+    kmem_cache_t *cache;
+    struct kmem_slab *prev;
+    struct kmem_slab *next;
+    void *free;             /* 本 slab 内的空闲对象链表 */
+    uint32_t inuse;
+    uint32_t total;
+} kmem_slab_t;
+
+static kmem_cache_t *g_caches;
+
+/* ============================================================================
+ * 辅助函数
+ * ========================================================================== */
+
+static inline size_t objs_offset(const kmem_cache_t *cache) {
+    return KMEM_ALIGN_UP(sizeof(kmem_slab_t), cache->align);
+}
+
+/* 计算 slab 大小：至少一页，且能容纳 SLAB_MIN_OBJS 个对象 */
+static void cache_setup(kmem_cache_t *cache) {
+    size_t need = objs_offset(cache) + cache->obj_size * SLAB_MIN_OBJS;
+    size_t size = SLAB_MIN_SIZE;
+    while (size < need) size <<= 1;
+    cache->slab_size = size;
+
+    if (!cache->registered) {
+        cache->registered = true;
+        cache->next = g_caches;
+        g_caches = cache;
+    }
+}
+
+static void partial_push(kmem_cache_t *cache, kmem_slab_t *slab) {
+    slab->prev = NULL;
+    slab->next = cache->partial;
+    if (cache->partial) cache->partial->prev = slab;
+    cache->partial = slab;
+}
+
+static void partial_remove(kmem_cache_t *cache, kmem_slab_t *slab) {
+    if (slab->prev) slab->prev->next = slab->next;
+    else cache->partial = slab->next;
+    if (slab->next) slab->next->prev = slab->prev;
+    slab->prev = slab->next = NULL;
+}
+
+/* 向堆申请一个新 slab 并切分 */
+static kmem_slab_t *slab_create(kmem_cache_t *cache) {
+    kmem_slab_t *slab = heap_alloc(cache->slab_size, cache->slab_size);
+    if (!slab) return NULL;
+
+    slab->cache = cache;
+    slab->prev = slab->next = NULL;
+    slab->inuse = 0;
+    slab->total = (cache->slab_size - objs_offset(cache)) / cache->obj_size;
+    slab->free = NULL;
+
+    /* 倒序入链，使分配顺序与地址顺序一致 */
+    uint8_t *base = (uint8_t *)slab + objs_offset(cache);
+    for (uint32_t i = slab->total; i > 0; i--) {
+        void *obj = base + (size_t)(i - 1) * cache->obj_size;
+        *(void **)obj = slab->free;
+        slab->free = obj;
+    }
+
+    cache->stats.slabs++;
+    return slab;
+}
+
+/* ============================================================================
+ * 公共接口
+ * ========================================================================== */
+
+void kmem_cache_init(kmem_cache_t *cache, const char *name, size_t size, size_t align,
+                     void (*ctor)(void *obj)) {
+    memset(cache, 0, sizeof(*cache));
+    if (align < 8) align = 8;
+    if (size < sizeof(void *)) size = sizeof(void *);
+    cache->name = name;
+    cache->align = align;
+    cache->obj_size = KMEM_ALIGN_UP(size, align);
+    cache->ctor = ctor;
+}
+
+/* 取出一个空闲对象，不调用构造函数 */
+static void *cache_take(kmem_cache_t *cache) {
+    if (!cache->slab_size) cache_setup(cache);
+
+    kmem_slab_t *slab = cache->partial;
+    if (slab) {
+        cache->stats.hits++;
+    } else if (cache->empty) {
+        slab = cache->empty;
+        cache->empty = NULL;
+        partial_push(cache, slab);
+        cache->stats.hits++;
+    } else {
+        cache->stats.misses++;
+        slab = slab_create(cache);
+        if (!slab) return NULL;
+        partial_push(cache, slab);
+    }
+
+    void *obj = slab->free;
+    slab->free = *(void **)obj;
+    slab->inuse++;
+    if (slab->inuse == slab->total) {
+        partial_remove(cache, slab);
+    }
+
+    cache->stats.allocs++;
+    cache->stats.in_use++;
+    return obj;
+}
+
+void *kmem_cache_alloc(kmem_cache_t *cache) {
+    void *obj = cache_take(cache);
+    if (obj && cache->ctor) cache->ctor(obj);
+    return obj;
+}
+
+void *kmem_cache_zalloc(kmem_cache_t *cache) {
+    void *obj = cache_take(cache);
+    if (obj) {
+        memset(obj, 0, cache->obj_size);
+    }
+    return obj;
+}
+
+void kmem_cache_free(kmem_cache_t *cache, void *obj) {
+    if (!obj || !cache->slab_size) return;
+
+    kmem_slab_t *slab = (kmem_slab_t *)((uintptr_t)obj & ~(cache->slab_size - 1));
+    if (slab->cache != cache) return;
+
+    bool was_full = (slab->inuse == slab->total);
+
+    *(void **)obj = slab->free;
+    slab->free = obj;
+    slab->inuse--;
+
+    cache->stats.frees++;
+    cache->stats.in_use--;
+
+    if (was_full) {
+        partial_push(cache, slab);
+    }
+
+    if (slab->inuse == 0) {
+        partial_remove(cache, slab);
+        if (!cache->empty) {
+            cache->empty = slab;
+        } else {
+            heap_free(slab, cache->slab_size);
+            cache->stats.slabs--;
+        }
+    }
+}
+
+void kmem_cache_get_stats(const kmem_cache_t *cache, kmem_stats_t *stats) {
+    *stats = cache->stats;
+}
+
+const kmem_cache_t *kmem_cache_next(const kmem_cache_t *prev) {
+    return prev ? prev->next : g_caches;
+}
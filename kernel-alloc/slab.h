@@ -0,0 +1,102 @@
+/**
+ * 对象缓存 (slab) 分配器
+ *
+ * 为频繁分配的定长内核对象（inode_t、file_handle_t、address_space_t、
+ * mutex_t 等）提供按类型划分的缓存：
+ * - 每个缓存从堆中成块申请 slab（页对齐，大小为 2 的幂），切分成等长对象
+ * - slab 头部记录所属缓存与本 slab 的空闲链表，释放时按地址掩码找回 slab
+ * - 分配优先使用部分空闲的 slab，分配/释放都是 O(1)
+ * - 完全空闲的 slab 保留一个备用，其余归还堆
+ *
+ * 缓存通常以静态变量定义，用 KMEM_CACHE_INIT 初始化，首次分配时自动注册。
+ */
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* 缓存统计 */
+typedef struct {
+    size_t hits;            /* 直接从已有 slab 取得对象的次数 */
+    size_t misses;          /* 需要向堆申请新 slab 的次数 */
+    size_t allocs;          /* 累计分配对象数 */
+    size_t frees;           /* 累计释放对象数 */
+    size_t in_use;          /* 当前使用中的对象数 */
+    size_t slabs;           /* 当前持有的 slab 数 */
+} kmem_stats_t;
+
+struct kmem_slab;
+
+typedef struct kmem_cache {
+    const char *name;
+    size_t obj_size;                /* 对象大小（已按 align 向上取整） */
+    size_t align;
+    void (*ctor)(void *obj);        /* 对象构造函数，每次分配时调用 */
+    size_t slab_size;               /* 每个 slab 的字节数，首次使用时计算 */
+    struct kmem_slab *partial;      /* 尚有空闲对象的 slab（双向链表） */
+    struct kmem_slab *empty;        /* 保留的一个全空 slab */
+    struct kmem_cache *next;        /* 全局缓存链表 */
+    bool registered;
+    kmem_stats_t stats;
+} kmem_cache_t;
+
+#define KMEM_ALIGN_UP(x, a) (((x) + (a) - 1) & ~((size_t)(a) - 1))
+
+/**
+ * 静态初始化一个缓存
+ *
+ * @param cname 缓存名称（用于统计输出）
+ * @param type  对象类型
+ * @param ctor  构造函数，可为 NULL
+ */
+#define KMEM_CACHE_INIT(cname, type, ctor_fn) {                             \
+    .name = (cname),                                                        \
+    .obj_size = KMEM_ALIGN_UP(sizeof(type) < sizeof(void *) ?               \
+                              sizeof(void *) : sizeof(type), 8),            \
+    .align = 8,                                                             \
+    .ctor = (ctor_fn),                                                      \
+}
+
+/**
+ * 运行时初始化一个缓存
+ *
+ * @param align 对象对齐（2 的幂，至少 8）
+ */
+void kmem_cache_init(kmem_cache_t *cache, const char *name, size_t size, size_t align,
+                     void (*ctor)(void *obj));
+
+/**
+ * 从缓存分配一个对象
+ *
+ * 若缓存配置了构造函数，返回前会对对象调用一次。
+ *
+ * @return 对象指针，失败返回 NULL
+ */
+void *kmem_cache_alloc(kmem_cache_t *cache);
+
+/**
+ * 分配一个清零的对象（不调用构造函数）
+ */
+void *kmem_cache_zalloc(kmem_cache_t *cache);
+
+/**
+ * 释放对象回所属缓存
+ */
+void kmem_cache_free(kmem_cache_t *cache, void *obj);
+
+/**
+ * 获取缓存统计
+ */
+void kmem_cache_get_stats(const kmem_cache_t *cache, kmem_stats_t *stats);
+
+/**
+ * 遍历所有已注册（至少分配过一次）的缓存
+ *
+ * @param prev 上一个缓存，传 NULL 返回第一个
+ * @return 下一个缓存，遍历结束返回 NULL
+ */
+const kmem_cache_t *kmem_cache_next(const kmem_cache_t *prev);
+
+#endif /* SLAB_H */
@@ -36,7 +36,7 @@ typedef struct {
  */
 typedef struct {
     context_t ctx;          /* 线程上下文 (266 bytes, 对齐到 272) */
-    uint64_t satp;          /* 目标地址空间的 satp (+272) */
+    uint64_t satp;          /* 目标地址空间的 satp，含 ASID (+272) */
     uint64_t kernel_satp;   /* 内核 satp 暂存 (+280) */
     uint64_t kernel_stvec;  /* 内核 stvec 暂存 (+288) */
 } foreign_ctx_t;
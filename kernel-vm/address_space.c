@@ -3,8 +3,17 @@
  */
 #include "address_space.h"
 #include "../kernel-alloc/heap.h"
+#include "../kernel-alloc/slab.h"
+#include "../util/riscv.h"
+#include <stdbool.h>
 #include <string.h>
 
+static kmem_cache_t g_as_cache = KMEM_CACHE_INIT("address_space", address_space_t, NULL);
+static kmem_cache_t g_area_cache = KMEM_CACHE_INIT("vm_area", vm_area_t, NULL);
+
+/* 共享零页：匿名页首次读时映射到这里，写时再分配 */
+static uint8_t g_zero_page[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+
 /* 分配一个清零的物理页 */
 static void *alloc_page(void) {
     void *page = heap_alloc(PAGE_SIZE, PAGE_SIZE);
@@ -15,8 +24,8 @@ static void *alloc_page(void) {
 }
 
 /* 分配多个连续的清零物理页 */
-static void *alloc_pages(size_t count) {
-    void *pages = heap_alloc(count * PAGE_SIZE, PAGE_SIZE);
+static void *alloc_pages(size_t count, size_t align) {
+    void *pages = heap_alloc(count * PAGE_SIZE, align);
     if (pages) {
         memset(pages, 0, count * PAGE_SIZE);
     }
@@ -24,23 +33,84 @@ static void *alloc_pages(size_t count) {
 }
 
 address_space_t *as_create(void) {
-    address_space_t *as = heap_alloc(sizeof(address_space_t), 8);
+    address_space_t *as = kmem_cache_zalloc(&g_as_cache);
     if (!as) return NULL;
 
     as->root = alloc_page();
     if (!as->root) {
-        heap_free(as, sizeof(address_space_t));
+        kmem_cache_free(&g_as_cache, as);
         return NULL;
     }
 
     return as;
 }
 
-void as_destroy(address_space_t *as) {
-    /* TODO: 递归释放所有页表页和数据页 */
-    if (as) {
-        heap_free(as, sizeof(address_space_t));
+/* ============================================================================
+ * ASID 分配
+ *
+ * ASID 0 留给内核地址空间。每一代内按顺序分配，用尽后代号加一并刷新整个
+ * TLB，之后各地址空间在下次激活时重新领取，因此无需在销毁时回收 ASID。
+ * ========================================================================== */
+
+#define ASID_GEN_SHIFT 16
+
+static uint32_t g_asid_bits;
+static uint64_t g_asid_generation = 1;
+static uint32_t g_asid_next = 1;
+static const address_space_t *g_asid_last;     /* 无 ASID 时上次激活的地址空间 */
+
+void asid_init(void) {
+    uint64_t satp = read_satp();
+    asm volatile("csrw satp, %0" :: "r"(satp | SATP_ASID_MASK));
+    uint64_t probe = read_satp();
+    asm volatile("csrw satp, %0" :: "r"(satp));
+
+    uint64_t field = (probe & SATP_ASID_MASK) >> SATP_ASID_SHIFT;
+    g_asid_bits = 0;
+    while (field & 1) {
+        g_asid_bits++;
+        field >>= 1;
+    }
+    sfence_vma_all();
+}
+
+/* 地址空间当前有效的 ASID；未分配或属于上一代时返回 -1 */
+static int asid_of(const address_space_t *as) {
+    if (!g_asid_bits) return g_asid_last == as ? 0 : -1;
+    if (!as->asid || (as->asid >> ASID_GEN_SHIFT) != g_asid_generation) return -1;
+    return (int)(as->asid & 0xFFFF);
+}
+
+uint64_t as_activate(address_space_t *as) {
+    if (!g_asid_bits) {
+        /* 所有地址空间共用 ASID 0，换人时只能整体刷新 */
+        if (g_asid_last != as) {
+            sfence_vma_all();
+            g_asid_last = as;
+        }
+        return make_satp(as_root_ppn(as), 0);
+    }
+
+    if (asid_of(as) < 0) {
+        if (g_asid_next >= (1U << g_asid_bits)) {
+            g_asid_generation++;
+            g_asid_next = 1;
+            sfence_vma_all();
+        }
+        as->asid = (g_asid_generation << ASID_GEN_SHIFT) | g_asid_next++;
     }
+    return make_satp(as_root_ppn(as), (uint16_t)(as->asid & 0xFFFF));
+}
+
+/* 页表项改动后刷新该地址空间在 TLB 中的旧条目 */
+static void as_flush_page(const address_space_t *as, vaddr_t va) {
+    int asid = asid_of(as);
+    if (asid >= 0) sfence_vma_page(va, (uint16_t)asid);
+}
+
+static void as_flush_all(const address_space_t *as) {
+    int asid = asid_of(as);
+    if (asid >= 0) sfence_vma_asid((uint16_t)asid);
 }
 
 uintptr_t as_root_ppn(const address_space_t *as) {
@@ -52,17 +122,19 @@ pte_t *as_root(const address_space_t *as) {
 }
 
 /**
- * 查找或创建页表项
- * 返回最终级别的 PTE 指针
+ * 查找或创建第 target 级的页表项 (0 = 根, 2 = 4K 叶子所在级)
+ *
+ * 途中遇到大页叶子时返回 NULL：不能在大页内部再建立映射。
  */
-static pte_t *walk(address_space_t *as, uintptr_t vpn, int create) {
+static pte_t *walk_level(address_space_t *as, uintptr_t vpn, int target, int create) {
     pte_t *pt = as->root;
 
-    for (int level = 0; level < LEVELS - 1; level++) {
+    for (int level = 0; level < target; level++) {
         uintptr_t idx = vpn_index(vpn, level);
         pte_t *pte = &pt[idx];
 
         if (pte_valid(*pte)) {
+            if (pte_is_leaf(*pte)) return NULL;
             /* 已有页表项，跟随到下一级 */
             pt = (pte_t *)ppn_to_pa(pte_ppn(*pte));
         } else if (create) {
@@ -76,30 +148,70 @@ static pte_t *walk(address_space_t *as, uintptr_t vpn, int create) {
         }
     }
 
-    /* 返回最后一级的 PTE */
-    return &pt[vpn_index(vpn, LEVELS - 1)];
+    return &pt[vpn_index(vpn, target)];
+}
+
+/**
+ * 查找或创建页表项
+ * 返回最终级别的 PTE 指针
+ */
+static pte_t *walk(address_space_t *as, uintptr_t vpn, int create) {
+    return walk_level(as, vpn, LEVELS - 1, create);
 }
 
+/* 映射一段连续物理页，VPN 与 PPN 对齐处自动使用大页 */
 void as_map_extern(address_space_t *as,
                    uintptr_t vpn_start, uintptr_t vpn_end,
                    uintptr_t ppn_base, uint64_t flags) {
-    for (uintptr_t vpn = vpn_start; vpn < vpn_end; vpn++) {
-        pte_t *pte = walk(as, vpn, 1);
+    uintptr_t vpn = vpn_start;
+    while (vpn < vpn_end) {
+        uintptr_t ppn = ppn_base + (vpn - vpn_start);
+
+        /* 选择 VPN、PPN 都对齐且不越界的最大页 */
+        int level = LEVELS - 1;
+        while (level > 0) {
+            uintptr_t pages = 1UL << (VPN_BITS * (LEVELS - level));
+            if (((vpn | ppn) & (pages - 1)) != 0 || vpn + pages > vpn_end) break;
+            level--;
+        }
+
+        /* 该位置已有下级页表时不能覆盖，改用更小的页 */
+        pte_t *pte = walk_level(as, vpn, level, 1);
+        while (pte && level < LEVELS - 1 && pte_valid(*pte) && !pte_is_leaf(*pte)) {
+            level++;
+            pte = walk_level(as, vpn, level, 1);
+        }
+
         if (pte) {
-            uintptr_t ppn = ppn_base + (vpn - vpn_start);
             *pte = make_pte(ppn, flags | PTE_V);
         }
+        vpn += 1UL << (VPN_BITS * (LEVELS - 1 - level));
     }
 }
 
+void as_share_kernel(address_space_t *dst, const address_space_t *kernel,
+                     vaddr_t va_start, vaddr_t va_end) {
+    uintptr_t first = vpn_index(va_vpn(va_start), 0);
+    uintptr_t last = vpn_index(va_vpn(va_end - 1), 0);
+    for (uintptr_t i = first; i <= last; i++) {
+        dst->root[i] = kernel->root[i];
+    }
+    dst->kernel_root = kernel->root;
+}
+
 void as_map(address_space_t *as,
             uintptr_t vpn_start, uintptr_t vpn_end,
             const void *data, size_t len, size_t offset,
             uint64_t flags) {
     size_t count = vpn_end - vpn_start;
 
-    /* 分配物理页 */
-    uint8_t *pages = alloc_pages(count);
+    /* 分配物理页；范围足够大且起点对齐时按大页对齐，以便使用大页映射 */
+    size_t align = PAGE_SIZE;
+    size_t mega = 1UL << VPN_BITS;
+    if (count >= mega && (vpn_start & (mega - 1)) == 0) {
+        align = mega * PAGE_SIZE;
+    }
+    uint8_t *pages = alloc_pages(count, align);
     if (!pages) return;
 
     /* 清零并拷贝数据 */
@@ -111,7 +223,219 @@ void as_map(address_space_t *as,
     as_map_extern(as, vpn_start, vpn_end, pa_ppn((paddr_t)pages), flags);
 }
 
-void *as_translate(const address_space_t *as, vaddr_t va, uint64_t required_flags) {
+/* ============================================================================
+ * 写时复制
+ *
+ * fork 时用户页不再复制，而是父子共享同一物理页：可写页去掉 PTE_W 并打上
+ * PTE_COW。堆的页引用计数记录"除第一个持有者外"的共享者数量，
+ * 因此新分配的页计数为 0，无需额外初始化。
+ * ========================================================================== */
+
+/* 增加一个共享者；页不在堆中（无法计数）时返回 false */
+static bool page_share(const void *page) {
+    uint16_t *ref = heap_page_ref(page);
+    if (!ref || *ref == UINT16_MAX) return false;
+    (*ref)++;
+    return true;
+}
+
+/* 为 COW 页取得独占的可写副本 */
+static int cow_break(address_space_t *as, vaddr_t va, pte_t *pte) {
+    uint8_t *page = (uint8_t *)ppn_to_pa(pte_ppn(*pte));
+    uint64_t flags = (pte_flags(*pte) & ~PTE_COW) | PTE_W;
+    uint16_t *ref = heap_page_ref(page);
+
+    if (page == g_zero_page) {
+        /* 零页：分配新的清零页即可 */
+        uint8_t *fresh = alloc_page();
+        if (!fresh) return -1;
+        *pte = make_pte(pa_ppn((paddr_t)fresh), flags);
+    } else if (ref && *ref > 0) {
+        /* 仍有其他共享者：复制一份 */
+        uint8_t *copy = heap_alloc(PAGE_SIZE, PAGE_SIZE);
+        if (!copy) return -1;
+        memcpy(copy, page, PAGE_SIZE);
+        (*ref)--;
+        *pte = make_pte(pa_ppn((paddr_t)copy), flags);
+    } else {
+        /* 最后一个持有者：直接恢复写权限 */
+        *pte = make_pte(pte_ppn(*pte), flags);
+    }
+    as_flush_page(as, va);
+    return 0;
+}
+
+/* ============================================================================
+ * 按需调页
+ * ========================================================================== */
+
+void vm_file_init(vm_file_t *file,
+                  size_t (*read)(vm_file_t *file, size_t offset, void *buf, size_t len),
+                  void (*release)(vm_file_t *file)) {
+    file->read = read;
+    file->release = release;
+    file->refcount = 1;
+}
+
+void vm_file_get(vm_file_t *file) {
+    if (file) file->refcount++;
+}
+
+void vm_file_put(vm_file_t *file) {
+    if (file && --file->refcount == 0 && file->release) {
+        file->release(file);
+    }
+}
+
+/* 常驻内存镜像 */
+typedef struct {
+    vm_file_t base;
+    const uint8_t *data;
+    size_t len;
+} mem_file_t;
+
+static size_t mem_file_read(vm_file_t *file, size_t offset, void *buf, size_t len) {
+    mem_file_t *mf = (mem_file_t *)file;
+    if (offset >= mf->len) return 0;
+    if (len > mf->len - offset) len = mf->len - offset;
+    memcpy(buf, mf->data + offset, len);
+    return len;
+}
+
+static void mem_file_release(vm_file_t *file) {
+    heap_free(file, sizeof(mem_file_t));
+}
+
+vm_file_t *vm_file_from_memory(const void *data, size_t len) {
+    mem_file_t *mf = heap_alloc(sizeof(mem_file_t), 8);
+    if (!mf) return NULL;
+    vm_file_init(&mf->base, mem_file_read, mem_file_release);
+    mf->data = data;
+    mf->len = len;
+    return &mf->base;
+}
+
+static int add_area(address_space_t *as, uintptr_t vpn_start, uintptr_t vpn_end,
+                    uint64_t flags, vm_file_t *file,
+                    vaddr_t file_va, size_t file_offset, size_t file_len) {
+    if (vpn_start >= vpn_end) return -1;
+
+    vm_area_t *area = kmem_cache_alloc(&g_area_cache);
+    if (!area) return -1;
+
+    area->vpn_start = vpn_start;
+    area->vpn_end = vpn_end;
+    area->flags = flags | PTE_V;
+    area->file = file;
+    area->file_va = file_va;
+    area->file_offset = file_offset;
+    area->file_len = file ? file_len : 0;
+    vm_file_get(file);
+
+    area->next = as->areas;
+    as->areas = area;
+    return 0;
+}
+
+int as_map_anon(address_space_t *as,
+                uintptr_t vpn_start, uintptr_t vpn_end,
+                uint64_t flags) {
+    return add_area(as, vpn_start, vpn_end, flags, NULL, 0, 0, 0);
+}
+
+int as_map_file(address_space_t *as,
+                uintptr_t vpn_start, uintptr_t vpn_end,
+                uint64_t flags, vm_file_t *file,
+                vaddr_t file_va, size_t file_offset, size_t file_len) {
+    return add_area(as, vpn_start, vpn_end, flags, file, file_va, file_offset, file_len);
+}
+
+/* 区域在页 [va, va + PAGE_SIZE) 内的文件数据范围，无重叠返回 false */
+static bool area_file_range(const vm_area_t *area, vaddr_t va, vaddr_t *start, vaddr_t *end) {
+    if (!area->file || area->file_len == 0) return false;
+    vaddr_t s = area->file_va > va ? area->file_va : va;
+    vaddr_t e = area->file_va + area->file_len;
+    if (e > va + PAGE_SIZE) e = va + PAGE_SIZE;
+    if (s >= e) return false;
+    *start = s;
+    *end = e;
+    return true;
+}
+
+/**
+ * 调入一个尚未映射的页
+ *
+ * 同一页可能被多个区域覆盖（如相邻 ELF 段共用边界页），
+ * 此时合并它们的权限并分别填入各自的文件数据。
+ */
+static int populate_page(address_space_t *as, uintptr_t vpn, uint64_t access) {
+    pte_t *pte = walk(as, vpn, 0);
+    if (pte && pte_valid(*pte)) return -1;
+
+    vaddr_t va = vpn_to_va(vpn);
+    uint64_t flags = 0;
+    bool has_file = false;
+    vaddr_t s, e;
+
+    for (vm_area_t *a = as->areas; a; a = a->next) {
+        if (vpn < a->vpn_start || vpn >= a->vpn_end) continue;
+        flags |= a->flags;
+        if (area_file_range(a, va, &s, &e)) has_file = true;
+    }
+    if (!flags) return -1;
+    if ((flags & access) != access) return -1;
+
+    pte = walk(as, vpn, 1);
+    if (!pte) return -1;
+
+    if (!has_file && !(access & PTE_W)) {
+        /* 匿名页的首次读：映射共享零页 */
+        uint64_t zflags = flags & ~PTE_W;
+        if (flags & PTE_W) zflags |= PTE_COW;
+        *pte = make_pte(pa_ppn((paddr_t)g_zero_page), zflags);
+        as_flush_page(as, va);
+        return 0;
+    }
+
+    uint8_t *page = alloc_page();
+    if (!page) return -1;
+
+    for (vm_area_t *a = as->areas; a; a = a->next) {
+        if (vpn < a->vpn_start || vpn >= a->vpn_end) continue;
+        if (!area_file_range(a, va, &s, &e)) continue;
+        a->file->read(a->file, a->file_offset + (s - a->file_va), page + (s - va), e - s);
+    }
+
+    *pte = make_pte(pa_ppn((paddr_t)page), flags);
+    as_flush_page(as, va);
+    return 0;
+}
+
+int as_handle_fault(address_space_t *as, vaddr_t va, uint64_t access) {
+    uintptr_t vpn = va_vpn(va);
+    pte_t *pte = walk(as, vpn, 0);
+    if (!pte || !pte_valid(*pte)) {
+        return populate_page(as, vpn, access);
+    }
+    if (!(*pte & PTE_U)) return -1;
+
+    if ((access & PTE_W) && (*pte & PTE_COW)) {
+        return cow_break(as, va, pte);
+    }
+    return -1;
+}
+
+uint64_t as_fault_access(uintptr_t code) {
+    switch (code) {
+        case EXCEP_INSTRUCTION_PAGE_FAULT: return PTE_X;
+        case EXCEP_LOAD_PAGE_FAULT:       return PTE_R;
+        case EXCEP_STORE_PAGE_FAULT:      return PTE_W;
+        default:                          return 0;
+    }
+}
+
+/* 查找已有映射并检查权限 */
+static void *translate_mapped(address_space_t *as, vaddr_t va, uint64_t required_flags) {
     uintptr_t vpn = va_vpn(va);
     pte_t *pt = as->root;
 
@@ -124,12 +448,18 @@ void *as_translate(const address_space_t *as, vaddr_t va, uint64_t required_flag
         }
 
         if (pte_is_leaf(pte)) {
+            /* 内核代用户写 COW 页时先完成复制 */
+            if ((required_flags & PTE_W) && (pte & PTE_COW)) {
+                if (cow_break(as, va, &pt[idx]) != 0) return NULL;
+                pte = pt[idx];
+            }
             /* 检查权限 */
             if ((pte_flags(pte) & required_flags) != required_flags) {
                 return NULL;
             }
-            /* 计算物理地址 */
-            paddr_t pa = ppn_to_pa(pte_ppn(pte)) + va_offset(va);
+            /* 计算物理地址（大页的页内偏移覆盖低若干级 VPN） */
+            uintptr_t size_bits = PAGE_BITS + VPN_BITS * (LEVELS - 1 - level);
+            paddr_t pa = ppn_to_pa(pte_ppn(pte)) + (va & ((1UL << size_bits) - 1));
             return (void *)pa;
         }
 
@@ -140,8 +470,94 @@ void *as_translate(const address_space_t *as, vaddr_t va, uint64_t required_flag
     return NULL;
 }
 
-/* 递归复制页表 */
-static pte_t *clone_page_table(const pte_t *src, int level) {
+void *as_translate(address_space_t *as, vaddr_t va, uint64_t required_flags) {
+    void *pa = translate_mapped(as, va, required_flags);
+    if (pa) return pa;
+
+    /* 可能是尚未调入的懒加载页 */
+    uint64_t access = required_flags & (PTE_R | PTE_W | PTE_X);
+    if (populate_page(as, va_vpn(va), access) != 0) return NULL;
+    return translate_mapped(as, va, required_flags);
+}
+
+/* ============================================================================
+ * 内核访问用户缓冲区
+ *
+ * 按需调页后相邻的虚拟页不再物理连续，COW 也是逐页进行的，
+ * 因此一律按页翻译：每一页都单独调入、单独完成写时复制。
+ * ========================================================================== */
+
+void *as_translate_span(address_space_t *as, vaddr_t va, size_t len, uint64_t required_flags,
+                        size_t *span) {
+    size_t room = PAGE_SIZE - (va & PAGE_MASK);
+    *span = len < room ? len : room;
+    return as_translate(as, va, required_flags);
+}
+
+int as_copy_from_user(address_space_t *as, void *dst, vaddr_t src, size_t len) {
+    uint8_t *out = dst;
+    while (len > 0) {
+        size_t n;
+        const uint8_t *k = as_translate_span(as, src, len, PTE_R | PTE_V, &n);
+        if (!k) return -1;
+        memcpy(out, k, n);
+        out += n;
+        src += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int as_copy_to_user(address_space_t *as, vaddr_t dst, const void *src, size_t len) {
+    const uint8_t *in = src;
+    while (len > 0) {
+        size_t n;
+        uint8_t *k = as_translate_span(as, dst, len, PTE_W | PTE_V, &n);
+        if (!k) return -1;
+        memcpy(k, in, n);
+        in += n;
+        dst += n;
+        len -= n;
+    }
+    return 0;
+}
+
+long as_copy_str_from_user(address_space_t *as, char *dst, vaddr_t src, size_t max) {
+    size_t copied = 0;
+    while (copied < max) {
+        size_t n;
+        const char *k = as_translate_span(as, src + copied, max - copied, PTE_R | PTE_V, &n);
+        if (!k) return -1;
+        for (size_t i = 0; i < n; i++) {
+            dst[copied + i] = k[i];
+            if (k[i] == '\0') return (long)(copied + i);
+        }
+        copied += n;
+    }
+    return -1;  /* 超长 */
+}
+
+/**
+ * 把第 level 级的大页叶子拆成下一级的 512 个叶子（权限不变）
+ */
+static int split_leaf(pte_t *pte, int level) {
+    pte_t *table = alloc_page();
+    if (!table) return -1;
+
+    uintptr_t ppn = pte_ppn(*pte);
+    uint64_t flags = pte_flags(*pte);
+    uintptr_t step = 1UL << (VPN_BITS * (LEVELS - 2 - level));
+    for (int i = 0; i < PTE_PER_PAGE; i++) {
+        table[i] = make_pte(ppn + i * step, flags);
+    }
+    *pte = make_pte(pa_ppn((paddr_t)table), PTE_V);
+    return 0;
+}
+
+static void free_page_table(pte_t *pt, int level, const pte_t *kernel_root);
+
+/* 递归复制页表，用户页以写时复制方式共享；失败时返回 NULL，且不留下任何分配或引用 */
+static pte_t *clone_page_table(pte_t *src, int level, const pte_t *kernel_root) {
     pte_t *dst = alloc_page();
     if (!dst) return NULL;
 
@@ -152,17 +568,42 @@ static pte_t *clone_page_table(const pte_t *src, int level) {
             continue;
         }
 
+        /* 与内核共享的根页表项：直接链接 */
+        if (level == 0 && kernel_root && pte == kernel_root[i]) {
+            dst[i] = pte;
+            continue;
+        }
+
+        /* 用户大页按 4K 粒度做写时复制：先在源页表中逐级拆分 */
+        if (pte_is_leaf(pte) && (pte & PTE_U) && level < LEVELS - 1) {
+            if (split_leaf(&src[i], level) != 0) goto fail;
+            pte = src[i];
+        }
+
         if (pte_is_leaf(pte)) {
             /* 叶子节点：复制数据页 */
             uint64_t flags = pte_flags(pte);
 
-            /* 只复制用户页（有 U 标志的页） */
+            /* 只处理用户页（有 U 标志的页） */
             if (flags & PTE_U) {
                 uint8_t *src_page = (uint8_t *)ppn_to_pa(pte_ppn(pte));
-                uint8_t *dst_page = alloc_page();
-                if (!dst_page) return NULL;
-                memcpy(dst_page, src_page, PAGE_SIZE);
-                dst[i] = make_pte(pa_ppn((paddr_t)dst_page), flags);
+                if (src_page == g_zero_page) {
+                    /* 零页本身只读共享，无需计数 */
+                    dst[i] = pte;
+                } else if (page_share(src_page)) {
+                    /* 共享物理页，可写页双方都改为只读 + COW */
+                    if (flags & (PTE_W | PTE_COW)) {
+                        flags = (flags & ~PTE_W) | PTE_COW;
+                        src[i] = make_pte(pte_ppn(pte), flags);
+                    }
+                    dst[i] = make_pte(pte_ppn(pte), flags);
+                } else {
+                    /* 不在堆中的页无法计数，退回立即复制 */
+                    uint8_t *dst_page = alloc_page();
+                    if (!dst_page) goto fail;
+                    memcpy(dst_page, src_page, PAGE_SIZE);
+                    dst[i] = make_pte(pa_ppn((paddr_t)dst_page), flags);
+                }
             } else {
                 /* 内核页：共享 (保持同样的 PPN) */
                 dst[i] = pte;
@@ -171,25 +612,314 @@ static pte_t *clone_page_table(const pte_t *src, int level) {
             /* 非叶子节点：递归复制子页表 */
             if (level < LEVELS - 1) {
                 pte_t *child_src = (pte_t *)ppn_to_pa(pte_ppn(pte));
-                pte_t *child_dst = clone_page_table(child_src, level + 1);
-                if (!child_dst) return NULL;
+                pte_t *child_dst = clone_page_table(child_src, level + 1, NULL);
+                if (!child_dst) goto fail;
                 dst[i] = make_pte(pa_ppn((paddr_t)child_dst), pte_flags(pte));
             }
         }
     }
 
     return dst;
+
+fail:
+    /* 撤销已复制的部分：释放子页表与立即复制的页，放回已取得的共享引用。
+     * 未填写的表项仍为 0（alloc_page 已清零），失败的子树已自行撤销 */
+    free_page_table(dst, level, kernel_root);
+    return NULL;
 }
 
-address_space_t *as_clone(const address_space_t *src) {
-    address_space_t *dst = heap_alloc(sizeof(address_space_t), 8);
+address_space_t *as_clone(address_space_t *src) {
+    address_space_t *dst = kmem_cache_alloc(&g_as_cache);
     if (!dst) return NULL;
 
-    dst->root = clone_page_table(src->root, 0);
+    dst->root = clone_page_table(src->root, 0, src->kernel_root);
+
+    /* 父进程的可写页已降为只读 COW，旧 TLB 条目必须作废。失败时部分页也已降级，
+     * 但共享引用都已放回，首次写入时 cow_break 发现独占，直接恢复写权限 */
+    as_flush_all(src);
+
     if (!dst->root) {
-        heap_free(dst, sizeof(address_space_t));
+        kmem_cache_free(&g_as_cache, dst);
         return NULL;
     }
 
+    dst->kernel_root = src->kernel_root;
+    dst->asid = 0;
+
+    /* 复制区域描述（倒序插入后顺序相反，不影响查找） */
+    dst->areas = NULL;
+    for (vm_area_t *a = src->areas; a; a = a->next) {
+        if (add_area(dst, a->vpn_start, a->vpn_end, a->flags, a->file,
+                     a->file_va, a->file_offset, a->file_len) != 0) {
+            /* 缺了区域描述的子进程会在首次调页时出错，整体失败 */
+            as_destroy(dst);
+            return NULL;
+        }
+    }
+
     return dst;
 }
+
+/* ============================================================================
+ * 地址空间销毁
+ *
+ * 只回收本地址空间拥有的东西：与内核共享的根页表项、共享零页、
+ * 不在堆中的外部页（内核、MMIO）都跳过；COW 共享页只减少引用计数，
+ * 最后一个持有者才真正释放。
+ * ========================================================================== */
+
+/* 放弃一个用户页 */
+static void page_release(void *page) {
+    if (page == g_zero_page) return;
+
+    uint16_t *ref = heap_page_ref(page);
+    if (!ref) return;
+    if (*ref > 0) {
+        (*ref)--;
+    } else {
+        heap_free(page, PAGE_SIZE);
+    }
+}
+
+static void free_page_table(pte_t *pt, int level, const pte_t *kernel_root) {
+    for (int i = 0; i < PTE_PER_PAGE; i++) {
+        pte_t pte = pt[i];
+        if (!pte_valid(pte)) continue;
+
+        /* 与内核共享的根页表项：不属于本地址空间 */
+        if (level == 0 && kernel_root && pte == kernel_root[i]) continue;
+
+        if (!pte_is_leaf(pte)) {
+            free_page_table((pte_t *)ppn_to_pa(pte_ppn(pte)), level + 1, kernel_root);
+        } else if (pte & PTE_U) {
+            /* 大页逐个 4K 页释放（分配与 COW 计数都按页） */
+            size_t pages = 1UL << (VPN_BITS * (LEVELS - 1 - level));
+            uint8_t *base = (uint8_t *)ppn_to_pa(pte_ppn(pte));
+            for (size_t j = 0; j < pages; j++) {
+                page_release(base + j * PAGE_SIZE);
+            }
+        }
+    }
+    heap_free(pt, PAGE_SIZE);
+}
+
+void as_destroy(address_space_t *as) {
+    if (!as) return;
+
+    if (as->root) {
+        free_page_table(as->root, 0, as->kernel_root);
+    }
+
+    vm_area_t *a = as->areas;
+    while (a) {
+        vm_area_t *next = a->next;
+        vm_file_put(a->file);
+        kmem_cache_free(&g_area_cache, a);
+        a = next;
+    }
+
+    /* 结构体可能被复用给新的地址空间，不能让它继承"上次激活"的身份 */
+    if (g_asid_last == as) g_asid_last = NULL;
+
+    kmem_cache_free(&g_as_cache, as);
+}
+
+/* ============================================================================
+ * 用户映射管理 (mmap / munmap / mprotect)
+ *
+ * 区域按页号切分时只需改 vpn 范围：文件数据位置用绝对的 file_va 描述，
+ * 切出的两半仍能各自算出本页的文件范围。
+ * ========================================================================== */
+
+typedef void (*pte_visit_t)(pte_t *pte, uint64_t arg);
+
+/* 对 [vs, ve) 内已映射的用户页逐个调用 fn；途中的用户大页先拆成 4K 页 */
+static int visit_user_ptes(address_space_t *as, pte_t *pt, int level, uintptr_t base,
+                           uintptr_t vs, uintptr_t ve, pte_visit_t fn, uint64_t arg) {
+    uintptr_t span = 1UL << (VPN_BITS * (LEVELS - 1 - level));
+
+    for (int i = 0; i < PTE_PER_PAGE; i++) {
+        uintptr_t lo = base + i * span;
+        if (lo + span <= vs || lo >= ve) continue;
+
+        pte_t *pte = &pt[i];
+        if (!pte_valid(*pte)) continue;
+        if (level == 0 && as->kernel_root && *pte == as->kernel_root[i]) continue;
+
+        if (pte_is_leaf(*pte)) {
+            if (!(*pte & PTE_U)) continue;
+            if (level == LEVELS - 1) {
+                fn(pte, arg);
+                continue;
+            }
+            if (split_leaf(pte, level) != 0) return -1;
+        }
+        if (visit_user_ptes(as, (pte_t *)ppn_to_pa(pte_ppn(*pte)), level + 1, lo,
+                            vs, ve, fn, arg) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void unmap_pte(pte_t *pte, uint64_t arg) {
+    (void)arg;
+    page_release((void *)ppn_to_pa(pte_ppn(*pte)));
+    *pte = 0;
+}
+
+static void protect_pte(pte_t *pte, uint64_t flags) {
+    uint8_t *page = (uint8_t *)ppn_to_pa(pte_ppn(*pte));
+    uint64_t keep = pte_flags(*pte) & (PTE_V | PTE_U | PTE_G | PTE_A | PTE_D);
+    uint64_t f = keep | (flags & (PTE_R | PTE_W | PTE_X));
+
+    /* 仍被共享的页（零页或 COW 引用未归零）不能直接可写，留到写时复制 */
+    if (f & PTE_W) {
+        uint16_t *ref = heap_page_ref(page);
+        if (page == g_zero_page || (ref && *ref > 0)) {
+            f = (f & ~PTE_W) | PTE_COW;
+        }
+    }
+    *pte = make_pte(pte_ppn(*pte), f);
+}
+
+/* 把区域在 vpn 处一分为二（vpn 须严格位于区域内部） */
+static int split_area(vm_area_t *a, uintptr_t vpn) {
+    vm_area_t *tail = kmem_cache_alloc(&g_area_cache);
+    if (!tail) return -1;
+
+    *tail = *a;
+    tail->vpn_start = vpn;
+    a->vpn_end = vpn;
+    vm_file_get(tail->file);
+
+    tail->next = a->next;
+    a->next = tail;
+    return 0;
+}
+
+/* 在 vs 和 ve 处切开所有跨越边界的区域，使每个区域要么在范围内，要么在范围外 */
+static int split_areas_at(address_space_t *as, uintptr_t vs, uintptr_t ve) {
+    for (vm_area_t *a = as->areas; a; a = a->next) {
+        if (a->vpn_start < vs && vs < a->vpn_end) {
+            if (split_area(a, vs) != 0) return -1;
+            continue;   /* 后半部分紧跟其后，下一轮处理 */
+        }
+        if (a->vpn_start < ve && ve < a->vpn_end) {
+            if (split_area(a, ve) != 0) return -1;
+        }
+    }
+    return 0;
+}
+
+/* 用户可用的虚拟页号范围：低于内核共享的根页表项、不触碰高半区 */
+static bool user_range_ok(const address_space_t *as, uintptr_t vs, uintptr_t ve) {
+    if (vs >= ve || ve > va_vpn(MMAP_USER_END)) return false;
+    if (!as->kernel_root) return true;
+
+    uintptr_t shift = VPN_BITS * (LEVELS - 1);
+    for (uintptr_t i = vs >> shift; i <= (ve - 1) >> shift; i++) {
+        if (as->kernel_root[i] && as->root[i] == as->kernel_root[i]) return false;
+    }
+    return true;
+}
+
+static bool range_free(const address_space_t *as, uintptr_t vs, uintptr_t ve) {
+    for (const vm_area_t *a = as->areas; a; a = a->next) {
+        if (a->vpn_start < ve && vs < a->vpn_end) return false;
+    }
+    return true;
+}
+
+/* [vs, ve) 是否完全被区域覆盖 */
+static bool range_covered(const address_space_t *as, uintptr_t vs, uintptr_t ve) {
+    uintptr_t cursor = vs;
+    while (cursor < ve) {
+        uintptr_t next = cursor;
+        for (const vm_area_t *a = as->areas; a; a = a->next) {
+            if (a->vpn_start <= cursor && cursor < a->vpn_end && a->vpn_end > next) {
+                next = a->vpn_end;
+            }
+        }
+        if (next == cursor) return false;
+        cursor = next;
+    }
+    return true;
+}
+
+/* 在 mmap 区域中首次适配一段 pages 页的空闲范围，失败返回 0 */
+static uintptr_t find_free(const address_space_t *as, size_t pages) {
+    uintptr_t cand = va_vpn(MMAP_BASE);
+    uintptr_t limit = va_vpn(MMAP_END);
+
+    while (cand + pages <= limit) {
+        uintptr_t bump = cand;
+        for (const vm_area_t *a = as->areas; a; a = a->next) {
+            if (a->vpn_start < cand + pages && cand < a->vpn_end && a->vpn_end > bump) {
+                bump = a->vpn_end;
+            }
+        }
+        if (bump == cand) return cand;
+        cand = bump;
+    }
+    return 0;
+}
+
+int as_unmap(address_space_t *as, uintptr_t vpn_start, uintptr_t vpn_end) {
+    if (!user_range_ok(as, vpn_start, vpn_end)) return -1;
+    if (split_areas_at(as, vpn_start, vpn_end) != 0) return -1;
+
+    vm_area_t **link = &as->areas;
+    while (*link) {
+        vm_area_t *a = *link;
+        if (a->vpn_start >= vpn_start && a->vpn_end <= vpn_end) {
+            *link = a->next;
+            vm_file_put(a->file);
+            kmem_cache_free(&g_area_cache, a);
+        } else {
+            link = &a->next;
+        }
+    }
+
+    int ret = visit_user_ptes(as, as->root, 0, 0, vpn_start, vpn_end, unmap_pte, 0);
+    as_flush_all(as);
+    return ret;
+}
+
+int as_protect(address_space_t *as, uintptr_t vpn_start, uintptr_t vpn_end, uint64_t flags) {
+    if (!(flags & (PTE_R | PTE_W | PTE_X))) return -1;
+    if (!user_range_ok(as, vpn_start, vpn_end)) return -1;
+    if (!range_covered(as, vpn_start, vpn_end)) return -1;
+    if (split_areas_at(as, vpn_start, vpn_end) != 0) return -1;
+
+    for (vm_area_t *a = as->areas; a; a = a->next) {
+        if (a->vpn_start >= vpn_start && a->vpn_end <= vpn_end) {
+            a->flags = flags | PTE_V;
+        }
+    }
+
+    int ret = visit_user_ptes(as, as->root, 0, 0, vpn_start, vpn_end, protect_pte, flags);
+    as_flush_all(as);
+    return ret;
+}
+
+vaddr_t as_mmap(address_space_t *as, vaddr_t va, size_t len, uint64_t flags,
+                bool fixed, vm_file_t *file, size_t file_offset) {
+    if (len == 0 || len > MMAP_USER_END || (va & PAGE_MASK)) return 0;
+
+    size_t pages = (len + PAGE_SIZE - 1) / PAGE_SIZE;
+    uintptr_t vs, ve;
+    bool hint_ok = va && user_vpn_range(va, len, &vs, &ve);
+
+    if (fixed) {
+        if (!hint_ok || as_unmap(as, vs, ve) != 0) return 0;
+    } else if (!hint_ok || !user_range_ok(as, vs, ve) || !range_free(as, vs, ve)) {
+        /* 提示地址不可用时自行挑选 */
+        vs = find_free(as, pages);
+        if (!vs) return 0;
+    }
+
+    vaddr_t start = vpn_to_va(vs);
+    if (add_area(as, vs, vs + pages, flags, file, start, file_offset, len) != 0) return 0;
+    return start;
+}
@@ -7,16 +7,55 @@
 #define ADDRESS_SPACE_H
 
 #include "sv39.h"
+#include <stdbool.h>
 #include <stddef.h>
 
 /* ============================================================================
  * 地址空间结构
  * ========================================================================== */
 
+/**
+ * 懒加载页的后备文件
+ *
+ * 由具体文件系统（或内存镜像）实现 read/release，按引用计数共享：
+ * 每个引用它的 VMA 持有一个引用，最后一个引用释放时调用 release。
+ */
+typedef struct vm_file {
+    size_t (*read)(struct vm_file *file, size_t offset, void *buf, size_t len);
+    void (*release)(struct vm_file *file);
+    uint32_t refcount;
+} vm_file_t;
+
+/**
+ * 虚拟内存区域 (VMA)
+ *
+ * 描述一段按需调页的用户地址范围。首次访问某页时分配物理页：
+ * 与 [file_va, file_va + file_len) 重叠的部分从文件读入，其余清零；
+ * 匿名页（不含文件数据）在首次读时映射共享零页，写时才真正分配。
+ */
+typedef struct vm_area {
+    uintptr_t vpn_start;
+    uintptr_t vpn_end;          /* 不包含 */
+    uint64_t flags;             /* 页表项标志 */
+    vm_file_t *file;            /* NULL 表示匿名映射 */
+    vaddr_t file_va;            /* 文件数据起始虚拟地址 */
+    size_t file_offset;         /* 对应的文件偏移 */
+    size_t file_len;            /* 文件数据长度 */
+    struct vm_area *next;
+} vm_area_t;
+
 typedef struct {
     pte_t *root;                /* 根页表指针 (物理地址 = 虚拟地址) */
+    vm_area_t *areas;           /* 懒加载区域链表 */
+    const pte_t *kernel_root;   /* 共享内核映射的来源根页表，NULL 表示无 */
+    uint64_t asid;              /* (代号 << 16) | ASID，0 表示尚未分配 */
 } address_space_t;
 
+/* mmap 自动选址的范围：位于用户程序（低地址）与用户栈（1 << 38 以下）之间 */
+#define MMAP_BASE       0x100000000UL           /* 4 GiB */
+#define MMAP_END        (1UL << 37)             /* 128 GiB */
+#define MMAP_USER_END   (1UL << 38)             /* 用户虚拟地址上界 */
+
 /* ============================================================================
  * API
  * ========================================================================== */
@@ -28,6 +67,9 @@ address_space_t *as_create(void);
 
 /**
  * 销毁地址空间
+ *
+ * 释放页表页、本地址空间独占的用户页和所有区域描述；
+ * 与其他地址空间共享的 COW 页只减少引用计数。调用时该地址空间不能处于激活状态。
  */
 void as_destroy(address_space_t *as);
 
@@ -41,9 +83,27 @@ uintptr_t as_root_ppn(const address_space_t *as);
  */
 pte_t *as_root(const address_space_t *as);
 
+/**
+ * 探测硬件支持的 ASID 位数
+ *
+ * 在开启分页（内核地址空间使用 ASID 0）之后调用一次。
+ * 硬件不支持 ASID 时退化为切换地址空间时整体刷新 TLB。
+ */
+void asid_init(void);
+
+/**
+ * 取得运行该地址空间所需的 satp，进入用户态前调用
+ *
+ * 按需分配 ASID：ASID 用尽时进入新一代并整体刷新 TLB，
+ * 上一代的地址空间在下次激活时重新分配。
+ */
+uint64_t as_activate(address_space_t *as);
+
 /**
  * 映射已存在的物理页 (不分配)
  *
+ * VPN 与 PPN 同时按 2 MiB / 1 GiB 对齐且范围足够时自动使用大页叶子。
+ *
  * @param as        地址空间
  * @param vpn_start 起始虚拟页号
  * @param vpn_end   结束虚拟页号 (不包含)
@@ -54,9 +114,21 @@ void as_map_extern(address_space_t *as,
                    uintptr_t vpn_start, uintptr_t vpn_end,
                    uintptr_t ppn_base, uint64_t flags);
 
+/**
+ * 共享内核映射
+ *
+ * 把 kernel 根页表中覆盖 [va_start, va_end) 的表项直接复制到 dst，
+ * 两者共用下级页表，因此建立映射的开销与内核大小无关。
+ * 这些根页表项覆盖的范围（每项 1 GiB）之后不应再在 dst 中建立用户映射。
+ */
+void as_share_kernel(address_space_t *dst, const address_space_t *kernel,
+                     vaddr_t va_start, vaddr_t va_end);
+
 /**
  * 分配物理页并映射，拷贝数据
  *
+ * 范围不小于 2 MiB 且起点对齐时，物理页按 2 MiB 对齐分配以便使用大页。
+ *
  * @param as        地址空间
  * @param vpn_start 起始虚拟页号
  * @param vpn_end   结束虚拟页号 (不包含)
@@ -70,22 +142,170 @@ void as_map(address_space_t *as,
             const void *data, size_t len, size_t offset,
             uint64_t flags);
 
+/**
+ * 建立匿名懒分配映射（不立即分配物理页）
+ *
+ * @return 0 成功，-1 失败
+ */
+int as_map_anon(address_space_t *as,
+                uintptr_t vpn_start, uintptr_t vpn_end,
+                uint64_t flags);
+
+/**
+ * 建立文件后备的懒加载映射
+ *
+ * 区域持有 file 的一个引用。
+ *
+ * @param file_va     文件数据起始虚拟地址（可不按页对齐）
+ * @param file_offset 文件偏移
+ * @param file_len    文件数据长度，区域内超出部分清零
+ * @return 0 成功，-1 失败
+ */
+int as_map_file(address_space_t *as,
+                uintptr_t vpn_start, uintptr_t vpn_end,
+                uint64_t flags, vm_file_t *file,
+                vaddr_t file_va, size_t file_offset, size_t file_len);
+
+/**
+ * 建立用户请求的懒加载映射 (mmap)
+ *
+ * 不指定 fixed 时 va 只是提示，不可用则在 [MMAP_BASE, MMAP_END) 中首次适配；
+ * 指定 fixed 时使用 va，并先解除该范围内原有的映射。
+ *
+ * @param len         映射长度（向上取整到页）
+ * @param flags       页表项标志
+ * @param file        后备文件，NULL 表示匿名映射；区域持有它的一个引用
+ * @param file_offset 文件偏移（须页对齐）
+ * @return 映射起始地址，失败返回 0
+ */
+vaddr_t as_mmap(address_space_t *as, vaddr_t va, size_t len, uint64_t flags,
+                bool fixed, vm_file_t *file, size_t file_offset);
+
+/**
+ * 解除 [vpn_start, vpn_end) 内的映射 (munmap)
+ *
+ * 跨越边界的区域被切开；已调入的页按引用计数释放。范围内无映射也算成功。
+ *
+ * @return 0 成功，-1 范围非法
+ */
+int as_unmap(address_space_t *as, uintptr_t vpn_start, uintptr_t vpn_end);
+
+/**
+ * 修改 [vpn_start, vpn_end) 的访问权限 (mprotect)
+ *
+ * 范围必须完全被已有映射覆盖；flags 至少包含 R/W/X 之一。
+ * 仍在共享的页加写权限时先标为 COW，首次写入时再复制。
+ *
+ * @return 0 成功，-1 失败
+ */
+int as_protect(address_space_t *as, uintptr_t vpn_start, uintptr_t vpn_end, uint64_t flags);
+
+/**
+ * 把用户给出的 [va, va + len) 转换为页号范围
+ *
+ * va 须页对齐，len 向上取整到页；范围为空或超出用户地址空间时返回 false。
+ */
+static inline bool user_vpn_range(vaddr_t va, size_t len, uintptr_t *vpn_start, uintptr_t *vpn_end) {
+    if (len == 0 || (va & PAGE_MASK)) return false;
+    if (va >= MMAP_USER_END || len > MMAP_USER_END - va) return false;
+    *vpn_start = va_vpn(va);
+    *vpn_end = va_vpn(va + len + PAGE_SIZE - 1);
+    return true;
+}
+
 /**
  * 地址翻译：检查权限并返回物理地址
  *
+ * 目标页尚未调入时按 VMA 调入；要求 PTE_W 而页为 COW 时先完成复制。
+ *
  * @param as             地址空间
  * @param va             虚拟地址
  * @param required_flags 要求的权限标志
  * @return 物理地址指针，失败返回 NULL
  */
-void *as_translate(const address_space_t *as, vaddr_t va, uint64_t required_flags);
+void *as_translate(address_space_t *as, vaddr_t va, uint64_t required_flags);
+
+/**
+ * 翻译用户缓冲区 [va, va + len) 中不跨页的第一段
+ *
+ * 相邻虚拟页不保证物理连续，内核直接访问用户缓冲区时须逐段调用：
+ * 返回的指针只在 *span 字节内有效（*span = min(len, 到页尾的字节数)）。
+ *
+ * @return 物理地址指针，失败返回 NULL
+ */
+void *as_translate_span(address_space_t *as, vaddr_t va, size_t len, uint64_t required_flags,
+                        size_t *span);
+
+/**
+ * 在内核缓冲区与用户缓冲区之间复制，逐页翻译、调入并完成写时复制
+ *
+ * @return 成功返回 0，任一页不可访问返回 -1（此前的页可能已复制）
+ */
+int as_copy_from_user(address_space_t *as, void *dst, vaddr_t src, size_t len);
+int as_copy_to_user(address_space_t *as, vaddr_t dst, const void *src, size_t len);
+
+/**
+ * 从用户空间复制以 '\0' 结尾的字符串，最多 max 字节（含结尾的 '\0'）
+ *
+ * @return 字符串长度，不可访问或超长返回 -1
+ */
+long as_copy_str_from_user(address_space_t *as, char *dst, vaddr_t src, size_t max);
 
 /**
  * 复制地址空间（用于 fork）
  *
+ * 用户页采用写时复制：父子共享物理页，可写页在双方都被改为只读并标记
+ * PTE_COW，首次写入时由 as_handle_fault 复制。因此 src 的页表也会被修改，
+ * 调用者需保证 src 再次运行前刷新 TLB（切换 satp 时的 sfence.vma 即可）。
+ *
  * @param src 源地址空间
  * @return 新的地址空间，失败返回 NULL
  */
-address_space_t *as_clone(const address_space_t *src);
+address_space_t *as_clone(address_space_t *src);
+
+/**
+ * 处理用户态缺页异常
+ *
+ * - 页未映射：若落在 VMA 内且权限允许，调入该页
+ * - 写 COW 页：复制（或在独占时直接恢复写权限）
+ *
+ * 处理成功返回 0，调用者应重新执行触发异常的指令。
+ *
+ * @param as     地址空间
+ * @param va     触发异常的虚拟地址 (stval)
+ * @param access 访问类型 (PTE_R / PTE_W / PTE_X)
+ * @return 0 表示已处理，-1 表示非法访问
+ */
+int as_handle_fault(address_space_t *as, vaddr_t va, uint64_t access);
+
+/**
+ * 把缺页异常码转换为访问类型
+ *
+ * @param code scause 异常码
+ * @return PTE_X / PTE_R / PTE_W，非缺页异常返回 0
+ */
+uint64_t as_fault_access(uintptr_t code);
+
+/* ============================================================================
+ * 后备文件
+ * ========================================================================== */
+
+/**
+ * 初始化后备文件（引用计数置 1）
+ */
+void vm_file_init(vm_file_t *file,
+                  size_t (*read)(vm_file_t *file, size_t offset, void *buf, size_t len),
+                  void (*release)(vm_file_t *file));
+
+/**
+ * 以一段常驻内存（如内核内嵌的应用镜像）作为后备文件
+ *
+ * @return 新的后备文件（引用计数 1），失败返回 NULL
+ */
+vm_file_t *vm_file_from_memory(const void *data, size_t len);
+
+/* 增加 / 释放引用 */
+void vm_file_get(vm_file_t *file);
+void vm_file_put(vm_file_t *file);
 
 #endif /* ADDRESS_SPACE_H */
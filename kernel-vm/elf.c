@@ -37,6 +37,15 @@ uintptr_t elf_check(const uint8_t *data, size_t len) {
     return ehdr->e_entry;
 }
 
+/* 根据段标志构建页表项标志 */
+static uint64_t segment_flags(const elf64_phdr_t *phdr) {
+    uint64_t flags = PTE_V | PTE_U;
+    if (phdr->p_flags & PF_R) flags |= PTE_R;
+    if (phdr->p_flags & PF_W) flags |= PTE_W;
+    if (phdr->p_flags & PF_X) flags |= PTE_X;
+    return flags;
+}
+
 uintptr_t elf_load(address_space_t *as, const uint8_t *data, size_t len) {
     uintptr_t entry = elf_check(data, len);
     if (!entry) {
@@ -64,10 +73,7 @@ uintptr_t elf_load(address_space_t *as, const uint8_t *data, size_t len) {
         uintptr_t vpn_end = (va_vpn(end_mem - 1)) + 1; /* ceil */
 
         /* 构建标志 */
-        uint64_t flags = PTE_V | PTE_U;
-        if (phdr->p_flags & PF_R) flags |= PTE_R;
-        if (phdr->p_flags & PF_W) flags |= PTE_W;
-        if (phdr->p_flags & PF_X) flags |= PTE_X;
+        uint64_t flags = segment_flags(phdr);
 
         /* 映射并拷贝数据 */
         size_t offset = off_mem & PAGE_MASK;
@@ -77,3 +83,38 @@ uintptr_t elf_load(address_space_t *as, const uint8_t *data, size_t len) {
 
     return entry;
 }
+
+uintptr_t elf_load_lazy(address_space_t *as, vm_file_t *file) {
+    elf64_ehdr_t ehdr;
+    if (file->read(file, 0, &ehdr, sizeof(ehdr)) != sizeof(ehdr)) {
+        return 0;
+    }
+
+    uintptr_t entry = elf_check((const uint8_t *)&ehdr, sizeof(ehdr));
+    if (!entry) {
+        return 0;
+    }
+
+    for (int i = 0; i < ehdr.e_phnum; i++) {
+        elf64_phdr_t phdr;
+        size_t off = ehdr.e_phoff + (size_t)i * sizeof(elf64_phdr_t);
+        if (file->read(file, off, &phdr, sizeof(phdr)) != sizeof(phdr)) {
+            return 0;
+        }
+
+        /* 只加载 PT_LOAD 段 */
+        if (phdr.p_type != PT_LOAD || phdr.p_memsz == 0) {
+            continue;
+        }
+
+        uintptr_t vpn_start = va_vpn(phdr.p_vaddr);
+        uintptr_t vpn_end = va_vpn(phdr.p_vaddr + phdr.p_memsz - 1) + 1;
+
+        if (as_map_file(as, vpn_start, vpn_end, segment_flags(&phdr), file,
+                        phdr.p_vaddr, phdr.p_offset, phdr.p_filesz) != 0) {
+            return 0;
+        }
+    }
+
+    return entry;
+}
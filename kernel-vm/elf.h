@@ -75,4 +75,17 @@ uintptr_t elf_check(const uint8_t *data, size_t len);
  */
 uintptr_t elf_load(address_space_t *as, const uint8_t *data, size_t len);
 
+/**
+ * 以懒加载方式把 ELF 映射到地址空间
+ *
+ * 只读取文件头和程序头，每个 PT_LOAD 段登记为一个文件后备的 VMA，
+ * 段内的页在首次访问时才从 file 读入（.bss 等超出 p_filesz 的部分清零）。
+ * 各 VMA 各自持有 file 的引用，调用者仍需释放自己的引用。
+ *
+ * @param as   目标地址空间
+ * @param file ELF 文件
+ * @return 成功返回入口地址，失败返回 0
+ */
+uintptr_t elf_load_lazy(address_space_t *as, vm_file_t *file);
+
 #endif /* ELF_H */
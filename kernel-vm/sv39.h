@@ -77,6 +77,7 @@ static inline uintptr_t va_offset(vaddr_t va) {
 #define PTE_A       (1UL << 6)          /* Accessed */
 #define PTE_D       (1UL << 7)          /* Dirty */
 #define PTE_RSW     (3UL << 8)          /* Reserved for software */
+#define PTE_COW     (1UL << 8)          /* 软件位：写时复制页 */
 
 /* 从 PTE 提取 PPN */
 static inline uintptr_t pte_ppn(pte_t pte) {
@@ -107,16 +108,41 @@ static inline int pte_is_leaf(pte_t pte) {
  * ========================================================================== */
 
 #define SATP_MODE_SV39  (8UL << 60)
+#define SATP_ASID_SHIFT 44
+#define SATP_ASID_MASK  (0xFFFFUL << SATP_ASID_SHIFT)
 
-static inline uint64_t make_satp(uintptr_t root_ppn) {
-    return SATP_MODE_SV39 | root_ppn;
+static inline uint64_t make_satp(uintptr_t root_ppn, uint16_t asid) {
+    return SATP_MODE_SV39 | ((uint64_t)asid << SATP_ASID_SHIFT) | root_ppn;
 }
 
+/* 切换 satp 并刷新全部 TLB（仅用于启动时开启分页） */
 static inline void write_satp(uint64_t satp) {
     asm volatile("csrw satp, %0" :: "r"(satp));
     asm volatile("sfence.vma");
 }
 
+/* ============================================================================
+ * TLB 刷新
+ *
+ * 用户地址空间带 ASID，切换 satp 时不再整体刷新，
+ * 修改页表后只需按 ASID / 地址精确刷新。
+ * ========================================================================== */
+
+/* 刷新所有 ASID 的全部条目（含全局映射） */
+static inline void sfence_vma_all(void) {
+    asm volatile("sfence.vma" ::: "memory");
+}
+
+/* 刷新某个 ASID 的全部非全局条目 */
+static inline void sfence_vma_asid(uint16_t asid) {
+    asm volatile("sfence.vma zero, %0" :: "r"((uint64_t)asid) : "memory");
+}
+
+/* 刷新某个 ASID 中单个虚拟地址的条目 */
+static inline void sfence_vma_page(vaddr_t va, uint16_t asid) {
+    asm volatile("sfence.vma %0, %1" :: "r"(va), "r"((uint64_t)asid) : "memory");
+}
+
 static inline uint64_t read_satp(void) {
     uint64_t val;
     asm volatile("csrr %0, satp" : "=r"(val));
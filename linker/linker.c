@@ -2,6 +2,8 @@
  * 链接器辅助实现
  */
 #include "linker.h"
+#include "../util/riscv.h"
+#include <string.h>
 
 /* 汇编函数，避免 GOT 访问 */
 extern const app_meta_t *asm_get_apps(void);
@@ -12,7 +14,7 @@ const app_meta_t *apps_meta(void) {
 }
 
 app_iter_t apps_iter(const app_meta_t *meta) {
-    return (app_iter_t){.meta = meta, .index = 0};
+    return (app_iter_t){.meta = meta, .index = 0, .load_time = 0};
 }
 
 const uint8_t *apps_next(app_iter_t *iter, size_t *size) {
@@ -22,29 +24,23 @@ const uint8_t *apps_next(app_iter_t *iter, size_t *size) {
 
     uint64_t i = iter->index++;
     const uintptr_t *addrs = (const uintptr_t *)(&iter->meta->first);
+    const uint64_t *mem_sizes = addrs + iter->meta->count + 1;
 
     uintptr_t start = addrs[i];
     uintptr_t end = addrs[i + 1];
     *size = end - start;
+    iter->load_time = 0;
 
     uintptr_t dest = iter->meta->base + i * iter->meta->step;
     if (dest != 0) {
-        /* 复制到目标地址 */
-        volatile uint8_t *d = (volatile uint8_t *)dest;
-        const uint8_t *s = (const uint8_t *)start;
+        uint64_t t0 = read_time();
+        size_t mem_size = mem_sizes[i] > *size ? mem_sizes[i] : *size;
 
-        for (size_t j = 0; j < *size; j++) {
-            d[j] = s[j];
-        }
-
-        /* 清除指令缓存 */
-        asm volatile("fence.i");
-
-        /* 清零剩余空间 */
-        for (size_t j = *size; j < 0x200000; j++) {
-            d[j] = 0;
-        }
+        /* 复制文件内容，只清零 .bss 部分 */
+        memcpy((void *)dest, (const void *)start, *size);
+        memset((uint8_t *)dest + *size, 0, mem_size - *size);
 
+        iter->load_time = read_time() - t0;
         return (const uint8_t *)dest;
     }
 
@@ -11,7 +11,8 @@
  * 应用程序元数据
  *
  * 由 gen_app_asm.sh 生成，嵌入在内核数据段中。
- * first 之后紧跟 count+1 个地址，分别是各应用的起始和最后一个的结束。
+ * first 之后紧跟 count+1 个地址，分别是各应用的起始和最后一个的结束，
+ * 再紧跟 count 个内存大小（含 .bss，0 表示与文件大小相同）。
  */
 typedef struct {
     uint64_t base;      /* 加载目标基地址 */
@@ -24,6 +25,7 @@ typedef struct {
 typedef struct {
     const app_meta_t *meta;
     uint64_t index;
+    uint64_t load_time;     /* 上一个应用复制与清零耗费的 time 计数 */
 } app_iter_t;
 
 /* 获取应用元数据 */
@@ -32,7 +34,12 @@ const app_meta_t *apps_meta(void);
 /* 创建迭代器 */
 app_iter_t apps_iter(const app_meta_t *meta);
 
-/* 获取下一个应用，返回加载后的地址和大小，NULL 表示结束 */
+/**
+ * 获取下一个应用，返回加载后的地址和大小，NULL 表示结束
+ *
+ * base 非 0 时应用被复制到目标地址，并清零其 .bss。
+ * 不执行 fence.i：调用者加载完一批应用后、跳转执行前统一执行一次。
+ */
 const uint8_t *apps_next(app_iter_t *iter, size_t *size);
 
 /**
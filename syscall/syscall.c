@@ -10,6 +10,7 @@ static const syscall_clock_t *g_clock;
 static const syscall_signal_t *g_signal;
 static const syscall_thread_t *g_thread;
 static const syscall_sync_t *g_sync;
+static const syscall_mm_t *g_mm;
 
 void syscall_set_io(const syscall_io_t *io) {
     g_io = io;
@@ -39,6 +40,10 @@ void syscall_set_sync(const syscall_sync_t *sync) {
     g_sync = sync;
 }
 
+void syscall_set_mm(const syscall_mm_t *mm) {
+    g_mm = mm;
+}
+
 syscall_result_t syscall_dispatch(uintptr_t id, uintptr_t args[6]) {
     syscall_result_t ret = {.status = SYSCALL_OK, .value = 0};
 
@@ -55,6 +60,43 @@ syscall_result_t syscall_dispatch(uintptr_t id, uintptr_t args[6]) {
         }
         break;
 
+    case SYS_SYNC:
+        if (g_io && g_io->sync) {
+            ret.value = g_io->sync();
+        }
+        break;
+
+    case SYS_FSYNC:
+        if (g_io && g_io->fsync) {
+            ret.value = g_io->fsync(args[0]);
+        }
+        break;
+
+    case SYS_MKDIRAT:
+        if (g_io && g_io->mkdirat) {
+            ret.value = g_io->mkdirat(args[0], (const char *)args[1], args[2]);
+        }
+        break;
+
+    case SYS_UNLINKAT:
+        if (g_io && g_io->unlinkat) {
+            ret.value = g_io->unlinkat(args[0], (const char *)args[1], args[2]);
+        }
+        break;
+
+    case SYS_RENAMEAT2:
+        if (g_io && g_io->renameat2) {
+            ret.value = g_io->renameat2(args[0], (const char *)args[1], args[2],
+                                        (const char *)args[3], args[4]);
+        }
+        break;
+
+    case SYS_GETDENTS64:
+        if (g_io && g_io->getdents64) {
+            ret.value = g_io->getdents64(args[0], (void *)args[1], args[2]);
+        }
+        break;
+
     case SYS_READ:
         if (g_io && g_io->read) {
             ret.value = g_io->read(args[0], (void *)args[1], args[2]);
@@ -207,6 +249,31 @@ syscall_result_t syscall_dispatch(uintptr_t id, uintptr_t args[6]) {
         }
         break;
 
+    /* 内存管理 */
+    case SYS_MMAP:
+        if (g_mm && g_mm->mmap) {
+            ret.value = g_mm->mmap(args[0], args[1], args[2], args[3], args[4], args[5]);
+        }
+        break;
+
+    case SYS_MUNMAP:
+        if (g_mm && g_mm->munmap) {
+            ret.value = g_mm->munmap(args[0], args[1]);
+        }
+        break;
+
+    case SYS_MPROTECT:
+        if (g_mm && g_mm->mprotect) {
+            ret.value = g_mm->mprotect(args[0], args[1], args[2]);
+        }
+        break;
+
+    case SYS_MEMINFO:
+        if (g_mm && g_mm->meminfo) {
+            ret.value = g_mm->meminfo((meminfo_t *)args[0]);
+        }
+        break;
+
     default:
         ret.status = SYSCALL_UNSUPPORTED;
         ret.value = id;
@@ -8,8 +8,13 @@
 #include <stdint.h>
 
 /* 系统调用号 */
+#define SYS_MKDIRAT         34
+#define SYS_UNLINKAT        35
 #define SYS_OPEN            56
 #define SYS_CLOSE           57
+#define SYS_GETDENTS64      61
+#define SYS_SYNC            81
+#define SYS_FSYNC           82
 #define SYS_READ            63
 #define SYS_WRITE           64
 #define SYS_EXIT            93
@@ -23,6 +28,7 @@
 #define SYS_FORK            220
 #define SYS_EXEC            221
 #define SYS_WAITPID         260
+#define SYS_RENAMEAT2       276
 
 /* 线程相关 */
 #define SYS_THREAD_CREATE   1000
@@ -40,11 +46,32 @@
 #define SYS_CONDVAR_SIGNAL  1031
 #define SYS_CONDVAR_WAIT    1032
 
+/* 内存管理 */
+#define SYS_MUNMAP          215
+#define SYS_MMAP            222
+#define SYS_MPROTECT        226
+#define SYS_MEMINFO         2000
+
+/* mmap 保护位与标志（与 Linux 一致） */
+#define PROT_NONE           0
+#define PROT_READ           (1 << 0)
+#define PROT_WRITE          (1 << 1)
+#define PROT_EXEC           (1 << 2)
+
+#define MAP_SHARED          0x01
+#define MAP_PRIVATE         0x02
+#define MAP_FIXED           0x10
+#define MAP_ANONYMOUS       0x20
+
 /* 标准文件描述符 */
 #define FD_STDIN    0
 #define FD_STDOUT   1
 #define FD_STDERR   2
 
+/* *at 系列调用：dirfd 为 AT_FDCWD 时相对根目录（没有工作目录） */
+#define AT_FDCWD            (-100)
+#define AT_REMOVEDIR        0x200
+
 /* 时钟类型 */
 #define CLOCK_REALTIME      0
 #define CLOCK_MONOTONIC     1
@@ -55,6 +82,13 @@ typedef struct {
     uintptr_t tv_nsec;
 } timespec_t;
 
+/* 内核堆使用情况 */
+typedef struct {
+    uintptr_t total;    /* 堆总字节数 */
+    uintptr_t used;     /* 当前已用字节数 */
+    uintptr_t peak;     /* 已用字节数峰值 */
+} meminfo_t;
+
 /* 系统调用结果 */
 typedef enum {
     SYSCALL_OK,         /* 正常完成 */
@@ -74,6 +108,13 @@ typedef struct {
     long (*read)(int fd, void *buf, size_t count);
     long (*open)(const char *path, uint32_t flags);
     long (*close)(int fd);
+    long (*sync)(void);
+    long (*fsync)(int fd);
+    long (*mkdirat)(int dirfd, const char *path, uint32_t mode);
+    long (*unlinkat)(int dirfd, const char *path, uint32_t flags);
+    long (*renameat2)(int olddirfd, const char *oldpath, int newdirfd, const char *newpath,
+                      uint32_t flags);
+    long (*getdents64)(int fd, void *buf, size_t len);
 } syscall_io_t;
 
 /**
@@ -146,6 +187,18 @@ typedef struct {
 
 void syscall_set_sync(const syscall_sync_t *sync);
 
+/**
+ * 内存管理接口
+ */
+typedef struct {
+    long (*meminfo)(meminfo_t *info);
+    long (*mmap)(uintptr_t addr, size_t len, int prot, int flags, int fd, size_t offset);
+    long (*munmap)(uintptr_t addr, size_t len);
+    long (*mprotect)(uintptr_t addr, size_t len, int prot);
+} syscall_mm_t;
+
+void syscall_set_mm(const syscall_mm_t *mm);
+
 /* 处理系统调用 */
 syscall_result_t syscall_dispatch(uintptr_t id, uintptr_t args[6]);
 
@@ -4,11 +4,23 @@
 #include "proc_manage.h"
 #include <string.h>
 
-/* 全局 PID 计数器 */
-static pid_t g_pid_counter = 0;
+/* PID 占用表：进程被父进程回收后其 PID 可以复用 */
+static bool g_pid_used[MAX_PROCS];
 
 pid_t pid_alloc(void) {
-    return g_pid_counter++;
+    for (pid_t pid = 0; pid < MAX_PROCS; pid++) {
+        if (!g_pid_used[pid]) {
+            g_pid_used[pid] = true;
+            return pid;
+        }
+    }
+    return MAX_PROCS;
+}
+
+void pid_free(pid_t pid) {
+    if (pid < MAX_PROCS) {
+        g_pid_used[pid] = false;
+    }
 }
 
 void pm_init(proc_manager_t *pm) {
@@ -150,6 +162,7 @@ wait_result_t pm_wait(proc_manager_t *pm, pid_t child_pid) {
             result.pid = rel->dead_children[rel->dead_count].pid;
             result.exit_code = rel->dead_children[rel->dead_count].exit_code;
             result.found = true;
+            pid_free(result.pid);
         } else if (rel->child_count > 0) {
             /* 有子进程但还没退出 */
             result.pid = (pid_t)-2;
@@ -165,6 +178,7 @@ wait_result_t pm_wait(proc_manager_t *pm, pid_t child_pid) {
                 result.pid = rel->dead_children[i].pid;
                 result.exit_code = rel->dead_children[i].exit_code;
                 result.found = true;
+                pid_free(result.pid);
                 /* 移除 */
                 for (size_t j = i; j < rel->dead_count - 1; j++) {
                     rel->dead_children[j] = rel->dead_children[j + 1];
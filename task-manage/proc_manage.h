@@ -18,9 +18,12 @@ typedef size_t pid_t;
 
 #define PID_INVALID ((pid_t)-1)
 
-/* 分配新的进程 ID */
+/* 分配新的进程 ID（优先复用已回收的 ID），耗尽时返回 >= MAX_PROCS 的值 */
 pid_t pid_alloc(void);
 
+/* 回收进程 ID */
+void pid_free(pid_t pid);
+
 /* ============================================================================
  * 进程关系
  * ========================================================================== */
@@ -0,0 +1,109 @@
+/**
+ * 目录测试
+ *
+ * 创建多级目录与其中的文件，经由多分量路径读写，用 getdents64 列目录，
+ * 再测试重命名（跨目录移动文件与目录）、删除文件与空目录，最后清理。
+ */
+#include "../user.h"
+
+static int str_eq(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+static int check(int ok, const char *what) {
+    if (!ok) {
+        print_str("dirtest: ");
+        puts(what);
+        sys_exit(-1);
+    }
+    return ok;
+}
+
+static int write_file(const char *path, const char *data, int len) {
+    int fd = sys_open(path, O_CREATE | O_WRONLY);
+    if (fd < 0) return -1;
+    int n = sys_write(fd, data, len);
+    sys_close(fd);
+    return n;
+}
+
+static int read_file(const char *path, char *buf, int len) {
+    int fd = sys_open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    int n = sys_read(fd, buf, len);
+    sys_close(fd);
+    return n;
+}
+
+/* 列出目录，打印名字并返回目录项数（含 . 与 ..） */
+static int list_dir(const char *path) {
+    static char buf[512];
+    int fd = sys_open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    int count = 0;
+    print_str(path);
+    print_str(":");
+    int n;
+    while ((n = sys_getdents64(fd, buf, sizeof(buf))) > 0) {
+        for (int off = 0; off < n; ) {
+            dirent64_t *d = (dirent64_t *)(buf + off);
+            print_str(" ");
+            print_str(d->d_name);
+            if (d->d_type == DT_DIR) print_str("/");
+            count++;
+            off += d->d_reclen;
+        }
+    }
+    putchar('\n');
+    sys_close(fd);
+    return n < 0 ? -1 : count;
+}
+
+int main(void) {
+    char buf[32];
+
+    check(sys_mkdir("dt") == 0, "mkdir dt");
+    check(sys_mkdir("dt") < 0, "mkdir existing dir should fail");
+    check(sys_mkdir("/dt/sub") == 0, "mkdir dt/sub");
+    check(sys_mkdir("dt/missing/x") < 0, "mkdir under missing dir should fail");
+
+    check(write_file("dt/sub/f", "nested", 6) == 6, "write dt/sub/f");
+    check(read_file("/dt/./sub/../sub//f", buf, sizeof(buf)) == 6, "read via . and ..");
+    buf[6] = '\0';
+    check(str_eq(buf, "nested"), "nested content");
+    check(sys_open("dt/sub/f/x", O_RDONLY) < 0, "file used as dir should fail");
+    check(sys_open("dt", O_RDWR) < 0, "opening dir for write should fail");
+
+    check(list_dir("dt/sub") == 3, "list dt/sub");
+
+    /* 跨目录移动文件 */
+    check(sys_rename("dt/sub/f", "dt/g") == 0, "rename file");
+    check(sys_open("dt/sub/f", O_RDONLY) < 0, "old name gone");
+    check(read_file("dt/g", buf, sizeof(buf)) == 6, "read renamed file");
+
+    /* 移动目录，.. 随之更新；不能移到自己的子目录中 */
+    check(sys_rename("dt", "dt/sub/x") < 0, "rename into own subtree should fail");
+    check(sys_mkdir("dt2") == 0, "mkdir dt2");
+    check(sys_rename("dt/sub", "dt2/moved") == 0, "rename dir");
+    check(write_file("dt2/moved/../h", "h", 1) == 1, "create via moved ..");
+    check(list_dir("dt2") == 4, "list dt2");
+
+    /* 删除 */
+    check(sys_rmdir("dt2") < 0, "rmdir non-empty should fail");
+    check(sys_unlink("dt2/moved") < 0, "unlink dir should fail");
+    check(sys_rmdir("dt2/moved") == 0, "rmdir dt2/moved");
+    check(sys_unlink("dt2/h") == 0, "unlink dt2/h");
+    check(sys_unlink("dt2/h") < 0, "unlink twice should fail");
+    check(sys_rmdir("dt2") == 0, "rmdir dt2");
+    check(sys_unlink("dt/g") == 0, "unlink dt/g");
+    check(sys_rmdir("dt") == 0, "rmdir dt");
+    check(sys_open("dt", O_RDONLY) < 0, "dt gone");
+
+    puts("dirtest passed!");
+    return 0;
+}
@@ -0,0 +1,81 @@
+/**
+ * exec 循环测试
+ *
+ * 程序反复 exec 自身共 ROUNDS 次。exec 不保留用户内存，轮次与堆用量
+ * 记录在文件中。旧地址空间若未回收，每轮都会泄漏整套页表和用户页，
+ * 内核堆用量随轮次线性增长；回收正确时应稳定在起始值附近。
+ */
+#include "../user.h"
+
+#define ROUNDS 10000
+#define REPORT_EVERY 1000
+#define LEAK_LIMIT (64 * 1024)
+#define STATE_FILE "execloop.state"
+
+typedef struct {
+    int round;
+    uintptr_t base_used;
+    uintptr_t max_used;
+} state_t;
+
+static int save_state(const state_t *st, size_t len) {
+    int fd = sys_open(STATE_FILE, O_CREATE | O_WRONLY);
+    if (fd < 0) return -1;
+    int n = len ? sys_write(fd, st, len) : 0;
+    sys_close(fd);
+    return n == (int)len ? 0 : -1;
+}
+
+int main(void) {
+    meminfo_t info;
+    if (sys_meminfo(&info) != 0) {
+        puts("meminfo not supported");
+        return -1;
+    }
+
+    state_t st;
+    int fd = sys_open(STATE_FILE, O_RDONLY);
+    int n = fd >= 0 ? sys_read(fd, &st, sizeof(st)) : -1;
+    if (fd >= 0) sys_close(fd);
+    if (n != (int)sizeof(st)) {
+        st.round = 0;
+        st.base_used = info.used;
+        st.max_used = info.used;
+        puts("[execloop] start");
+    }
+
+    st.round++;
+    if (info.used > st.max_used) st.max_used = info.used;
+
+    if (st.round % REPORT_EVERY == 0) {
+        print_str("[execloop] round ");
+        print_int(st.round);
+        print_str(" used = ");
+        print_int((int)info.used);
+        putchar('\n');
+    }
+
+    if (st.round >= ROUNDS) {
+        /* 清空状态文件，下次运行重新开始 */
+        save_state(&st, 0);
+
+        uintptr_t growth = st.max_used - st.base_used;
+        print_str("[execloop] max growth = ");
+        print_int((int)growth);
+        putchar('\n');
+        if (growth > LEAK_LIMIT) {
+            puts("execloop: kernel heap keeps growing!");
+            return -1;
+        }
+        puts("execloop passed!");
+        return 0;
+    }
+
+    if (save_state(&st, sizeof(st)) != 0) {
+        puts("execloop: cannot save state");
+        return -1;
+    }
+    sys_exec("execloop", 8);
+    puts("execloop: exec failed");
+    return -1;
+}
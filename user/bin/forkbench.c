@@ -0,0 +1,84 @@
+/**
+ * fork 延迟测试
+ *
+ * 分别在工作集较小和较大（写满 BIG_PAGES 页）时测量 fork + 子进程立即退出
+ * 的平均耗时。写时复制之前 fork 耗时随工作集线性增长，之后应基本持平。
+ */
+#include "../user.h"
+
+#define ROUNDS 20
+#define BIG_PAGES 64
+#define PAGE_SIZE 4096
+
+static char g_buf[BIG_PAGES * PAGE_SIZE];
+
+static uint64_t now_us(void) {
+    timespec_t ts;
+    sys_clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int fork_wait(void) {
+    int pid = sys_fork();
+    if (pid == 0) {
+        sys_exit(0);
+    }
+    if (pid < 0) return -1;
+
+    int exit_code = 0;
+    int ret;
+    while ((ret = sys_waitpid(pid, &exit_code)) == -2) {
+        sys_sched_yield();
+    }
+    return ret == pid ? 0 : -1;
+}
+
+static int bench(const char *tag) {
+    uint64_t start = now_us();
+    for (int i = 0; i < ROUNDS; i++) {
+        if (fork_wait() != 0) {
+            puts("fork failed");
+            return -1;
+        }
+    }
+    uint64_t avg = (now_us() - start) / ROUNDS;
+
+    print_str("[forkbench] ");
+    print_str(tag);
+    print_str(": ");
+    print_int((int)avg);
+    puts(" us/fork");
+    return 0;
+}
+
+int main(void) {
+    if (bench("small") != 0) return -1;
+
+    /* 写满缓冲区，增大工作集 */
+    for (int i = 0; i < BIG_PAGES; i++) {
+        g_buf[i * PAGE_SIZE] = (char)i;
+    }
+    if (bench("64 pages") != 0) return -1;
+
+    /* 子进程写入不应影响父进程 */
+    int pid = sys_fork();
+    if (pid == 0) {
+        for (int i = 0; i < BIG_PAGES; i++) {
+            g_buf[i * PAGE_SIZE] = 0;
+        }
+        sys_exit(0);
+    }
+    int exit_code = 0;
+    while (sys_waitpid(pid, &exit_code) == -2) {
+        sys_sched_yield();
+    }
+    for (int i = 0; i < BIG_PAGES; i++) {
+        if (g_buf[i * PAGE_SIZE] != (char)i) {
+            puts("forkbench: parent memory corrupted!");
+            return -1;
+        }
+    }
+
+    puts("forkbench done.");
+    return 0;
+}
@@ -0,0 +1,73 @@
+/**
+ * 内核堆压力测试
+ *
+ * 反复 fork + exec + wait，定期打印内核堆使用量。
+ * 子进程的地址空间与文件在退出时回收，结束时堆用量的增长应不超过 LEAK_LIMIT。
+ */
+#include "../user.h"
+
+#define ROUNDS 100
+#define REPORT_EVERY 20
+#define LEAK_LIMIT (64 * 1024)
+
+static void print_meminfo(const char *tag, meminfo_t *info) {
+    print_str(tag);
+    print_str(" used = ");
+    print_int((int)info->used);
+    print_str(" peak = ");
+    print_int((int)info->peak);
+    print_str(" total = ");
+    print_int((int)info->total);
+    putchar('\n');
+}
+
+int main(void) {
+    meminfo_t start, now;
+    if (sys_meminfo(&start) != 0) {
+        puts("meminfo not supported");
+        return -1;
+    }
+    print_meminfo("[heapstress] start", &start);
+
+    for (int i = 1; i <= ROUNDS; i++) {
+        int pid = sys_fork();
+        if (pid == 0) {
+            sys_exec("00hello_world", 13);
+            sys_exit(-1);
+        }
+        if (pid < 0) {
+            print_str("fork failed at round ");
+            print_int(i);
+            putchar('\n');
+            return -1;
+        }
+
+        int exit_code = 0;
+        int ret;
+        while ((ret = sys_waitpid(pid, &exit_code)) == -2) {
+            sys_sched_yield();
+        }
+        if (ret != pid) {
+            puts("waitpid failed");
+            return -1;
+        }
+
+        if (i % REPORT_EVERY == 0) {
+            sys_meminfo(&now);
+            print_str("[heapstress] round ");
+            print_int(i);
+            print_meminfo("", &now);
+        }
+    }
+
+    sys_meminfo(&now);
+    print_str("[heapstress] delta = ");
+    print_int((int)(now.used - start.used));
+    putchar('\n');
+    if (now.used > start.used + LEAK_LIMIT) {
+        puts("heapstress: kernel heap leaked!");
+        return -1;
+    }
+    puts("heapstress done.");
+    return 0;
+}
@@ -0,0 +1,99 @@
+/**
+ * mmap / munmap / mprotect 测试
+ *
+ * 1. 匿名映射一大块缓冲区，写满后校验
+ * 2. munmap 中间一段后，剩余部分内容不变，新的映射可以复用空洞
+ * 3. mprotect 改为只读后，子进程写入会被杀死，父进程不受影响
+ * 4. 映射文件（有文件系统时），读到的内容与 read 一致
+ */
+#include "../user.h"
+
+#define PAGE_SIZE 4096
+#define BIG_PAGES 256
+
+static int fail(const char *msg) {
+    print_str("mmaptest: ");
+    puts(msg);
+    return -1;
+}
+
+static int wait_child(int pid) {
+    int exit_code = 0;
+    while (sys_waitpid(pid, &exit_code) == -2) {
+        sys_sched_yield();
+    }
+    return exit_code;
+}
+
+static int test_file(void) {
+    const char *name = "mmaptest.dat";
+    char data[64];
+    for (int i = 0; i < 64; i++) data[i] = (char)('a' + i % 26);
+
+    int fd = sys_open(name, O_CREATE | O_WRONLY);
+    int n = fd >= 0 ? sys_write(fd, data, sizeof(data)) : -1;
+    if (fd >= 0) sys_close(fd);
+    if (n != (int)sizeof(data)) {
+        puts("[mmaptest] no file system, skip file mapping");
+        return 0;
+    }
+
+    fd = sys_open(name, O_RDONLY);
+    char *m = sys_mmap(0, PAGE_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+    sys_close(fd);
+    if (m == MAP_FAILED) return fail("file mmap failed");
+
+    for (int i = 0; i < 64; i++) {
+        if (m[i] != data[i]) return fail("file content mismatch");
+    }
+    for (int i = 64; i < PAGE_SIZE; i++) {
+        if (m[i] != 0) return fail("tail of file page not zero");
+    }
+    sys_munmap(m, PAGE_SIZE);
+    puts("[mmaptest] file mapping ok");
+    return 0;
+}
+
+int main(void) {
+    size_t len = BIG_PAGES * PAGE_SIZE;
+    char *buf = sys_mmap(0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf == MAP_FAILED) return fail("anonymous mmap failed");
+
+    for (int i = 0; i < BIG_PAGES; i++) {
+        if (buf[i * PAGE_SIZE + 1] != 0) return fail("new mapping not zeroed");
+        buf[i * PAGE_SIZE] = (char)i;
+    }
+    puts("[mmaptest] anonymous mapping ok");
+
+    /* 解除中间 16 页 */
+    char *hole = buf + 64 * PAGE_SIZE;
+    if (sys_munmap(hole, 16 * PAGE_SIZE) != 0) return fail("munmap failed");
+    for (int i = 0; i < BIG_PAGES; i++) {
+        if (i >= 64 && i < 80) continue;
+        if (buf[i * PAGE_SIZE] != (char)i) return fail("data lost after munmap");
+    }
+    char *again = sys_mmap(hole, 16 * PAGE_SIZE, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    if (again != hole) return fail("MAP_FIXED into hole failed");
+    if (again[0] != 0) return fail("remapped page not zeroed");
+    puts("[mmaptest] munmap ok");
+
+    /* 只读后子进程写入应被杀死 */
+    if (sys_mprotect(buf, PAGE_SIZE, PROT_READ) != 0) return fail("mprotect failed");
+    int pid = sys_fork();
+    if (pid == 0) {
+        buf[0] = 1;
+        sys_exit(0);
+    }
+    if (wait_child(pid) == 0) return fail("write to read-only page succeeded");
+    if (buf[0] != 0) return fail("read-only page changed");
+    if (sys_mprotect(buf, PAGE_SIZE, PROT_READ | PROT_WRITE) != 0) return fail("mprotect back failed");
+    buf[0] = 42;
+    puts("[mmaptest] mprotect ok");
+
+    if (test_file() != 0) return -1;
+
+    sys_munmap(buf, len);
+    puts("mmaptest passed!");
+    return 0;
+}
@@ -0,0 +1,60 @@
+/**
+ * 系统调用延迟测试
+ *
+ * 反复调用 getpid 测量一次往返的平均耗时；第二组在每次调用之间
+ * 访问 TOUCH_PAGES 页，TLB 在陷入内核时被整体刷新的话，这些页每轮都要
+ * 重新走页表，耗时会明显高于第一组。
+ */
+#include "../user.h"
+
+#define ROUNDS 10000
+#define TOUCH_PAGES 32
+#define PAGE_SIZE 4096
+
+static char g_buf[TOUCH_PAGES * PAGE_SIZE];
+
+static uint64_t now_us(void) {
+    timespec_t ts;
+    sys_clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void report(const char *tag, uint64_t total_us) {
+    print_str("[syscallbench] ");
+    print_str(tag);
+    print_str(": ");
+    print_int((int)(total_us * 1000 / ROUNDS));
+    puts(" ns/call");
+}
+
+int main(void) {
+    int pid = sys_getpid();
+
+    uint64_t start = now_us();
+    for (int i = 0; i < ROUNDS; i++) {
+        if (sys_getpid() != pid) {
+            puts("getpid mismatch");
+            return -1;
+        }
+    }
+    report("getpid", now_us() - start);
+
+    /* 预先调入工作集 */
+    for (int p = 0; p < TOUCH_PAGES; p++) {
+        g_buf[p * PAGE_SIZE] = (char)p;
+    }
+
+    volatile char sink = 0;
+    start = now_us();
+    for (int i = 0; i < ROUNDS; i++) {
+        sys_getpid();
+        for (int p = 0; p < TOUCH_PAGES; p++) {
+            sink += g_buf[p * PAGE_SIZE];
+        }
+    }
+    report("getpid + 32 pages", now_us() - start);
+    (void)sink;
+
+    puts("syscallbench done.");
+    return 0;
+}
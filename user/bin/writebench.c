@@ -0,0 +1,84 @@
+/**
+ * 小块写入吞吐测试
+ *
+ * 以日志方式追加 RECORDS 条 RECORD_SIZE 字节的记录，测量每次 write 的平均耗时，
+ * 再测量 fsync 耗时并读回校验。写回缓存之前每次 write 都要同步写盘。
+ */
+#include "../user.h"
+
+#define RECORDS 2000
+#define RECORD_SIZE 32
+
+static uint64_t now_us(void) {
+    timespec_t ts;
+    sys_clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void make_record(char *rec, int i) {
+    for (int j = 0; j < RECORD_SIZE; j++) {
+        rec[j] = (char)('a' + (i + j) % 26);
+    }
+    rec[RECORD_SIZE - 1] = '\n';
+}
+
+int main(void) {
+    char rec[RECORD_SIZE];
+
+    int fd = sys_open("writebench.log", O_CREATE | O_WRONLY);
+    if (fd < 0) {
+        puts("writebench: open failed");
+        return -1;
+    }
+
+    uint64_t start = now_us();
+    for (int i = 0; i < RECORDS; i++) {
+        make_record(rec, i);
+        if (sys_write(fd, rec, RECORD_SIZE) != RECORD_SIZE) {
+            puts("writebench: write failed");
+            return -1;
+        }
+    }
+    uint64_t written = now_us();
+    if (sys_fsync(fd) != 0) {
+        puts("writebench: fsync failed");
+        return -1;
+    }
+    uint64_t synced = now_us();
+    sys_close(fd);
+
+    print_str("[writebench] ");
+    print_int((int)((written - start) / RECORDS));
+    print_str(" us/write, fsync ");
+    print_int((int)(synced - written));
+    puts(" us");
+
+    /* 读回校验 */
+    fd = sys_open("writebench.log", O_RDONLY);
+    if (fd < 0) {
+        puts("writebench: reopen failed");
+        return -1;
+    }
+    char buf[RECORD_SIZE];
+    for (int i = 0; i < RECORDS; i++) {
+        make_record(rec, i);
+        if (sys_read(fd, buf, RECORD_SIZE) != RECORD_SIZE) {
+            puts("writebench: short read");
+            return -1;
+        }
+        for (int j = 0; j < RECORD_SIZE; j++) {
+            if (buf[j] != rec[j]) {
+                puts("writebench: data mismatch");
+                return -1;
+            }
+        }
+    }
+    sys_close(fd);
+
+    if (sys_sync() != 0) {
+        puts("writebench: sync failed");
+        return -1;
+    }
+    puts("writebench passed!");
+    return 0;
+}
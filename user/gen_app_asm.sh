@@ -17,6 +17,32 @@ OUTPUT=$3
 shift 3
 BINS=("$@")
 COUNT=${#BINS[@]}
+READELF=${READELF:-riscv64-linux-musl-readelf}
+command -v "$READELF" >/dev/null 2>&1 || READELF=readelf
+
+# 应用加载后占用的内存大小（含 .bss）
+# 取同名 ELF 中 LOAD 段的地址范围，ELF 不存在时退化为 .bin 的大小
+mem_size() {
+    local bin=$1
+    local elf="${bin%.bin}.elf"
+    local size lo="" hi=0
+    size=$(stat -c %s "$bin")
+    if [ -f "$elf" ] && command -v "$READELF" >/dev/null 2>&1; then
+        while read -r type _ vaddr _ _ memsz _; do
+            [ "$type" = "LOAD" ] || continue
+            if [ -z "$lo" ] || [ $((vaddr)) -lt "$lo" ]; then
+                lo=$((vaddr))
+            fi
+            if [ $((vaddr + memsz)) -gt "$hi" ]; then
+                hi=$((vaddr + memsz))
+            fi
+        done < <("$READELF" -lW "$elf")
+        if [ -n "$lo" ] && [ $((hi - lo)) -gt "$size" ]; then
+            size=$((hi - lo))
+        fi
+    fi
+    echo "$size"
+}
 
 cat > "$OUTPUT" <<EOF
 # Auto-generated application metadata
@@ -35,6 +61,13 @@ for i in $(seq 0 $((COUNT - 1))); do
 done
 echo "    .quad app_$((COUNT - 1))_end" >> "$OUTPUT"
 
+# 各应用的内存大小，加载时只需清零 [文件大小, 内存大小) 部分
+for i in $(seq 0 $((COUNT - 1))); do
+    BIN="${BINS[$i]}"
+    [ -f "$BIN" ] || { echo "Error: $BIN not found" >&2; exit 1; }
+    echo "    .quad $(mem_size "$BIN")    # app_${i} memsz" >> "$OUTPUT"
+done
+
 # 嵌入二进制
 for i in $(seq 0 $((COUNT - 1))); do
     BIN="${BINS[$i]}"
@@ -33,7 +33,7 @@ echo "app_count:" >> "$OUTPUT"
 echo "    .quad $COUNT" >> "$OUTPUT"
 
 # 生成应用程序元数据（与 app_meta_t 兼容）
-# 布局: base(0), step(0), count, 然后是 count+1 个地址
+# 布局: base(0), step(0), count, 然后是 count+1 个地址和 count 个内存大小
 cat >> "$OUTPUT" << EOF
 
 # 应用程序元数据 (app_meta_t 格式)
@@ -50,6 +50,11 @@ for i in "${!APPS[@]}"; do
 done
 echo "    .quad app_${COUNT}_end   # 最后一个的结束地址" >> "$OUTPUT"
 
+# 各应用的内存大小（base = 0 时不复制，填 0 表示与文件大小相同）
+for i in "${!APPS[@]}"; do
+    echo "    .quad 0" >> "$OUTPUT"
+done
+
 # 嵌入应用程序数据
 echo "" >> "$OUTPUT"
 
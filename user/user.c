@@ -3,8 +3,13 @@
  */
 #include "user.h"
 
+#define SYS_MKDIRAT         34
+#define SYS_UNLINKAT        35
 #define SYS_OPEN            56
 #define SYS_CLOSE           57
+#define SYS_GETDENTS64      61
+#define SYS_SYNC            81
+#define SYS_FSYNC           82
 #define SYS_READ            63
 #define SYS_WRITE           64
 #define SYS_EXIT            93
@@ -18,6 +23,7 @@
 #define SYS_SIGPROCMASK     135
 #define SYS_SIGRETURN       139
 #define SYS_WAITPID         260
+#define SYS_RENAMEAT2       276
 #define SYS_THREAD_CREATE   1000
 #define SYS_GETTID          1001
 #define SYS_WAITTID         1002
@@ -30,6 +36,10 @@
 #define SYS_CONDVAR_CREATE  1030
 #define SYS_CONDVAR_SIGNAL  1031
 #define SYS_CONDVAR_WAIT    1032
+#define SYS_MUNMAP          215
+#define SYS_MMAP            222
+#define SYS_MPROTECT        226
+#define SYS_MEMINFO         2000
 
 static long syscall(long n, long a0, long a1, long a2) {
     register long _a0 asm("a0") = a0;
@@ -43,6 +53,21 @@ static long syscall(long n, long a0, long a1, long a2) {
     return _a0;
 }
 
+static long syscall6(long n, long a0, long a1, long a2, long a3, long a4, long a5) {
+    register long _a0 asm("a0") = a0;
+    register long _a1 asm("a1") = a1;
+    register long _a2 asm("a2") = a2;
+    register long _a3 asm("a3") = a3;
+    register long _a4 asm("a4") = a4;
+    register long _a5 asm("a5") = a5;
+    register long _a7 asm("a7") = n;
+    asm volatile("ecall"
+                 : "+r"(_a0)
+                 : "r"(_a1), "r"(_a2), "r"(_a3), "r"(_a4), "r"(_a5), "r"(_a7)
+                 : "memory");
+    return _a0;
+}
+
 int sys_open(const char *path, unsigned int flags) {
     return syscall(SYS_OPEN, (long)path, flags, 0);
 }
@@ -51,6 +76,34 @@ int sys_close(int fd) {
     return syscall(SYS_CLOSE, fd, 0, 0);
 }
 
+int sys_sync(void) {
+    return syscall(SYS_SYNC, 0, 0, 0);
+}
+
+int sys_fsync(int fd) {
+    return syscall(SYS_FSYNC, fd, 0, 0);
+}
+
+int sys_mkdir(const char *path) {
+    return syscall(SYS_MKDIRAT, AT_FDCWD, (long)path, 0);
+}
+
+int sys_unlink(const char *path) {
+    return syscall(SYS_UNLINKAT, AT_FDCWD, (long)path, 0);
+}
+
+int sys_rmdir(const char *path) {
+    return syscall(SYS_UNLINKAT, AT_FDCWD, (long)path, AT_REMOVEDIR);
+}
+
+int sys_rename(const char *oldpath, const char *newpath) {
+    return syscall6(SYS_RENAMEAT2, AT_FDCWD, (long)oldpath, AT_FDCWD, (long)newpath, 0, 0);
+}
+
+int sys_getdents64(int fd, void *buf, size_t len) {
+    return syscall(SYS_GETDENTS64, fd, (long)buf, len);
+}
+
 int sys_read(int fd, void *buf, size_t count) {
     return syscall(SYS_READ, fd, (long)buf, count);
 }
@@ -156,6 +209,22 @@ int sys_condvar_wait(int condvar_id, int mutex_id) {
     return syscall(SYS_CONDVAR_WAIT, condvar_id, mutex_id, 0);
 }
 
+int sys_meminfo(meminfo_t *info) {
+    return syscall(SYS_MEMINFO, (long)info, 0, 0);
+}
+
+void *sys_mmap(void *addr, size_t len, int prot, int flags, int fd, size_t offset) {
+    return (void *)syscall6(SYS_MMAP, (long)addr, len, prot, flags, fd, offset);
+}
+
+int sys_munmap(void *addr, size_t len) {
+    return syscall(SYS_MUNMAP, (long)addr, len, 0);
+}
+
+int sys_mprotect(void *addr, size_t len, int prot) {
+    return syscall(SYS_MPROTECT, (long)addr, len, prot);
+}
+
 void putchar(char c) {
     sys_write(STDOUT, &c, 1);
 }
@@ -22,9 +22,23 @@ typedef struct {
     uintptr_t tv_nsec;
 } timespec_t;
 
+/* 内核堆使用情况 */
+typedef struct {
+    uintptr_t total;
+    uintptr_t used;
+    uintptr_t peak;
+} meminfo_t;
+
 /* 系统调用 */
 int sys_open(const char *path, unsigned int flags);
 int sys_close(int fd);
+int sys_sync(void);
+int sys_fsync(int fd);
+int sys_mkdir(const char *path);
+int sys_unlink(const char *path);
+int sys_rmdir(const char *path);
+int sys_rename(const char *oldpath, const char *newpath);
+int sys_getdents64(int fd, void *buf, size_t len);
 int sys_read(int fd, void *buf, size_t count);
 int sys_write(int fd, const void *buf, size_t count);
 void sys_exit(int code) __attribute__((noreturn));
@@ -46,6 +60,22 @@ int sys_sigreturn(void);
 #define O_CREATE    (1 << 9)
 #define O_TRUNC     (1 << 10)
 
+/* *at 系列调用 */
+#define AT_FDCWD        (-100)
+#define AT_REMOVEDIR    0x200
+
+/* getdents64 返回的目录项记录 */
+typedef struct {
+    unsigned long d_ino;
+    long d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+} dirent64_t;
+
+#define DT_DIR      4
+#define DT_REG      8
+
 /* 信号编号 */
 #define SIGINT      2
 #define SIGKILL     9
@@ -76,6 +106,24 @@ int sys_condvar_create(void);
 int sys_condvar_signal(int condvar_id);
 int sys_condvar_wait(int condvar_id, int mutex_id);
 
+/* 内存管理 */
+int sys_meminfo(meminfo_t *info);
+void *sys_mmap(void *addr, size_t len, int prot, int flags, int fd, size_t offset);
+int sys_munmap(void *addr, size_t len);
+int sys_mprotect(void *addr, size_t len, int prot);
+
+/* mmap 保护位与标志 */
+#define PROT_NONE       0
+#define PROT_READ       (1 << 0)
+#define PROT_WRITE      (1 << 1)
+#define PROT_EXEC       (1 << 2)
+
+#define MAP_SHARED      0x01
+#define MAP_PRIVATE     0x02
+#define MAP_FIXED       0x10
+#define MAP_ANONYMOUS   0x20
+#define MAP_FAILED      ((void *)-1)
+
 /* 便捷封装 */
 static inline int getchar(void) {
     char c;
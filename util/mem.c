@@ -1,19 +1,210 @@
 /**
  * 基础内存操作函数
+ *
+ * memset / memcpy / memcmp 按 8 字节字处理：
+ * - 先逐字节处理到目标地址 8 字节对齐，中间按字（主循环每次 8 个字）处理，尾部再逐字节
+ * - memcpy 源地址与目标地址对齐方式不同时，按对齐的字读取源数据并移位拼接，
+ *   避免非对齐访问（在很多 RISC-V 实现上由 SBI 模拟，极慢）
+ *
+ * 以 RVV=1 构建时（定义 MEM_USE_RVV），较长的操作改用 RISC-V 向量扩展。
  */
 #include <stddef.h>
+#include <stdint.h>
+
+/* 允许与任意类型别名的字类型 */
+typedef uint64_t __attribute__((may_alias)) word_t;
+
+#define WORD_SIZE   sizeof(word_t)
+#define WORD_MASK   (WORD_SIZE - 1)
+#define BLOCK_SIZE  (8 * WORD_SIZE)
+
+/* ============================================================================
+ * 向量实现 (RVV 1.0)
+ * ========================================================================== */
+
+#ifdef MEM_USE_RVV
+
+#define RVV_THRESHOLD   64      /* 更短的操作用标量实现，省去 vsetvli 的开销 */
+#define SSTATUS_VS      (3UL << 9)
+#define SSTATUS_VS_INIT (1UL << 9)
+
+/* LMUL = 8 时一个操作数占用 8 个向量寄存器 */
+#define RVV_CLOBBER_V0  "v0", "v1", "v2", "v3", "v4", "v5", "v6", "v7"
+#define RVV_CLOBBER_V8  "v8", "v9", "v10", "v11", "v12", "v13", "v14", "v15"
+
+/* S 态使用向量指令前须打开 sstatus.VS，首次使用时打开一次 */
+static inline void rvv_enable(void) {
+    static int enabled;
+    if (!enabled) {
+        uintptr_t sstatus;
+        asm volatile("csrr %0, sstatus" : "=r"(sstatus));
+        if ((sstatus & SSTATUS_VS) == 0) {
+            asm volatile("csrs sstatus, %0" :: "r"(SSTATUS_VS_INIT));
+        }
+        enabled = 1;
+    }
+}
+
+static void rvv_memset(unsigned char *d, int c, size_t n) {
+    rvv_enable();
+    while (n > 0) {
+        size_t vl;
+        asm volatile("vsetvli %0, %1, e8, m8, ta, ma\n"
+                     "vmv.v.x v0, %2\n"
+                     "vse8.v v0, (%3)"
+                     : "=&r"(vl) : "r"(n), "r"(c), "r"(d)
+                     : "memory", RVV_CLOBBER_V0);
+        d += vl;
+        n -= vl;
+    }
+}
+
+static void rvv_memcpy(unsigned char *d, const unsigned char *s, size_t n) {
+    rvv_enable();
+    while (n > 0) {
+        size_t vl;
+        asm volatile("vsetvli %0, %1, e8, m8, ta, ma\n"
+                     "vle8.v v0, (%2)\n"
+                     "vse8.v v0, (%3)"
+                     : "=&r"(vl) : "r"(n), "r"(s), "r"(d)
+                     : "memory", RVV_CLOBBER_V0);
+        s += vl;
+        d += vl;
+        n -= vl;
+    }
+}
+
+/* 返回第一个不同字节的下标，全部相同返回 n */
+static size_t rvv_mismatch(const unsigned char *a, const unsigned char *b, size_t n) {
+    rvv_enable();
+    size_t done = 0;
+    while (done < n) {
+        size_t vl;
+        long first;
+        asm volatile("vsetvli %0, %2, e8, m8, ta, ma\n"
+                     "vle8.v v0, (%3)\n"
+                     "vle8.v v8, (%4)\n"
+                     "vmsne.vv v16, v0, v8\n"
+                     "vfirst.m %1, v16"
+                     : "=&r"(vl), "=&r"(first)
+                     : "r"(n - done), "r"(a + done), "r"(b + done)
+                     : "memory", RVV_CLOBBER_V0, RVV_CLOBBER_V8, "v16");
+        if (first >= 0) return done + (size_t)first;
+        done += vl;
+    }
+    return n;
+}
+
+#endif /* MEM_USE_RVV */
+
+/* ============================================================================
+ * 标量实现
+ * ========================================================================== */
 
 void *memset(void *s, int c, size_t n) {
     unsigned char *p = s;
+
+#ifdef MEM_USE_RVV
+    if (n >= RVV_THRESHOLD) {
+        rvv_memset(p, c, n);
+        return s;
+    }
+#endif
+
+    /* 头部：对齐到字 */
+    while (n > 0 && ((uintptr_t)p & WORD_MASK)) {
+        *p++ = (unsigned char)c;
+        n--;
+    }
+
+    if (n >= WORD_SIZE) {
+        word_t w = (unsigned char)c;
+        w |= w << 8;
+        w |= w << 16;
+        w |= w << 32;
+
+        word_t *wp = (word_t *)p;
+        while (n >= BLOCK_SIZE) {
+            wp[0] = w; wp[1] = w; wp[2] = w; wp[3] = w;
+            wp[4] = w; wp[5] = w; wp[6] = w; wp[7] = w;
+            wp += 8;
+            n -= BLOCK_SIZE;
+        }
+        while (n >= WORD_SIZE) {
+            *wp++ = w;
+            n -= WORD_SIZE;
+        }
+        p = (unsigned char *)wp;
+    }
+
     while (n--) {
         *p++ = (unsigned char)c;
     }
     return s;
 }
 
+/* 源与目标同样对齐：直接按字拷贝 */
+static void copy_aligned(word_t *d, const word_t *s, size_t words) {
+    while (words >= 8) {
+        d[0] = s[0]; d[1] = s[1]; d[2] = s[2]; d[3] = s[3];
+        d[4] = s[4]; d[5] = s[5]; d[6] = s[6]; d[7] = s[7];
+        d += 8;
+        s += 8;
+        words -= 8;
+    }
+    while (words--) {
+        *d++ = *s++;
+    }
+}
+
+/**
+ * 源未对齐：按对齐的字读取，相邻两字移位拼出一个目标字（小端）
+ *
+ * 读取不会越过 src + words * 8 所在的字，因此不会访问源范围以外的页。
+ */
+static void copy_shifted(word_t *d, const unsigned char *src, size_t words) {
+    size_t off = (uintptr_t)src & WORD_MASK;
+    unsigned int rs = off * 8;
+    unsigned int ls = 64 - rs;
+    const word_t *s = (const word_t *)(src - off);
+
+    word_t lo = *s++;
+    while (words--) {
+        word_t hi = *s++;
+        *d++ = (lo >> rs) | (hi << ls);
+        lo = hi;
+    }
+}
+
 void *memcpy(void *dest, const void *src, size_t n) {
     unsigned char *d = dest;
     const unsigned char *s = src;
+
+#ifdef MEM_USE_RVV
+    if (n >= RVV_THRESHOLD) {
+        rvv_memcpy(d, s, n);
+        return dest;
+    }
+#endif
+
+    /* 头部：让目标对齐到字 */
+    while (n > 0 && ((uintptr_t)d & WORD_MASK)) {
+        *d++ = *s++;
+        n--;
+    }
+
+    size_t words = n / WORD_SIZE;
+    if (words > 0) {
+        if (((uintptr_t)s & WORD_MASK) == 0) {
+            copy_aligned((word_t *)d, (const word_t *)s, words);
+        } else {
+            copy_shifted((word_t *)d, s, words);
+        }
+        d += words * WORD_SIZE;
+        s += words * WORD_SIZE;
+        n -= words * WORD_SIZE;
+    }
+
     while (n--) {
         *d++ = *s++;
     }
@@ -23,6 +214,34 @@ void *memcpy(void *dest, const void *src, size_t n) {
 int memcmp(const void *s1, const void *s2, size_t n) {
     const unsigned char *p1 = s1;
     const unsigned char *p2 = s2;
+
+#ifdef MEM_USE_RVV
+    if (n >= RVV_THRESHOLD) {
+        size_t i = rvv_mismatch(p1, p2, n);
+        return i < n ? p1[i] - p2[i] : 0;
+    }
+#endif
+
+    /* 两者对齐方式相同时，先按字跳过相同的部分 */
+    if ((((uintptr_t)p1 ^ (uintptr_t)p2) & WORD_MASK) == 0) {
+        while (n > 0 && ((uintptr_t)p1 & WORD_MASK)) {
+            if (*p1 != *p2) return *p1 - *p2;
+            p1++;
+            p2++;
+            n--;
+        }
+        const word_t *w1 = (const word_t *)p1;
+        const word_t *w2 = (const word_t *)p2;
+        while (n >= WORD_SIZE && *w1 == *w2) {
+            w1++;
+            w2++;
+            n -= WORD_SIZE;
+        }
+        p1 = (const unsigned char *)w1;
+        p2 = (const unsigned char *)w2;
+    }
+
+    /* 剩余部分（或第一个不同的字）逐字节比较 */
     while (n--) {
         if (*p1 != *p2) {
             return *p1 - *p2;
@@ -0,0 +1,69 @@
+/**
+ * 内存操作函数基准测试实现
+ *
+ * 每种大小重复调用若干次取平均，同时给出逐字节拷贝作为对照。
+ */
+#include "mem_bench.h"
+#include "printf.h"
+#include "riscv.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define BENCH_MAX   4096
+#define BENCH_BYTES (256 * 1024)    /* 每种大小累计处理的字节数 */
+
+static uint8_t g_src[BENCH_MAX + 64] __attribute__((aligned(64)));
+static uint8_t g_dst[BENCH_MAX + 64] __attribute__((aligned(64)));
+
+/* 对照组：逐字节拷贝 */
+static void byte_copy(uint8_t *d, const uint8_t *s, size_t n) {
+    volatile uint8_t *vd = d;
+    while (n--) *vd++ = *s++;
+}
+
+enum { OP_MEMCPY, OP_MEMCPY_UNALIGNED, OP_MEMSET, OP_MEMCMP, OP_BYTE_COPY, OP_COUNT };
+
+static const char *g_op_names[OP_COUNT] = {
+    "memcpy", "memcpy+1", "memset", "memcmp", "byte-copy",
+};
+
+static uint64_t run(int op, size_t size, size_t rounds) {
+    volatile int sink = 0;
+    uint64_t start = read_cycle();
+    for (size_t i = 0; i < rounds; i++) {
+        switch (op) {
+        case OP_MEMCPY:           memcpy(g_dst, g_src, size); break;
+        case OP_MEMCPY_UNALIGNED: memcpy(g_dst, g_src + 1, size); break;
+        case OP_MEMSET:           memset(g_dst, (int)i, size); break;
+        case OP_MEMCMP:           sink += memcmp(g_dst, g_src, size); break;
+        case OP_BYTE_COPY:        byte_copy(g_dst, g_src, size); break;
+        }
+    }
+    (void)sink;
+    return (read_cycle() - start) / rounds;
+}
+
+void mem_bench(void) {
+    for (size_t i = 0; i < sizeof(g_src); i++) {
+        g_src[i] = (uint8_t)(i * 7);
+    }
+
+    puts("[mem_bench] cycles per call");
+    printf("%s", "  size");
+    for (int op = 0; op < OP_COUNT; op++) {
+        printf("  %s", g_op_names[op]);
+    }
+    puts("");
+
+    for (size_t size = 16; size <= BENCH_MAX; size <<= 2) {
+        size_t rounds = BENCH_BYTES / size;
+        printf("  %d", (int)size);
+        for (int op = 0; op < OP_COUNT; op++) {
+            /* memcmp 比较相同内容，测的是完整扫描 */
+            if (op == OP_MEMCMP) memcpy(g_dst, g_src, size);
+            printf("  %d", (int)run(op, size, rounds));
+        }
+        puts("");
+    }
+}
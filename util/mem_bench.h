@@ -0,0 +1,12 @@
+/**
+ * 内存操作函数基准测试
+ *
+ * 仅在以 MEM_BENCH=1 构建时链接。
+ */
+#ifndef MEM_BENCH_H
+#define MEM_BENCH_H
+
+/* 测量 16 B - 4 KiB 的 memcpy / memset / memcmp 每次调用的周期数并打印 */
+void mem_bench(void);
+
+#endif /* MEM_BENCH_H */
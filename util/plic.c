@@ -0,0 +1,33 @@
+/**
+ * PLIC 驱动实现
+ */
+#include "plic.h"
+
+/* hart 0 的 S 态上下文编号（上下文 0 为 M 态） */
+#define PLIC_S_CONTEXT      1
+
+#define PLIC_PRIORITY(irq)  (PLIC_BASE + 4 * (irq))
+#define PLIC_ENABLE(ctx)    (PLIC_BASE + 0x2000 + 0x80 * (ctx))
+#define PLIC_THRESHOLD(ctx) (PLIC_BASE + 0x200000 + 0x1000 * (ctx))
+#define PLIC_CLAIM(ctx)     (PLIC_THRESHOLD(ctx) + 4)
+
+static inline volatile uint32_t *reg(uintptr_t addr) {
+    return (volatile uint32_t *)addr;
+}
+
+void plic_init(void) {
+    *reg(PLIC_THRESHOLD(PLIC_S_CONTEXT)) = 0;
+}
+
+void plic_enable(uint32_t irq) {
+    *reg(PLIC_PRIORITY(irq)) = 1;
+    *reg(PLIC_ENABLE(PLIC_S_CONTEXT) + 4 * (irq / 32)) |= 1U << (irq % 32);
+}
+
+uint32_t plic_claim(void) {
+    return *reg(PLIC_CLAIM(PLIC_S_CONTEXT));
+}
+
+void plic_complete(uint32_t irq) {
+    *reg(PLIC_CLAIM(PLIC_S_CONTEXT)) = irq;
+}
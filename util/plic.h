@@ -0,0 +1,30 @@
+/**
+ * PLIC (Platform-Level Interrupt Controller) 驱动
+ *
+ * 只处理 QEMU virt 平台 hart 0 的 S 态上下文。
+ */
+#ifndef PLIC_H
+#define PLIC_H
+
+#include <stdint.h>
+
+/* QEMU virt 平台的 PLIC 地址 */
+#define PLIC_BASE       0x0c000000
+#define PLIC_SIZE       0x210000    /* 覆盖到 hart 0 S 态上下文的阈值/认领寄存器 */
+
+/* QEMU virt 平台的中断源 */
+#define VIRTIO0_IRQ     1
+
+/* 初始化 hart 0 S 态上下文：阈值设为 0，接收所有优先级大于 0 的中断 */
+void plic_init(void);
+
+/* 使能中断源 irq（优先级设为 1） */
+void plic_enable(uint32_t irq);
+
+/* 认领一个待处理的中断，没有时返回 0 */
+uint32_t plic_claim(void);
+
+/* 通知 PLIC 中断 irq 处理完毕 */
+void plic_complete(uint32_t irq);
+
+#endif /* PLIC_H */
@@ -53,6 +53,13 @@ static inline uint64_t read_time(void) {
     return val;
 }
 
+/* 周期计数器（需要 M 态固件在 mcounteren 中开放 CY） */
+static inline uint64_t read_cycle(void) {
+    uint64_t val;
+    asm volatile("rdcycle %0" : "=r"(val));
+    return val;
+}
+
 static inline uintptr_t read_sie(void) {
     uintptr_t val;
     asm volatile("csrr %0, sie" : "=r"(val));
@@ -79,6 +86,16 @@ static inline void disable_timer_interrupt(void) {
     write_sie(read_sie() & ~SIE_STIE);
 }
 
+/* 开启 S-mode 外部中断 */
+static inline void enable_external_interrupt(void) {
+    write_sie(read_sie() | SIE_SEIE);
+}
+
+/* 等待中断（sstatus.SIE 关闭时也会在 sie 允许的中断到来时返回） */
+static inline void wait_for_interrupt(void) {
+    asm volatile("wfi");
+}
+
 /* 判断是否是中断 */
 static inline int is_interrupt(uintptr_t scause) {
     return (scause & SCAUSE_INTERRUPT) != 0;
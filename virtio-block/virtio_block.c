@@ -1,5 +1,18 @@
 /**
  * VirtIO Block 设备驱动实现
+ *
+ * 每个请求占用 3 个描述符（请求头 | 数据 | 状态），请求头与状态按链首描述符
+ * 下标存放，因此队列中可以同时有 queue_size / 3 个请求在途。
+ *
+ * 同步请求（complete 为 NULL）提交后忙等完成；异步请求由 virtio_blk_start 提交，
+ * 在中断处理 (virtio_blk_handle_irq) 或任意一次回收已用环时调用其 complete 回调。
+ *
+ * 协商的特性：
+ * - INDIRECT_DESC：描述符链放在按链首下标分配的间接表中，每个请求只占环中 1 项
+ * - EVENT_IDX：设备通过 avail_event 告知何时需要通知；驱动通过 used_event 只在
+ *   有异步请求在途时请求完成中断（同步请求靠轮询）
+ * - SEG_MAX / BLK_SIZE：读取配置空间并记录
+ * - FLUSH：fsync / sync 时下发 FLUSH 请求
  */
 #include "virtio_block.h"
 #include "../kernel-alloc/heap.h"
@@ -14,25 +27,28 @@ static inline void mmio_write32(volatile uint32_t *addr, uint32_t val) {
     *addr = val;
 }
 
-/* 分配描述符 */
-static int alloc_desc(virtio_blk_t *blk) {
-    for (int i = 0; i < VIRTQ_SIZE; i++) {
-        if (blk->free[i]) {
-            blk->free[i] = false;
-            return i;
-        }
-    }
-    return -1;
+static inline size_t align_up(size_t x, size_t align) {
+    return (x + align - 1) & ~(align - 1);
+}
+
+/* 分配描述符（调用者保证 num_free > 0） */
+static uint16_t alloc_desc(virtio_blk_t *blk) {
+    uint16_t i = blk->free_head;
+    blk->free_head = blk->next_free[i];
+    blk->num_free--;
+    return i;
 }
 
-static void free_desc(virtio_blk_t *blk, int i) {
-    blk->free[i] = true;
+static void free_desc(virtio_blk_t *blk, uint16_t i) {
+    blk->next_free[i] = blk->free_head;
+    blk->free_head = i;
+    blk->num_free++;
 }
 
-static void free_chain(virtio_blk_t *blk, int i) {
+static void free_chain(virtio_blk_t *blk, uint16_t i) {
     while (1) {
-        int flags = blk->desc[i].flags;
-        int next = blk->desc[i].next;
+        uint16_t flags = blk->desc[i].flags;
+        uint16_t next = blk->desc[i].next;
         free_desc(blk, i);
         if (flags & VIRTQ_DESC_F_NEXT) {
             i = next;
@@ -42,10 +58,33 @@ static void free_chain(virtio_blk_t *blk, int i) {
     }
 }
 
+/* used_event 位于可用环之后，avail_event 位于已用环之后 */
+static inline volatile uint16_t *used_event(virtio_blk_t *blk) {
+    return (volatile uint16_t *)((uint8_t *)blk->avail + sizeof(virtq_avail_t) +
+                                 blk->queue_size * sizeof(uint16_t));
+}
+
+static inline volatile uint16_t *avail_event(virtio_blk_t *blk) {
+    return (volatile uint16_t *)((uint8_t *)blk->used + sizeof(virtq_used_t) +
+                                 blk->queue_size * sizeof(virtq_used_elem_t));
+}
+
+/* 索引从 old 推进到 new_idx 时是否越过了对方要求的 event */
+static inline bool need_event(uint16_t event, uint16_t new_idx, uint16_t old) {
+    return (uint16_t)(new_idx - event - 1) < (uint16_t)(new_idx - old);
+}
+
+static inline uint32_t config_read32(virtio_blk_t *blk, uint32_t offset) {
+    return mmio_read32(blk->regs + (VIRTIO_MMIO_CONFIG + offset)/4);
+}
+
 /* 简易调试输出 */
 extern void console_putchar(int ch);
-static void debug_puts(const char *s) {
+static void debug_str(const char *s) {
     while (*s) console_putchar(*s++);
+}
+static void debug_puts(const char *s) {
+    debug_str(s);
     console_putchar('\n');
 }
 static void debug_hex(uint32_t v) {
@@ -57,6 +96,25 @@ static void debug_hex(uint32_t v) {
     console_putchar('\n');
 }
 
+static void log_features(virtio_blk_t *blk) {
+    static const struct { int bit; const char *name; } names[] = {
+        { VIRTIO_BLK_F_SEG_MAX, " SEG_MAX" },
+        { VIRTIO_BLK_F_BLK_SIZE, " BLK_SIZE" },
+        { VIRTIO_BLK_F_FLUSH, " FLUSH" },
+        { VIRTIO_RING_F_INDIRECT_DESC, " INDIRECT_DESC" },
+        { VIRTIO_RING_F_EVENT_IDX, " EVENT_IDX" },
+        { VIRTIO_F_VERSION_1, " VERSION_1" },
+    };
+    debug_str("[VIRTIO] features:");
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (virtio_blk_has_feature(blk, names[i].bit)) debug_str(names[i].name);
+    }
+    debug_puts("");
+    debug_puts("[VIRTIO] seg_max / blk_size:");
+    debug_hex(blk->seg_max);
+    debug_hex(blk->blk_size);
+}
+
 int virtio_blk_init(virtio_blk_t *blk) {
     blk->regs = (volatile uint32_t *)VIRTIO0_BASE;
 
@@ -95,13 +153,22 @@ int virtio_blk_init(virtio_blk_t *blk) {
     mmio_write32(blk->regs + VIRTIO_MMIO_STATUS/4,
                  VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
 
-    /* 读取并设置特性 */
+    /* 读取设备特性（两组 32 位），只接受驱动实现了的部分 */
     mmio_write32(blk->regs + VIRTIO_MMIO_DEVICE_FEATURES_SEL/4, 0);
-    uint32_t features = mmio_read32(blk->regs + VIRTIO_MMIO_DEVICE_FEATURES/4);
-    (void)features;
+    uint64_t features = mmio_read32(blk->regs + VIRTIO_MMIO_DEVICE_FEATURES/4);
+    mmio_write32(blk->regs + VIRTIO_MMIO_DEVICE_FEATURES_SEL/4, 1);
+    features |= (uint64_t)mmio_read32(blk->regs + VIRTIO_MMIO_DEVICE_FEATURES/4) << 32;
+
+    uint64_t supported = (1ULL << VIRTIO_BLK_F_SEG_MAX) | (1ULL << VIRTIO_BLK_F_BLK_SIZE) |
+                         (1ULL << VIRTIO_BLK_F_FLUSH) | (1ULL << VIRTIO_RING_F_INDIRECT_DESC) |
+                         (1ULL << VIRTIO_RING_F_EVENT_IDX);
+    if (version == 2) supported |= 1ULL << VIRTIO_F_VERSION_1;
+    blk->features = features & supported;
 
     mmio_write32(blk->regs + VIRTIO_MMIO_DRIVER_FEATURES_SEL/4, 0);
-    mmio_write32(blk->regs + VIRTIO_MMIO_DRIVER_FEATURES/4, 0);
+    mmio_write32(blk->regs + VIRTIO_MMIO_DRIVER_FEATURES/4, (uint32_t)blk->features);
+    mmio_write32(blk->regs + VIRTIO_MMIO_DRIVER_FEATURES_SEL/4, 1);
+    mmio_write32(blk->regs + VIRTIO_MMIO_DRIVER_FEATURES/4, (uint32_t)(blk->features >> 32));
 
     /* 设置 FEATURES_OK */
     mmio_write32(blk->regs + VIRTIO_MMIO_STATUS/4,
@@ -113,6 +180,16 @@ int virtio_blk_init(virtio_blk_t *blk) {
         return -1;
     }
 
+    blk->seg_max = virtio_blk_has_feature(blk, VIRTIO_BLK_F_SEG_MAX) ?
+                   config_read32(blk, VIRTIO_BLK_CFG_SEG_MAX) : 1;
+    blk->blk_size = virtio_blk_has_feature(blk, VIRTIO_BLK_F_BLK_SIZE) ?
+                    config_read32(blk, VIRTIO_BLK_CFG_BLK_SIZE) : 512;
+    if (blk->seg_max == 0) blk->seg_max = 1;
+    log_features(blk);
+    if (blk->blk_size != 512) {
+        debug_puts("[VIRTIO] warning: logical block size is not 512, requests may be slow");
+    }
+
     /* 选择队列 0 */
     mmio_write32(blk->regs + VIRTIO_MMIO_QUEUE_SEL/4, 0);
 
@@ -121,42 +198,57 @@ int virtio_blk_init(virtio_blk_t *blk) {
         return -1;
     }
 
-    /* 检查最大队列大小 */
+    /* 队列大小：不超过设备上限与 VIRTQ_MAX_SIZE 的最大 2 的幂 */
     uint32_t max = mmio_read32(blk->regs + VIRTIO_MMIO_QUEUE_NUM_MAX/4);
-    if (max < VIRTQ_SIZE) {
+    if (max < VIRTIO_BLK_DESC_PER_REQ) {
         return -1;
     }
+    uint32_t qsize = VIRTQ_MAX_SIZE;
+    while (qsize > max) qsize >>= 1;
+    blk->queue_size = qsize;
+    debug_puts("[VIRTIO] queue size:");
+    debug_hex(qsize);
 
     /* 分配队列内存 (页对齐)
-     * Legacy 布局: desc (16*VIRTQ_SIZE) | avail (6+2*VIRTQ_SIZE) | padding | used (对齐到 PAGE)
-     * desc_size = 16 * 8 = 128
-     * avail_size = 6 + 2 * 8 = 22
-     * used_size = 6 + 8 * 8 = 70
-     * avail_end 需要对齐到页边界后放 used
+     * Legacy 布局: desc (16*N) | avail (6+2*N) | padding | used (6+8*N，对齐到页)
+     * Modern 模式使用同样的布局，三个区域的地址分别写入寄存器
      */
-    size_t desc_size = VIRTQ_SIZE * sizeof(virtq_desc_t);  /* 128 */
-
-    /* 简化：分配 2 页，desc+avail 在第一页，used 在第二页 */
-    size_t total = 4096 * 2;
-    uint8_t *queue_mem = heap_alloc(total, 4096);
+    size_t desc_size = qsize * sizeof(virtq_desc_t);
+    size_t avail_size = sizeof(virtq_avail_t) + qsize * sizeof(uint16_t) + sizeof(uint16_t);
+    size_t used_off = align_up(desc_size + avail_size, 4096);
+    size_t used_size = sizeof(virtq_used_t) + qsize * sizeof(virtq_used_elem_t) + sizeof(uint16_t);
+    size_t total = align_up(used_off + used_size, 4096);
+    uint8_t *queue_mem = heap_alloc_zeroed(total, 4096);
     if (!queue_mem) return -1;
-    memset(queue_mem, 0, total);
 
     blk->desc = (virtq_desc_t *)queue_mem;
     blk->avail = (virtq_avail_t *)(queue_mem + desc_size);
-    /* 在 legacy 模式下，used 区域需要对齐到页边界 (从 queue_mem 开始的偏移) */
-    /* avail 结束位置后对齐到 4096 边界 */
-    blk->used = (virtq_used_t *)(queue_mem + 4096);  /* 第二页开始 */
+    blk->used = (virtq_used_t *)(queue_mem + used_off);
+
+    /* 请求头、状态字节、请求归属与空闲链表，按描述符下标索引 */
+    blk->reqs = heap_alloc_zeroed(qsize * sizeof(virtio_blk_req_t), 16);
+    blk->status = heap_alloc_zeroed(qsize, 8);
+    blk->owner = heap_alloc_zeroed(qsize * sizeof(block_request_t *), 8);
+    blk->next_free = heap_alloc_zeroed(qsize * sizeof(uint16_t), 8);
+    if (!blk->reqs || !blk->status || !blk->owner || !blk->next_free) {
+        return -1;
+    }
+    blk->indirect = NULL;
+    blk->desc_per_req = VIRTIO_BLK_DESC_PER_REQ;
+    if (virtio_blk_has_feature(blk, VIRTIO_RING_F_INDIRECT_DESC)) {
+        blk->indirect = heap_alloc_zeroed(qsize * VIRTIO_BLK_DESC_PER_REQ * sizeof(virtq_desc_t), 16);
+        if (!blk->indirect) return -1;
+        blk->desc_per_req = 1;
+    }
 
     /* 设置队列大小 */
-    mmio_write32(blk->regs + VIRTIO_MMIO_QUEUE_NUM/4, VIRTQ_SIZE);
+    mmio_write32(blk->regs + VIRTIO_MMIO_QUEUE_NUM/4, qsize);
 
     if (version == 1) {
-        /* Legacy MMIO: 使用 QUEUE_PFN 和 GUEST_PAGE_SIZE */
+        /* Legacy MMIO: 使用 QUEUE_PFN、GUEST_PAGE_SIZE 和 QUEUE_ALIGN */
         mmio_write32(blk->regs + VIRTIO_MMIO_GUEST_PAGE_SIZE/4, 4096);
+        mmio_write32(blk->regs + VIRTIO_MMIO_QUEUE_ALIGN/4, 4096);
 
-        /* 在 legacy 模式下，desc, avail, used 必须在同一页内连续布局 */
-        /* 布局: desc | avail | padding | used (对齐到 4096) */
         uintptr_t queue_pfn = (uintptr_t)queue_mem >> 12;
         mmio_write32(blk->regs + VIRTIO_MMIO_QUEUE_PFN/4, queue_pfn);
     } else {
@@ -181,86 +273,241 @@ int virtio_blk_init(virtio_blk_t *blk) {
                  VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER |
                  VIRTIO_STATUS_FEATURES_OK | VIRTIO_STATUS_DRIVER_OK);
 
-    /* 初始化描述符空闲列表 */
-    for (int i = 0; i < VIRTQ_SIZE; i++) {
-        blk->free[i] = true;
+    /* 初始化描述符空闲链表 */
+    blk->free_head = 0;
+    blk->num_free = qsize;
+    for (uint32_t i = 0; i < qsize; i++) {
+        blk->next_free[i] = i + 1;
     }
     blk->last_used_idx = 0;
+    blk->inflight = 0;
+    blk->async_inflight = 0;
+    blk->requests = 0;
+    blk->notifies = 0;
+    blk->notifies_skipped = 0;
+    blk->max_inflight = 0;
+    blk->irqs = 0;
+
+    /* 初始时没有异步请求，不需要完成中断 */
+    if (virtio_blk_has_feature(blk, VIRTIO_RING_F_EVENT_IDX)) {
+        *used_event(blk) = (uint16_t)(blk->last_used_idx - 1);
+    }
 
     return 0;
 }
 
-/* 执行块操作 */
-static int virtio_blk_rw(virtio_blk_t *blk, size_t sector, uint8_t *buf, int write) {
+/* 为一个请求填写描述符链，返回链首下标（调用者保证至少有 desc_per_req 个空闲描述符） */
+static uint16_t queue_request(virtio_blk_t *blk, block_request_t *r) {
+    bool indirect = blk->indirect != NULL;
+    int n = r->flush ? 2 : VIRTIO_BLK_DESC_PER_REQ;
+    uint16_t head = alloc_desc(blk);
+
+    /* 间接模式下链在 head 专属的表内（下标 0..n-1），否则直接占用环中的描述符 */
+    virtq_desc_t *table = indirect ? &blk->indirect[head * VIRTIO_BLK_DESC_PER_REQ] : blk->desc;
+    uint16_t idx[VIRTIO_BLK_DESC_PER_REQ];
+    for (int i = 0; i < n; i++) {
+        idx[i] = indirect ? i : (i == 0 ? head : alloc_desc(blk));
+    }
+
     /* 准备请求头 */
-    blk->req.type = write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
-    blk->req.reserved = 0;
-    blk->req.sector = sector;
-    blk->status = 0xff;
-
-    /* 分配 3 个描述符 */
-    int idx[3];
-    for (int i = 0; i < 3; i++) {
-        idx[i] = alloc_desc(blk);
-        if (idx[i] < 0) return -1;
+    virtio_blk_req_t *req = &blk->reqs[head];
+    req->type = r->flush ? VIRTIO_BLK_T_FLUSH : r->write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+    req->reserved = 0;
+    req->sector = r->flush ? 0 : r->block_id;
+    blk->status[head] = 0xff;
+    blk->owner[head] = r;
+    r->status = BLOCK_REQ_PENDING;
+
+    blk->requests++;
+    if (++blk->inflight > blk->max_inflight) blk->max_inflight = blk->inflight;
+    if (r->complete) blk->async_inflight++;
+
+    /* 请求头 (设备读) */
+    int d = 0;
+    table[idx[d]].addr = (uint64_t)(uintptr_t)req;
+    table[idx[d]].len = sizeof(virtio_blk_req_t);
+    table[idx[d]].flags = VIRTQ_DESC_F_NEXT;
+    table[idx[d]].next = idx[d + 1];
+    d++;
+
+    /* 数据缓冲区（FLUSH 没有） */
+    if (!r->flush) {
+        table[idx[d]].addr = (uint64_t)(uintptr_t)r->buf;
+        table[idx[d]].len = r->count * 512;
+        table[idx[d]].flags = VIRTQ_DESC_F_NEXT | (r->write ? 0 : VIRTQ_DESC_F_WRITE);
+        table[idx[d]].next = idx[d + 1];
+        d++;
     }
 
-    /* 描述符 0: 请求头 (设备读) */
-    blk->desc[idx[0]].addr = (uint64_t)(uintptr_t)&blk->req;
-    blk->desc[idx[0]].len = sizeof(virtio_blk_req_t);
-    blk->desc[idx[0]].flags = VIRTQ_DESC_F_NEXT;
-    blk->desc[idx[0]].next = idx[1];
-
-    /* 描述符 1: 数据缓冲区 */
-    blk->desc[idx[1]].addr = (uint64_t)(uintptr_t)buf;
-    blk->desc[idx[1]].len = 512;
-    blk->desc[idx[1]].flags = VIRTQ_DESC_F_NEXT | (write ? 0 : VIRTQ_DESC_F_WRITE);
-    blk->desc[idx[1]].next = idx[2];
-
-    /* 描述符 2: 状态 (设备写) */
-    blk->desc[idx[2]].addr = (uint64_t)(uintptr_t)&blk->status;
-    blk->desc[idx[2]].len = 1;
-    blk->desc[idx[2]].flags = VIRTQ_DESC_F_WRITE;
-    blk->desc[idx[2]].next = 0;
-
-    /* 添加到可用环 */
-    uint16_t avail_idx = blk->avail->idx;
-    blk->avail->ring[avail_idx % VIRTQ_SIZE] = idx[0];
+    /* 状态 (设备写) */
+    table[idx[d]].addr = (uint64_t)(uintptr_t)&blk->status[head];
+    table[idx[d]].len = 1;
+    table[idx[d]].flags = VIRTQ_DESC_F_WRITE;
+    table[idx[d]].next = 0;
+
+    if (indirect) {
+        blk->desc[head].addr = (uint64_t)(uintptr_t)table;
+        blk->desc[head].len = n * sizeof(virtq_desc_t);
+        blk->desc[head].flags = VIRTQ_DESC_F_INDIRECT;
+        blk->desc[head].next = 0;
+    }
+    return head;
+}
 
-    /* 内存屏障 */
+/* 把 avail_idx 之后的 queued 个链首发布给设备并通知 */
+static void publish(virtio_blk_t *blk, uint16_t avail_idx, uint16_t queued) {
+    uint16_t new_idx = avail_idx + queued;
     __sync_synchronize();
-
-    /* 更新可用环索引 */
-    blk->avail->idx = avail_idx + 1;
-
-    /* 内存屏障 */
+    blk->avail->idx = new_idx;
     __sync_synchronize();
 
-    /* 通知设备 */
+    /* EVENT_IDX：设备仍在处理之前的请求、尚未读到 avail_event 之后时不必通知 */
+    if (virtio_blk_has_feature(blk, VIRTIO_RING_F_EVENT_IDX) &&
+        !need_event(*avail_event(blk), new_idx, avail_idx)) {
+        blk->notifies_skipped++;
+        return;
+    }
     mmio_write32(blk->regs + VIRTIO_MMIO_QUEUE_NOTIFY/4, 0);
+    blk->notifies++;
+}
 
-    /* 等待完成 */
-    while (blk->used->idx == blk->last_used_idx) {
-        /* 忙等待 */
+/**
+ * EVENT_IDX：有异步请求在途时要求下一个完成就发中断，否则不要中断
+ * （used_event 取 last_used_idx - 1，需回绕 65536 次才会触发）
+ */
+static void update_used_event(virtio_blk_t *blk) {
+    if (!virtio_blk_has_feature(blk, VIRTIO_RING_F_EVENT_IDX)) return;
+    *used_event(blk) = blk->async_inflight ? blk->last_used_idx
+                                           : (uint16_t)(blk->last_used_idx - 1);
+    __sync_synchronize();
+}
+
+/**
+ * 回收已用环中所有完成的请求
+ *
+ * 异步请求调用其 complete 回调；返回本次回收的同步请求数。
+ */
+static size_t reap(virtio_blk_t *blk) {
+    size_t sync_done = 0;
+    __sync_synchronize();
+again:
+    while (blk->last_used_idx != blk->used->idx) {
+        virtq_used_elem_t *e = &blk->used->ring[blk->last_used_idx % blk->queue_size];
+        uint16_t head = (uint16_t)e->id;
+        block_request_t *r = blk->owner[head];
+        r->status = (blk->status[head] == VIRTIO_BLK_S_OK) ? 0 : -1;
+        blk->owner[head] = NULL;
+        free_chain(blk, head);
+        blk->last_used_idx++;
+        blk->inflight--;
+        if (r->complete) {
+            blk->async_inflight--;
+            r->complete(r);
+        } else {
+            sync_done++;
+        }
         __sync_synchronize();
     }
 
-    /* 处理已用描述符 */
-    blk->last_used_idx++;
+    /* 更新 used_event 后再检查一次，避免错过更新期间完成的请求的中断 */
+    update_used_event(blk);
+    if (blk->last_used_idx != blk->used->idx) goto again;
+    return sync_done;
+}
 
-    /* 释放描述符链 */
-    free_chain(blk, idx[0]);
+int virtio_blk_submit(virtio_blk_t *blk, block_request_t *reqs, size_t n) {
+    size_t next = 0;        /* 下一个待放入队列的请求 */
+    size_t done = 0;        /* 已完成的请求数 */
 
-    return (blk->status == VIRTIO_BLK_S_OK) ? 0 : -1;
+    for (size_t i = 0; i < n; i++) {
+        reqs[i].complete = NULL;
+    }
+
+    while (done < n) {
+        /* 尽可能多地放入可用环，最后统一更新 idx 并通知一次 */
+        uint16_t avail_idx = blk->avail->idx;
+        uint16_t queued = 0;
+        while (next < n && blk->num_free >= blk->desc_per_req) {
+            uint16_t head = queue_request(blk, &reqs[next]);
+            blk->avail->ring[(uint16_t)(avail_idx + queued) % blk->queue_size] = head;
+            queued++;
+            next++;
+        }
+        if (queued > 0) {
+            publish(blk, avail_idx, queued);
+        }
+
+        /* 等待至少一个请求完成 */
+        while (blk->used->idx == blk->last_used_idx) {
+            /* 忙等待 */
+            __sync_synchronize();
+        }
+
+        /* 回收所有已完成的请求（可能包含异步请求），腾出的描述符留给下一轮 */
+        done += reap(blk);
+    }
+
+    int ret = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (reqs[i].status != 0) ret = -1;
+    }
+    return ret;
+}
+
+int virtio_blk_start(virtio_blk_t *blk, block_request_t *req) {
+    if (!req->complete || blk->num_free < blk->desc_per_req) return -1;
+
+    uint16_t avail_idx = blk->avail->idx;
+    uint16_t head = queue_request(blk, req);
+    blk->avail->ring[avail_idx % blk->queue_size] = head;
+    update_used_event(blk);
+    publish(blk, avail_idx, 1);
+    return 0;
+}
+
+int virtio_blk_flush(virtio_blk_t *blk) {
+    if (!virtio_blk_has_feature(blk, VIRTIO_BLK_F_FLUSH)) return 0;
+    block_request_t r = { .flush = true };
+    return virtio_blk_submit(blk, &r, 1);
+}
+
+void virtio_blk_poll(virtio_blk_t *blk) {
+    reap(blk);
+}
+
+void virtio_blk_handle_irq(virtio_blk_t *blk) {
+    uint32_t status = mmio_read32(blk->regs + VIRTIO_MMIO_INTERRUPT_STATUS/4);
+    mmio_write32(blk->regs + VIRTIO_MMIO_INTERRUPT_ACK/4, status & 0x3);
+    blk->irqs++;
+    reap(blk);
+}
+
+/* 执行单个块操作：从 sector 起连续读写 count 个扇区，buf 须物理连续 */
+static int virtio_blk_rw(virtio_blk_t *blk, size_t sector, size_t count, uint8_t *buf, int write) {
+    block_request_t r = {
+        .block_id = sector,
+        .count = count,
+        .buf = buf,
+        .write = write != 0,
+    };
+    return virtio_blk_submit(blk, &r, 1);
 }
 
 int virtio_blk_read(virtio_blk_t *blk, size_t sector, uint8_t *buf) {
-    return virtio_blk_rw(blk, sector, buf, 0);
+    return virtio_blk_rw(blk, sector, 1, buf, 0);
 }
 
 int virtio_blk_write(virtio_blk_t *blk, size_t sector, const uint8_t *buf) {
     /* 需要临时缓冲区因为写操作不能使用 const 指针 */
-    return virtio_blk_rw(blk, sector, (uint8_t *)buf, 1);
+    return virtio_blk_rw(blk, sector, 1, (uint8_t *)buf, 1);
+}
+
+int virtio_blk_read_n(virtio_blk_t *blk, size_t sector, size_t count, uint8_t *buf) {
+    return virtio_blk_rw(blk, sector, count, buf, 0);
+}
+
+int virtio_blk_write_n(virtio_blk_t *blk, size_t sector, size_t count, const uint8_t *buf) {
+    return virtio_blk_rw(blk, sector, count, (uint8_t *)buf, 1);
 }
 
 /* block_device_t 回调 */
@@ -274,11 +521,48 @@ static void bd_write_block(block_device_t *dev, size_t block_id, const uint8_t *
     virtio_blk_write(blk, block_id, buf);
 }
 
+static void bd_read_blocks(block_device_t *dev, size_t block_id, size_t count, uint8_t *buf) {
+    virtio_blk_t *blk = (virtio_blk_t *)dev->priv;
+    virtio_blk_read_n(blk, block_id, count, buf);
+}
+
+static void bd_write_blocks(block_device_t *dev, size_t block_id, size_t count,
+                            const uint8_t *buf) {
+    virtio_blk_t *blk = (virtio_blk_t *)dev->priv;
+    virtio_blk_write_n(blk, block_id, count, buf);
+}
+
+static int bd_submit(block_device_t *dev, block_request_t *reqs, size_t n) {
+    virtio_blk_t *blk = (virtio_blk_t *)dev->priv;
+    return virtio_blk_submit(blk, reqs, n);
+}
+
+static int bd_start(block_device_t *dev, block_request_t *req) {
+    virtio_blk_t *blk = (virtio_blk_t *)dev->priv;
+    return virtio_blk_start(blk, req);
+}
+
+static void bd_poll(block_device_t *dev) {
+    virtio_blk_t *blk = (virtio_blk_t *)dev->priv;
+    virtio_blk_poll(blk);
+}
+
+static int bd_flush(block_device_t *dev) {
+    virtio_blk_t *blk = (virtio_blk_t *)dev->priv;
+    return virtio_blk_flush(blk);
+}
+
 static block_device_t g_block_device;
 
 block_device_t *virtio_blk_as_block_device(virtio_blk_t *blk) {
     g_block_device.read_block = bd_read_block;
     g_block_device.write_block = bd_write_block;
+    g_block_device.read_blocks = bd_read_blocks;
+    g_block_device.write_blocks = bd_write_blocks;
+    g_block_device.submit = bd_submit;
+    g_block_device.start = bd_start;
+    g_block_device.poll = bd_poll;
+    g_block_device.flush = bd_flush;
     g_block_device.priv = blk;
     return &g_block_device;
 }
@@ -40,6 +40,12 @@
 #define VIRTIO_MMIO_QUEUE_AVAIL_HIGH    0x094
 #define VIRTIO_MMIO_QUEUE_USED_LOW      0x0a0
 #define VIRTIO_MMIO_QUEUE_USED_HIGH     0x0a4
+#define VIRTIO_MMIO_CONFIG              0x100   /* 设备配置空间 */
+
+/* 设备配置空间 (struct virtio_blk_config) 中用到的字段偏移 */
+#define VIRTIO_BLK_CFG_CAPACITY         0x00    /* u64，以 512 字节扇区计 */
+#define VIRTIO_BLK_CFG_SEG_MAX          0x0c    /* u32 */
+#define VIRTIO_BLK_CFG_BLK_SIZE         0x14    /* u32 */
 
 /* VirtIO 状态位 */
 #define VIRTIO_STATUS_ACKNOWLEDGE       1
@@ -47,9 +53,18 @@
 #define VIRTIO_STATUS_DRIVER_OK         4
 #define VIRTIO_STATUS_FEATURES_OK       8
 
+/* 特性位 */
+#define VIRTIO_BLK_F_SEG_MAX        2   /* 配置空间给出单个请求的最大数据段数 */
+#define VIRTIO_BLK_F_BLK_SIZE       6   /* 配置空间给出逻辑块大小 */
+#define VIRTIO_BLK_F_FLUSH          9   /* 支持 FLUSH 请求 */
+#define VIRTIO_RING_F_INDIRECT_DESC 28  /* 支持间接描述符表 */
+#define VIRTIO_RING_F_EVENT_IDX     29  /* 用 used_event / avail_event 抑制中断和通知 */
+#define VIRTIO_F_VERSION_1          32  /* 非 legacy 设备 (version 2) 须协商 */
+
 /* VirtIO Block 请求类型 */
 #define VIRTIO_BLK_T_IN     0   /* 读 */
 #define VIRTIO_BLK_T_OUT    1   /* 写 */
+#define VIRTIO_BLK_T_FLUSH  4   /* 刷写设备写缓存 */
 
 /* VirtIO Block 状态 */
 #define VIRTIO_BLK_S_OK     0
@@ -58,9 +73,13 @@
 /* VirtQueue 描述符标志 */
 #define VIRTQ_DESC_F_NEXT     1
 #define VIRTQ_DESC_F_WRITE    2
+#define VIRTQ_DESC_F_INDIRECT 4
+
+/* VirtQueue 大小上限：实际大小取设备 QUEUE_NUM_MAX 与此值中较小的 2 的幂 */
+#define VIRTQ_MAX_SIZE 256
 
-/* VirtQueue 大小 */
-#define VIRTQ_SIZE 8
+/* 每个请求的描述符链：请求头、数据、状态。使用间接描述符时在环中只占 1 个 */
+#define VIRTIO_BLK_DESC_PER_REQ 3
 
 /* VirtQueue 描述符 */
 typedef struct __attribute__((packed)) {
@@ -70,12 +89,11 @@ typedef struct __attribute__((packed)) {
     uint16_t next;
 } virtq_desc_t;
 
-/* VirtQueue 可用环 */
+/* VirtQueue 可用环（ring 长度为队列大小，其后是 used_event） */
 typedef struct __attribute__((packed)) {
     uint16_t flags;
     uint16_t idx;
-    uint16_t ring[VIRTQ_SIZE];
-    uint16_t used_event;
+    uint16_t ring[];
 } virtq_avail_t;
 
 /* VirtQueue 已用元素 */
@@ -84,12 +102,11 @@ typedef struct __attribute__((packed)) {
     uint32_t len;
 } virtq_used_elem_t;
 
-/* VirtQueue 已用环 */
+/* VirtQueue 已用环（ring 长度为队列大小，其后是 avail_event） */
 typedef struct __attribute__((packed)) {
     uint16_t flags;
     uint16_t idx;
-    virtq_used_elem_t ring[VIRTQ_SIZE];
-    uint16_t avail_event;
+    virtq_used_elem_t ring[];
 } virtq_used_t;
 
 /* VirtIO Block 请求头 */
@@ -102,14 +119,32 @@ typedef struct __attribute__((packed)) {
 /* VirtIO Block 设备上下文 */
 typedef struct {
     volatile uint32_t *regs;
+    uint16_t queue_size;            /* 描述符个数，初始化时协商 */
+    uint64_t features;              /* 协商后的特性位 */
+    uint32_t seg_max;               /* 单个请求最多的数据段数（未协商时为 1） */
+    uint32_t blk_size;              /* 设备逻辑块大小（未协商时为 512） */
+    uint16_t desc_per_req;          /* 每个请求在环中占用的描述符数 */
     virtq_desc_t *desc;
     virtq_avail_t *avail;
     virtq_used_t *used;
     uint16_t last_used_idx;
-    bool free[VIRTQ_SIZE];
-    /* 请求相关 */
-    virtio_blk_req_t req;
-    uint8_t status;
+    /* 空闲描述符链表（通过 next_free 串联） */
+    uint16_t free_head;
+    uint16_t num_free;
+    uint16_t *next_free;
+    /* 按链首描述符下标索引的请求头、状态、间接描述符表和对应的上层请求 */
+    virtio_blk_req_t *reqs;
+    virtq_desc_t *indirect;         /* 每个链首一张 VIRTIO_BLK_DESC_PER_REQ 项的表 */
+    uint8_t *status;
+    block_request_t **owner;
+    uint16_t inflight;              /* 当前在途请求数 */
+    uint16_t async_inflight;        /* 其中的异步请求数（决定是否需要完成中断） */
+    /* 统计 */
+    size_t requests;                /* 已提交的请求数 */
+    size_t notifies;                /* 通知设备的次数 */
+    size_t notifies_skipped;        /* 因 EVENT_IDX 省去的通知次数 */
+    uint16_t max_inflight;          /* 同时在途请求数峰值 */
+    size_t irqs;                    /* 处理的中断次数 */
 } virtio_blk_t;
 
 /* 初始化 VirtIO Block 设备 */
@@ -121,6 +156,44 @@ int virtio_blk_read(virtio_blk_t *blk, size_t sector, uint8_t *buf);
 /* 写块 */
 int virtio_blk_write(virtio_blk_t *blk, size_t sector, const uint8_t *buf);
 
+/* 读写 count 个连续扇区（一次请求），buf 须物理连续 */
+int virtio_blk_read_n(virtio_blk_t *blk, size_t sector, size_t count, uint8_t *buf);
+int virtio_blk_write_n(virtio_blk_t *blk, size_t sector, size_t count, const uint8_t *buf);
+
+/**
+ * 提交一组相互独立的请求并等待全部完成
+ *
+ * 请求尽量同时放入描述符环（一次通知），环满时边回收边补充。
+ * 每个请求的完成状态写入其 status 字段。
+ *
+ * @return 全部成功返回 0，否则返回 -1
+ */
+int virtio_blk_submit(virtio_blk_t *blk, block_request_t *reqs, size_t n);
+
+/**
+ * 异步提交一个请求，不等待完成
+ *
+ * req->complete 必须非空，请求完成时（中断处理或其他请求回收已用环时）被调用，
+ * req 在此之前须保持有效。
+ *
+ * @return 成功返回 0，描述符不足返回 -1
+ */
+int virtio_blk_start(virtio_blk_t *blk, block_request_t *req);
+
+/* 刷写设备写缓存，未协商 FLUSH 时直接返回 0 */
+int virtio_blk_flush(virtio_blk_t *blk);
+
+/* 回收已完成的请求（不等待） */
+void virtio_blk_poll(virtio_blk_t *blk);
+
+/* 外部中断处理：应答设备中断并回收已完成的请求 */
+void virtio_blk_handle_irq(virtio_blk_t *blk);
+
+/* 特性是否已协商 */
+static inline bool virtio_blk_has_feature(const virtio_blk_t *blk, int bit) {
+    return (blk->features >> bit) & 1;
+}
+
 /* 获取作为 block_device_t 的接口 */
 block_device_t *virtio_blk_as_block_device(virtio_blk_t *blk);
 